@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+Luma Helmet - Ride Log Decoder
+
+Turns ride log blocks downloaded from the helmet (ride characteristic,
+see firmware/include/ride_log.h) into a CSV with the same column names
+as the InfluxDB export, so recorded rides can be labeled and fed to
+train_classifier.py like app-collected ones.
+
+The input is the downloaded blocks back to back, each a 32-byte header
+followed by its payload. Blocks with a bad CRC are reported and skipped.
+
+Usage:
+    python decode_rides.py --input rides.bin --output data/rides.csv
+    python decode_rides.py --input rides.bin --output data/rides.csv --session 12
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+from datetime import datetime, timedelta, timezone
+
+import numpy as np
+import pandas as pd
+
+# Must match firmware/include/ride_log.h
+RIDE_LOG_MAGIC = 0x4C524D4C
+RIDE_LOG_VERSION = 1
+HEADER = struct.Struct('<IIIIIIHHHBB')
+FLAG_SESSION_START = 0x01
+FLAG_AFTER_GAP = 0x02
+
+# Must match firmware/include/mpu6500.h
+ACCEL_LSB_PER_G = 4096.0
+GYRO_LSB_PER_DPS = 65.5
+
+AXES = ['accel_x', 'accel_y', 'accel_z', 'gyro_x', 'gyro_y', 'gyro_z']
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Decode helmet ride log blocks to CSV')
+    parser.add_argument('--input', required=True, help='Downloaded blocks (binary)')
+    parser.add_argument('--output', required=True, help='CSV to write')
+    parser.add_argument('--session', type=int, help='Only this session id')
+    parser.add_argument('--start', help='UTC time of the first sample '
+                        '(ISO 8601); default: time since boot from 1970-01-01')
+    return parser.parse_args()
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode_payload(payload, sample_count):
+    """Samples of one block as an (n, 6) int array of raw LSB values."""
+    samples = np.zeros((sample_count, 6), dtype=np.int32)
+    previous = [0] * 6
+    pos = 0
+    for i in range(sample_count):
+        for axis in range(6):
+            zigzag, pos = read_varint(payload, pos)
+            delta = (zigzag >> 1) ^ -(zigzag & 1)
+            previous[axis] += delta
+            samples[i, axis] = previous[axis]
+    return samples
+
+
+def read_blocks(data):
+    """Yield (header dict, samples) for every valid block."""
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        fields = HEADER.unpack_from(data, pos)
+        (magic, seq, session_id, first_index, first_us, crc,
+         payload_len, sample_count, rate_hz, version, flags) = fields
+        if magic != RIDE_LOG_MAGIC or version != RIDE_LOG_VERSION:
+            print(f"⚠️  No block header at byte {pos}, stopping", file=sys.stderr)
+            return
+
+        payload = data[pos + HEADER.size:pos + HEADER.size + payload_len]
+        pos += HEADER.size + payload_len
+        if len(payload) != payload_len or zlib.crc32(payload) != crc:
+            print(f"⚠️  Block {seq}: CRC mismatch, skipped", file=sys.stderr)
+            continue
+        if flags & FLAG_AFTER_GAP:
+            print(f"ℹ️  Block {seq}: samples lost before index {first_index}")
+
+        header = {
+            'seq': seq, 'session_id': session_id, 'first_index': first_index,
+            'first_us': first_us, 'rate_hz': rate_hz, 'flags': flags,
+        }
+        yield header, decode_payload(payload, sample_count)
+
+
+def main():
+    args = parse_args()
+    with open(args.input, 'rb') as f:
+        data = f.read()
+
+    start = (datetime.fromisoformat(args.start.replace('Z', '+00:00'))
+             if args.start else datetime(1970, 1, 1, tzinfo=timezone.utc))
+
+    frames = []
+    session_first_us = {}
+    for header, samples in read_blocks(data):
+        if args.session is not None and header['session_id'] != args.session:
+            continue
+
+        n = len(samples)
+        index = header['first_index'] + np.arange(n)
+        # Timestamps are implied by the rate: time from the session's
+        # first sample, anchored at the first block seen of the session
+        anchor_us = session_first_us.setdefault(
+            header['session_id'],
+            header['first_us'] - header['first_index'] * 1e6 / header['rate_hz'])
+        offset_us = (header['first_us'] - anchor_us) + np.arange(n) * 1e6 / header['rate_hz']
+
+        frame = pd.DataFrame(samples, columns=AXES).astype(float)
+        frame[AXES[:3]] /= ACCEL_LSB_PER_G
+        frame[AXES[3:]] /= GYRO_LSB_PER_DPS
+        frame['accel_mag'] = np.sqrt((frame[AXES[:3]] ** 2).sum(axis=1))
+        frame['sample_index'] = index
+        frame['session_id'] = f"helmet-{header['session_id']}"
+        frame['time'] = [(start + timedelta(microseconds=float(us))).isoformat()
+                         for us in offset_us]
+        frame['label'] = 'unknown'
+        frames.append(frame)
+
+    if not frames:
+        print("❌ No samples decoded")
+        sys.exit(1)
+
+    df = pd.concat(frames, ignore_index=True)
+    df = df[['accel_mag', 'accel_x', 'accel_y', 'accel_z', 'gyro_x', 'gyro_y', 'gyro_z',
+             'label', 'sample_index', 'session_id', 'time']]
+    df.to_csv(args.output, index=False)
+
+    sessions = df['session_id'].nunique()
+    print(f"✓ {len(df)} samples from {sessions} session(s) written to {args.output}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+Luma Helmet - Random Forest Export Script
+
+Compiles a model trained by train_classifier.py into a C header for the
+firmware's on-device classifier (firmware/include/rf_model.h).
+
+- The MinMaxScaler is folded into the split thresholds, so the firmware
+  compares raw feature values and never scales.
+- Features are remapped by name onto the firmware's RfFeature order.
+- Trees are flattened into one node array; leaves point to themselves so
+  the firmware can walk every tree for a fixed number of steps.
+
+Usage:
+    python export_classifier.py --model models/rf_classifier.pkl
+    python export_classifier.py --model models/rf_classifier.pkl --trees 50
+"""
+
+import argparse
+import sys
+from pathlib import Path
+
+import numpy as np
+import joblib
+
+from train_classifier import EVENT_WINDOW_SIZE, SAMPLE_RATE_HZ
+
+# Must match enum RfFeature in firmware/include/rf_features.h
+FEATURE_NAMES = (
+    [f'accel_{a}_{s}' for a in 'xyz'
+     for s in ('mean', 'std', 'max', 'min', 'range', 'median', 'skew', 'kurtosis')]
+    + ['accel_mag_mean', 'accel_mag_std', 'accel_mag_max', 'accel_mag_range']
+    + [f'gyro_{a}_{s}' for a in 'xyz' for s in ('mean', 'std', 'max', 'range')]
+    + ['gyro_mag_mean', 'gyro_mag_std', 'gyro_mag_max']
+    + ['jerk_mean', 'jerk_max', 'jerk_std']
+    + ['accel_energy', 'gyro_energy']
+    + ['accel_x_zcr']
+)
+
+# Classes the firmware acts on
+REQUIRED_CLASSES = ['brake', 'crash']
+
+MAX_NODES = 0xFFFF  # Node indices are uint16_t
+
+
+def parse_args():
+    """Parse command-line arguments."""
+    parser = argparse.ArgumentParser(
+        description='Export a trained Random Forest to a firmware C header'
+    )
+    parser.add_argument(
+        '--model',
+        type=str,
+        default='models/rf_classifier.pkl',
+        help='Trained model from train_classifier.py (scaler is read from <model>_scaler.pkl)'
+    )
+    parser.add_argument(
+        '--output',
+        type=str,
+        default=str(Path(__file__).resolve().parents[2] / 'firmware' / 'include' / 'rf_model.h'),
+        help='Header to write (default: firmware/include/rf_model.h)'
+    )
+    parser.add_argument(
+        '--trees',
+        type=int,
+        default=0,
+        help='Export only the first N trees to save flash (default: all)'
+    )
+    return parser.parse_args()
+
+
+def feature_remap(model):
+    """Map model feature columns onto firmware feature indices."""
+    names = list(getattr(model, 'feature_names_in_', FEATURE_NAMES))
+    missing = set(names) - set(FEATURE_NAMES)
+    if missing:
+        raise ValueError(f"Model uses features the firmware does not compute: {sorted(missing)}")
+    return names, [FEATURE_NAMES.index(n) for n in names]
+
+
+def unscaled_threshold(threshold, column, scaler):
+    """Undo MinMaxScaler: x * scale + min <= t  <=>  x <= (t - min) / scale."""
+    return (threshold - scaler.min_[column]) / scaler.scale_[column]
+
+
+def flatten_forest(model, scaler, remap, n_trees):
+    """Flatten trees into (nodes, roots, leaf_probs, max_depth)."""
+    nodes = []
+    roots = []
+    leaf_probs = []
+    max_depth = 0
+
+    for estimator in model.estimators_[:n_trees]:
+        tree = estimator.tree_
+        base = len(nodes)
+        roots.append(base)
+        max_depth = max(max_depth, tree.max_depth)
+
+        for i in range(tree.node_count):
+            left = tree.children_left[i]
+            if left == -1:
+                probs = tree.value[i][0]
+                probs = probs / probs.sum()
+                nodes.append((0.0, base + i, base + i, len(leaf_probs), 0))
+                leaf_probs.append([int(round(p * 255)) for p in probs])
+            else:
+                column = tree.feature[i]
+                threshold = unscaled_threshold(tree.threshold[i], column, scaler)
+                nodes.append((threshold, base + left, base + tree.children_right[i], 0, remap[column]))
+
+    if len(nodes) > MAX_NODES:
+        raise ValueError(f"{len(nodes)} nodes exceed the uint16_t index range; "
+                         f"export fewer trees with --trees")
+    return nodes, roots, leaf_probs, max_depth
+
+
+def write_header(path, model, nodes, roots, leaf_probs, max_depth):
+    """Write rf_model.h in the layout the firmware expects."""
+    classes = [str(c) for c in model.classes_]
+    for required in REQUIRED_CLASSES:
+        if required not in classes:
+            raise ValueError(f"Model has no '{required}' class (classes: {classes})")
+
+    lines = [
+        '#ifndef RF_MODEL_H',
+        '#define RF_MODEL_H',
+        '',
+        '// ============================================',
+        '// RANDOM FOREST MODEL (generated)',
+        '// ============================================',
+        '//',
+        '// Written by data-analysis/scripts/export_classifier.py - do not edit.',
+        f'// {len(roots)} trees, {len(nodes)} nodes, {len(leaf_probs)} leaves.',
+        '',
+        '#include <stdint.h>',
+        '',
+        '#define RF_MODEL_AVAILABLE 1',
+        '',
+        f'#define RF_WINDOW_SIZE     {EVENT_WINDOW_SIZE}',
+        f'#define RF_SAMPLE_RATE_HZ  {SAMPLE_RATE_HZ}',
+        f'#define RF_NUM_FEATURES    {len(FEATURE_NAMES)}',
+        f'#define RF_NUM_CLASSES     {len(classes)}',
+        f'#define RF_NUM_TREES       {len(roots)}',
+        f'#define RF_MAX_DEPTH       {max_depth}',
+        '',
+    ]
+    for i, name in enumerate(classes):
+        lines.append(f'#define RF_CLASS_{name.upper():<8} {i}')
+    lines += [
+        '',
+        'static const char* const RF_CLASS_NAMES[RF_NUM_CLASSES] = {',
+        '    ' + ', '.join(f'"{c}"' for c in classes),
+        '};',
+        '',
+        'struct RfNode {',
+        '    float threshold;',
+        '    uint16_t left;',
+        '    uint16_t right;',
+        '    uint16_t leaf;',
+        '    uint8_t feature;',
+        '};',
+        '',
+        'static const RfNode RF_NODES[] = {',
+    ]
+    for threshold, left, right, leaf, feature in nodes:
+        lines.append(f'    {{ {float(np.float32(threshold))!r}f, {left}, {right}, {leaf}, {feature} }},')
+    lines += [
+        '};',
+        '',
+        'static const uint16_t RF_TREE_ROOTS[RF_NUM_TREES] = {',
+        '    ' + ', '.join(str(r) for r in roots),
+        '};',
+        '',
+        'static const uint8_t RF_LEAF_PROBS[][RF_NUM_CLASSES] = {',
+    ]
+    for probs in leaf_probs:
+        lines.append('    { ' + ', '.join(str(p) for p in probs) + ' },')
+    lines += [
+        '};',
+        '',
+        '#endif // RF_MODEL_H',
+        '',
+    ]
+    Path(path).write_text('\n'.join(lines))
+
+
+def main():
+    args = parse_args()
+
+    print("=" * 60)
+    print("Luma Helmet - Random Forest Export")
+    print("=" * 60)
+
+    model_path = Path(args.model)
+    scaler_path = model_path.parent / f"{model_path.stem}_scaler.pkl"
+    model = joblib.load(model_path)
+    scaler = joblib.load(scaler_path)
+    print(f"✓ Loaded {len(model.estimators_)} trees from {model_path}")
+
+    names, remap = feature_remap(model)
+    n_trees = args.trees if args.trees > 0 else len(model.estimators_)
+
+    nodes, roots, leaf_probs, max_depth = flatten_forest(model, scaler, remap, n_trees)
+    write_header(args.output, model, nodes, roots, leaf_probs, max_depth)
+
+    flash_kb = (len(nodes) * 12 + len(leaf_probs) * len(model.classes_)) / 1024
+    print(f"✓ {len(roots)} trees, {len(nodes)} nodes, depth {max_depth}, ~{flash_kb:.0f} KB flash")
+    print(f"💾 Wrote {args.output}")
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except ValueError as e:
+        print(f"❌ {e}")
+        sys.exit(1)
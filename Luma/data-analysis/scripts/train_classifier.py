@@ -37,6 +37,7 @@ warnings.filterwarnings('ignore')
 # ===== CONFIGURATION =====
 RANDOM_STATE = 42
 TEST_SIZE = 0.2
+SAMPLE_RATE_HZ = 50
 EVENT_WINDOW_SIZE = 150  # 3 seconds @ 50Hz
 
 # Random Forest Hyperparameters (from report: 77.8% accuracy)
@@ -0,0 +1,68 @@
+#ifndef ADVERTISING_H
+#define ADVERTISING_H
+
+#include <stdint.h>
+#include "config.h"
+#include "power.h"
+
+class NimBLEServer;
+struct ble_gap_conn_desc;
+
+// ============================================
+// ADVERTISING / RECONNECT MANAGER
+// ============================================
+//
+// After boot, a disconnect or a crash the helmet advertises at the fast
+// interval for BLE_ADV_FAST_MS, then backs off to the interval of the
+// power mode (none in sleep). For the first BLE_ADV_RECONNECT_MS after a
+// disconnect only known phones - bonded ones and the one just lost - may
+// connect, so the rider's phone gets the helmet back first after a
+// dropout; scanning stays open to everyone.
+//
+// The advert carries a status byte in its manufacturer data, so the app
+// sees the state and a crash without connecting:
+//   [0xFFFF company id][ADV_STATUS_VERSION][status]
+//   status bits 0-2 HelmetState, bit 3 crash alert, bits 4-7 battery in
+//   10 % steps (0-10, ADV_BATTERY_UNKNOWN without a battery gauge)
+//
+// Connection events and the power mode only set flags; all advertising
+// calls are made by advService() in the telemetry task.
+
+#define ADV_COMPANY_ID       0xFFFF  // Bluetooth SIG "no company" id
+#define ADV_STATUS_VERSION   1
+#define ADV_BATTERY_UNKNOWN  0x0F
+
+#define ADV_STATUS_STATE_MASK  0x07
+#define ADV_STATUS_CRASH       0x08
+#define ADV_STATUS_BATTERY_SHIFT 4
+
+enum AdvPhase {
+    ADV_PHASE_OFF,        // Connected, sleeping or not started
+    ADV_PHASE_RECONNECT,  // Fast, known phones only
+    ADV_PHASE_FAST,       // Fast, anyone
+    ADV_PHASE_SLOW        // Power mode interval, anyone
+};
+
+inline uint8_t advPackStatus(HelmetState state, bool crash, uint8_t batteryTenths) {
+    return (uint8_t)((state & ADV_STATUS_STATE_MASK) |
+                     (crash ? ADV_STATUS_CRASH : 0) |
+                     ((batteryTenths & 0x0F) << ADV_STATUS_BATTERY_SHIFT));
+}
+
+// Set the advert and scan response and start advertising. Call once the
+// GATT services are started.
+void advBegin(NimBLEServer* server, uint8_t status);
+
+// Server callback hooks (BLE host task)
+void advOnConnect(const ble_gap_conn_desc* desc);
+void advOnDisconnect();
+
+// Power mode hook (any task); applied by the next advService()
+void advSetPowerMode(PowerMode mode);
+
+// Telemetry task: move between phases and refresh the status byte
+void advService(uint32_t nowMs, uint8_t status);
+
+AdvPhase advGetPhase();
+
+#endif // ADVERTISING_H
@@ -0,0 +1,83 @@
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "imu_sample.h"
+
+// ============================================
+// BLACK BOX (pre/post-event IMU capture)
+// ============================================
+//
+// The detection task records every raw sample into a RAM ring holding the
+// last BLACKBOX_PRE_MS + BLACKBOX_POST_MS. A trigger (crash) keeps
+// recording for BLACKBOX_POST_MS, then freezes the ring; a low-priority
+// writer task copies it to the "blackbox" flash partition and re-arms.
+// Neither recording nor the trigger ever touches flash.
+//
+// The partition is a circular array of fixed-size slots, one record per
+// slot, so every sector is erased once per lap. A record is a header plus
+// its samples, all little-endian; the header is written last, so a record
+// interrupted by a reset has no header and is ignored.
+
+#define BLACKBOX_MAGIC    0x58424D4CUL  // "LMBX"
+#define BLACKBOX_VERSION  1
+
+enum BlackBoxReason {
+    BLACKBOX_REASON_CRASH = 1
+};
+
+// One raw sample as stored in flash (16 bytes)
+struct BlackBoxSample {
+    uint32_t timestampUs;
+    int16_t accel[3];
+    int16_t gyro[3];
+};
+
+// Record header at the start of each slot (24 bytes)
+struct BlackBoxHeader {
+    uint32_t magic;               // BLACKBOX_MAGIC
+    uint32_t id;                  // Increments per record, survives reboots
+    uint32_t triggerTimestampUs;  // micros() of the trigger sample
+    uint32_t dataCrc;             // CRC-32 of the samples
+    uint8_t version;              // BLACKBOX_VERSION
+    uint8_t reason;               // BlackBoxReason
+    uint16_t sampleRateHz;
+    uint16_t sampleCount;
+    uint16_t triggerIndex;        // First sample recorded after the trigger
+};
+
+static_assert(sizeof(BlackBoxSample) == 16, "BlackBoxSample is a wire format");
+static_assert(sizeof(BlackBoxHeader) == 24, "BlackBoxHeader is a wire format");
+
+// Total stored bytes of a record (header + samples)
+inline uint32_t blackboxRecordLength(const BlackBoxHeader& h) {
+    return sizeof(BlackBoxHeader) + (uint32_t)h.sampleCount * sizeof(BlackBoxSample);
+}
+
+// Find the partition, index existing records and start the writer task.
+// Returns false (and records nothing) if the partition is missing.
+bool blackboxBegin();
+
+// ---- Detection task ----
+
+// Append one sample to the RAM ring (O(1), no flash access)
+void blackboxRecord(const ImuSample& sample);
+
+// Start a capture; returns false if one is already in progress
+bool blackboxTrigger(BlackBoxReason reason);
+
+// ---- Any task (reads flash; keep off the sensing path) ----
+
+// Headers of stored records, oldest first. Returns the number written.
+uint16_t blackboxList(BlackBoxHeader* headers, uint16_t maxHeaders);
+
+// Copy up to `len` bytes of record `id` starting at `offset` (the header
+// comes first). Returns the bytes copied, 0 past the end or if the id is
+// unknown.
+size_t blackboxRead(uint32_t id, uint32_t offset, uint8_t* out, size_t len);
+
+// Ask the writer task to erase all records (asynchronous)
+void blackboxEraseAll();
+
+#endif // BLACKBOX_H
@@ -0,0 +1,66 @@
+#ifndef BLE_LINK_H
+#define BLE_LINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class NimBLEServer;
+struct ble_gap_conn_desc;
+
+// ============================================
+// BLE CONNECTION-PARAMETER MANAGER
+// ============================================
+//
+// Negotiates MTU, connection interval and PHY with the central and keeps
+// track of what was actually granted. The interval follows the telemetry
+// load: a short interval while the batched stream is subscribed, a long
+// one otherwise so an idle connection costs little power. Power-save mode
+// (helmet stationary) overrides both with a slower interval and
+// peripheral latency.
+
+enum LinkProfile {
+    LINK_PROFILE_IDLE,       // Legacy 10 Hz frame / commands only
+    LINK_PROFILE_STREAMING   // Batched full-rate IMU stream
+};
+
+// Negotiated link parameters
+struct LinkParams {
+    uint16_t mtu;                // ATT MTU
+    uint16_t interval;           // Connection interval, 1.25 ms units
+    uint16_t latency;            // Peripheral latency, connection events
+    uint16_t supervisionTimeout; // 10 ms units
+    uint8_t txPhy;               // 1 = 1M, 2 = 2M, 3 = Coded
+    uint8_t rxPhy;
+};
+
+// Packed size of LinkParams on LINK_CHAR_UUID
+#define LINK_PARAMS_LEN 10
+
+// Set the local MTU. Call after NimBLEDevice::init().
+void linkBegin(NimBLEServer* server);
+
+// Server callback hooks
+void linkOnConnect(ble_gap_conn_desc* desc);
+void linkOnDisconnect();
+
+// Request the interval for `profile` if it differs from the current one
+void linkSetProfile(LinkProfile profile);
+
+// Enter / leave power-save parameters (re-requested if connected)
+void linkSetPowerSave(bool enabled);
+
+// Negotiated values, queried from the host stack
+LinkParams linkGetParams();
+
+// Just the ATT MTU (never below 23, also while disconnecting) - cheap
+// enough per frame
+uint16_t linkGetMtu();
+
+// Connection handle, BLE_HS_CONN_HANDLE_NONE when disconnected (for
+// notifications sent straight through the host stack)
+uint16_t linkGetConnHandle();
+
+// Little-endian [mtu][interval][latency][timeout] as u16, then [txPhy][rxPhy]
+size_t linkPackParams(uint8_t* out);
+
+#endif // BLE_LINK_H
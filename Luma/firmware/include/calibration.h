@@ -0,0 +1,71 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+
+// ============================================
+// IMU CALIBRATION (gyro bias + mounting rotation)
+// ============================================
+//
+// Both are estimated once from live data by the detection task and kept
+// in NVS, so a boot with a stored calibration skips straight to riding:
+//
+// - Gyro bias: mean rate over CAL_REST_MS with the helmet still (low
+//   accel and gyro spread).
+// - Mounting: the sensor -> bike rotation from the first CAL_MOUNT_MS of
+//   riding. Up is the mean accel; forward is the dominant horizontal
+//   axis of the accel covariance (speeding up / braking), signed so the
+//   first CAL_SIGN_MS (pulling away) count as speeding up.
+//
+// Corrected samples are in the bike frame: X forward, Y left, Z up.
+//
+// Estimation (calibration.cpp) is hardware-independent; loading and
+// saving (calibration_store.cpp) is firmware only.
+
+#define CALIBRATION_VERSION 1
+
+// Calibration::flags
+#define CALIBRATION_GYRO_BIAS  0x01
+#define CALIBRATION_MOUNTING   0x02
+
+struct Calibration {
+    uint8_t version;        // CALIBRATION_VERSION
+    uint8_t flags;          // CALIBRATION_* parts that are valid
+    float gyroBias[3];      // °/s, sensor frame
+    float rotation[3][3];   // Sensor -> bike, rows = forward, left, up
+};
+
+// Load the stored calibration from NVS (identity / zero bias if there
+// is none). Firmware only.
+void calibrationBegin();
+
+// Install a calibration, or identity / zero bias for nullptr. Call before
+// the detection task runs (boot, native replay).
+void calibrationSet(const Calibration* calibration);
+
+// ---- Detection task ----
+
+// Feed one uncorrected sample (sensor frame, g and °/s). Returns true
+// when a newly estimated part was installed; the output frame changed.
+bool calibrationUpdate(const float accel[3], const float gyro[3]);
+
+// Correct a sample in place: gyro bias, then rotation to the bike frame
+void calibrationApply(float accel[3], float gyro[3]);
+
+// ---- Any task ----
+
+// Forget the current calibration and estimate it again (BLE command)
+void calibrationRestart();
+
+// Telemetry task: write finished calibrations to NVS. Kept off the
+// detection path because a flash write can take tens of milliseconds.
+// Firmware only.
+void calibrationService();
+
+// Next calibration finished (or reset) since the last call, for saving
+bool calibrationTakeFinished(Calibration& calibration);
+
+// CALIBRATION_* parts currently in use
+uint8_t calibrationFlags();
+
+#endif // CALIBRATION_H
@@ -0,0 +1,11 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// Milliseconds since start for the hardware-independent code (state
+// machine, detection). millis() on the helmet (src/clock.cpp); the
+// native replay drives it from sample timestamps (src/host/).
+uint32_t clockMillis();
+
+#endif // CLOCK_H
@@ -0,0 +1,68 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "settings.h"
+
+// ============================================
+// COMMAND PROTOCOL
+// ============================================
+//
+// The BLE callback only parses a write into a CommandFrame and queues
+// it; the control task executes it and sends the ack.
+//
+//   legacy  one byte, a CMD_* code - no ack (current app)
+//   framed  [CMD_FRAME_MAGIC][seq] then up to CMD_MAX_PER_FRAME TLVs
+//           [type][len][value...], executed in order
+//
+// A framed write is answered on the command characteristic with
+// [CMD_FRAME_MAGIC][seq] then per executed command
+// [type][status][len][data...] (CMD_STATUS_*). Commands past
+// CMD_MAX_PER_FRAME get no entry. An ack longer than one indication
+// (ATT MTU - 3) is split between entries: every part repeats the header,
+// with CMD_ACK_CONTINUED instead of the magic on all but the last. Every
+// command is idempotent, so the app can resend a frame whose ack did not
+// arrive.
+
+#define CMD_MAX_PER_FRAME 8
+#define CMD_MAX_VALUE     (1 + SETTING_MAX_LEN)
+
+// Header plus the largest entry (a get) per command
+#define CMD_ACK_MAX (2 + CMD_MAX_PER_FRAME * (3 + 1 + SETTING_MAX_LEN))
+
+// Smallest indication payload (default ATT MTU 23 - 3) fits the header
+// and the largest entry, so a part always makes progress
+static_assert(2 + 3 + 1 + SETTING_MAX_LEN <= 20, "ack entry does not fit the default MTU");
+
+// len for a TLV that overran the write or CMD_MAX_VALUE
+#define CMD_LEN_MALFORMED 0xFF
+
+struct Command {
+    uint8_t type;
+    uint8_t len;
+    uint8_t value[CMD_MAX_VALUE];
+};
+
+struct CommandFrame {
+    bool framed;     // false: legacy single byte, not acked
+    uint8_t seq;
+    uint8_t count;
+    Command commands[CMD_MAX_PER_FRAME];
+};
+
+// Split a write into commands; false if it holds none
+bool commandParse(const uint8_t* data, size_t len, CommandFrame& frame);
+
+// Execute every command in order (control task). Writes the ack into
+// `ack` (CMD_ACK_MAX bytes) and returns its length, 0 for legacy.
+size_t commandExecute(const CommandFrame& frame, uint8_t* ack);
+
+// Next indication of the `len`-byte ack from `pos` (0 for the first
+// part): the header and as many whole entries as fit `maxLen` bytes.
+// Writes the part into `out` and returns its length; `pos` reaches
+// `len` with the last part.
+size_t commandAckPart(const uint8_t* ack, size_t len, size_t& pos, size_t maxLen, uint8_t* out);
+
+#endif // COMMAND_H
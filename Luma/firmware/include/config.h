@@ -9,6 +9,9 @@
 #define PIN_SDA 10
 #define PIN_SCL 8
 
+// MPU6500 INT pin (data-ready interrupt)
+#define PIN_MPU_INT 3
+
 // WS2812B LED Strip
 #define PIN_LED 0
 #define NUM_LEDS 12
@@ -21,17 +24,227 @@
 // Typical crash: 4-10G, we use 4G as threshold
 #define CRASH_G_THRESHOLD 4.0f
 
-// Brake detection - deceleration threshold
-// Normal braking: 0.3-0.8G
+// Crash detector (crash_detector.h). A peak above CRASH_G_THRESHOLD
+// opens an impact window; the impact must carry CRASH_ENERGY_GS of
+// g-seconds above 1 g and be preceded by free fall / tumbling or
+// followed by stillness. Impacts near the ±8g full scale decide at once.
+#define CRASH_SEVERE_G          7.5f  // Near full scale: crash on energy alone
+#define CRASH_IMPACT_MS         100   // Impact window after the peak
+#define CRASH_ENERGY_GS         0.05f // Integral of (|a| - 1 g) over the window
+#define CRASH_FREEFALL_G        0.4f  // |a| below this is free fall
+#define CRASH_FREEFALL_MS       60    // ... for at least this long
+#define CRASH_TUMBLE_DPS        300.0f // |gyro| above this is tumbling
+#define CRASH_PRE_MS            500   // Free fall / tumble this close before the peak
+#define CRASH_SETTLE_MS         1500  // Stillness window after the impact
+#define CRASH_STILL_G           0.2f  // |a| this close to 1 g ...
+#define CRASH_STILL_DPS         45.0f // ... and |gyro| below this is still
+#define CRASH_STILL_PERCENT     60    // Share of the settle window that must be still
+
+// Brake detection - deceleration threshold along the direction of travel
+// (gravity removed by the orientation filter). Normal braking: 0.3-0.8G
 #define BRAKE_G_THRESHOLD 0.5f
 
-// Moving average samples for smoothing
-#define SENSOR_SAMPLE_SIZE 10
+// Moving average samples for smoothing (200 ms @ IMU_SAMPLE_RATE_HZ).
+// Also the longest window the averageSamples setting can select.
+#define SENSOR_SAMPLE_SIZE 40
+
+// Numeric backend for magnitude, averages, thresholds and tilt
+// (numeric.h): 0 = float, 1 = Q16.16 fixed point. Compare both with the
+// benchmark env before changing it.
+#ifndef DETECTION_FIXED_POINT
+#define DETECTION_FIXED_POINT 0
+#endif
+
+// Orientation filter (orientation.h): proportional / integral feedback
+// gains on the gravity error, |a| band around 1 g in which the accel is
+// trusted, and the longest sample gap integrated before re-aligning
+#define ORIENTATION_KP            0.5f
+#define ORIENTATION_KI            0.01f
+#define ORIENTATION_ACCEL_GATE_G  0.1f
+#define ORIENTATION_MAX_DT_S      0.1f
+
+// Speed fusion (speed_fusion.h): process noise of the accel-driven speed
+// and of the bias random walk, fix accuracy assumed when the app sends
+// none (and the floor under what it sends), fix timeout
+#define SPEED_ACCEL_NOISE        0.5f    // (m/s²)² per s
+#define SPEED_BIAS_NOISE         0.005f  // (m/s²)² per s
+#define SPEED_DEFAULT_ACCURACY   1.0f    // m/s
+#define SPEED_MIN_ACCURACY       0.3f    // m/s
+#define SPEED_FIX_TIMEOUT_MS     3000
+
+// Speed-aware braking (only while the speed estimate is valid): no brake
+// light below BRAKE_MIN_SPEED_MPS (head nods at a standstill). After the
+// last braking sample the light stays on BRAKE_HOLD_MIN_MS plus
+// BRAKE_HOLD_MS_PER_MPS per m/s lost since the onset, up to
+// BRAKE_FLASH_DURATION. Without speed the light holds BRAKE_FLASH_DURATION.
+#define BRAKE_MIN_SPEED_MPS      1.5f    // ~5 km/h
+#define BRAKE_HOLD_MIN_MS        600
+#define BRAKE_HOLD_MS_PER_MPS    400
+
+// IMU calibration (calibration.h), estimated once and kept in NVS.
+// Gyro bias: CAL_REST_MS still (|g - 1| <= CAL_REST_MAX_G) with every
+// gyro axis spread below CAL_GYRO_MAX_STD_DPS.
+// Mounting: CAL_MOUNT_MS from the first motion; the dominant horizontal
+// accel axis must carry CAL_MOUNT_MIN_G rms and CAL_MOUNT_MIN_RATIO
+// times the variance of the other one.
+#define CAL_REST_MS             2000
+#define CAL_REST_MAX_G          0.05f
+#define CAL_GYRO_MAX_STD_DPS    0.5f
+#define CAL_GYRO_MAX_BIAS_DPS   20.0f
+#define CAL_MOUNT_MS            10000
+#define CAL_SIGN_MS             3000
+#define CAL_MOUNT_MIN_G         0.05f
+#define CAL_MOUNT_MIN_RATIO     2.0f
+#define CAL_MOUNT_MIN_SIGN_G    0.02f
+#define CAL_NVS_NAMESPACE       "imu_cal"
+
+// On-device Random Forest (active once rf_model.h has been exported from
+// a trained model). Re-classify every N model samples (5 @ 50 Hz = 100 ms)
+// and only act on votes at least this confident (0..255).
+#define RF_HOP_SAMPLES 5
+#define RF_MIN_CONFIDENCE 140
 
 // Crash confirmation timeout (ms)
 // If user doesn't respond within this time, it's a real crash
 #define CRASH_CONFIRMATION_MS 30000  // 30 seconds
 
+// ============================================
+// IMU SAMPLING
+// ============================================
+
+// Sample clock source:
+// 1 = MPU6500 FIFO drained on data-ready interrupt (gap-free, timestamped)
+// 0 = timed register polling from the sampling task (no INT wire needed)
+#define IMU_USE_FIFO 1
+
+// Output data rate; 1 kHz / n, so 1000, 500, 333, 250, 200, ... are exact
+#define IMU_SAMPLE_RATE_HZ 200
+
+// Wake the sampling task every N samples (software FIFO watermark)
+#define IMU_FIFO_WATERMARK 4
+
+// Samples buffered between the sampling and detection tasks
+// (power of two; 128 @ 200 Hz rides out ~640 ms of stalls)
+#define IMU_QUEUE_LENGTH 128
+
+// A missing IMU at boot is probed again this often (telemetry task);
+// sensing starts as soon as it answers
+#define IMU_RETRY_INTERVAL_MS 2000
+
+// Debug builds wait up to this long at boot for a USB serial host, so
+// the setup prints are not lost; other builds do not wait
+#define BOOT_SERIAL_WAIT_MS 1000
+
+// ============================================
+// TASKS
+// ============================================
+
+// Sensing and detection run above the BLE host task so a stalled radio
+// stack can never delay a crash or brake decision. LED rendering and
+// telemetry run below it. Arduino's loop() is priority 1.
+#define TASK_PRIORITY_SAMPLING   (configMAX_PRIORITIES - 1)
+#define TASK_PRIORITY_DETECTION  (configMAX_PRIORITIES - 2)
+#define TASK_PRIORITY_CONTROL    4  // Executes queued app commands
+#define TASK_PRIORITY_LED        3
+#define TASK_PRIORITY_TELEMETRY  2
+#define TASK_PRIORITY_BLACKBOX   1  // Flash writes: only when nothing else runs
+#define TASK_PRIORITY_RIDELOG    1  // Flash writes, as the black box
+#define TASK_PRIORITY_POWER      1
+#define TASK_PRIORITY_LOG        1  // Formats and prints deferred log records
+
+#define TASK_STACK_SAMPLING   3072
+#define TASK_STACK_DETECTION  4096
+#define TASK_STACK_CONTROL    3072
+#define TASK_STACK_LED        2048
+#define TASK_STACK_TELEMETRY  5120  // Also runs the BLE setup
+#define TASK_STACK_BLACKBOX   3072
+#define TASK_STACK_RIDELOG    3072
+#define TASK_STACK_POWER      2048
+#define TASK_STACK_LOG        3072
+
+// Deferred log (log.h): records buffered between drains (power of two),
+// longest formatted line, and how often the log task drains
+#define LOG_QUEUE_SIZE         64
+#define LOG_LINE_MAX           160
+#define LOG_DRAIN_INTERVAL_MS  20
+
+// Messages buffered from detection to telemetry (power of two)
+#define TELEMETRY_QUEUE_LENGTH 16
+
+// Raw samples buffered for the batched BLE stream (power of two)
+#define TELEMETRY_SAMPLE_QUEUE_LENGTH 256
+
+// Print the latency histograms (latency_trace.h) over serial this often;
+// 0 = only on request over BLE
+#define TRACE_REPORT_INTERVAL_MS 60000
+
+// Print the health metrics (metrics.h) over serial this often; 0 = only
+// over BLE
+#define METRICS_REPORT_INTERVAL_MS 60000
+
+// ============================================
+// BLACK BOX
+// ============================================
+
+// Raw IMU kept before a crash trigger and recorded after it
+// (5 s @ 200 Hz = 16 KB RAM, 16 KB flash per record)
+#define BLACKBOX_PRE_MS   3000
+#define BLACKBOX_POST_MS  2000
+
+// Data partition holding the records (see partitions.csv)
+#define BLACKBOX_PARTITION_LABEL "blackbox"
+#define BLACKBOX_MAX_SLOTS 64
+
+// Most download notifications per telemetry task wake-up; the pump
+// stops earlier when the stack runs out of buffers
+#define BLACKBOX_CHUNKS_PER_PUMP 4
+
+// ============================================
+// RIDE LOG
+// ============================================
+
+// Data partition holding the recorded sessions (see partitions.csv)
+// and the most 4 KB blocks indexed in RAM (4 bytes each)
+#define RIDELOG_PARTITION_LABEL "rides"
+#define RIDELOG_MAX_SLOTS 512
+
+// RAM blocks the detection task records into (4 KB each, ~2.3 s of
+// samples). The writer holds flash work back during a brake light or
+// crash alert while at least two are free, so up to ~5 s of braking
+// passes without a flash stall.
+#define RIDELOG_RAM_BLOCKS 4
+
+// How often a writer holding back blocks checks the state again
+#define RIDELOG_DEFER_POLL_MS 50
+
+// Sessions reported by one list command
+#define RIDELOG_MAX_SESSIONS 32
+
+// Most download notifications per telemetry task wake-up; the pump
+// stops earlier when the stack runs out of buffers
+#define RIDELOG_CHUNKS_PER_PUMP 16
+
+// ============================================
+// POWER MANAGEMENT
+// ============================================
+
+// A sample is "still" when |g - 1| and every gyro axis are below these.
+// Still for POWER_IDLE_AFTER_MS in STATE_NORMAL -> idle: IMU in
+// wake-on-motion, detection paused, slow BLE. Idle and disconnected for
+// POWER_SLEEP_AFTER_MS more -> sleep: LEDs off, no advertising, CPU in
+// light sleep until the IMU sees motion.
+#define POWER_STILL_G            0.05f
+#define POWER_STILL_DPS          8.0f
+#define POWER_IDLE_AFTER_MS      30000
+#define POWER_SLEEP_AFTER_MS     60000
+#define POWER_CHECK_INTERVAL_MS  500
+
+// Wake-on-motion: sample-to-sample change that counts as motion, and the
+// low-power accel rate (8 = 62.5 Hz, so motion is seen within 16 ms).
+// Far below the crash threshold: a drop wakes at the start of the fall.
+#define POWER_WAKE_THRESHOLD_MG  64
+#define POWER_WAKE_ODR           8
+
 // ============================================
 // LED ANIMATION SETTINGS
 // ============================================
@@ -40,8 +253,10 @@
 #define BRAKE_FLASH_DURATION 3000   // ms to show brake light
 #define TURN_SIGNAL_SPEED 100       // ms for turn signal animation
 
-// LED brightness (0-255)
+// LED brightness (0-255). The brightness setting cannot go below
+// LED_BRIGHTNESS_MIN, so no BLE write can switch the safety light off.
 #define LED_BRIGHTNESS 150
+#define LED_BRIGHTNESS_MIN 32
 
 // ============================================
 // BLE SETTINGS
@@ -53,7 +268,53 @@
 #define SERVICE_UUID        "19B10000-E8F2-537E-4F6C-D104768A1214"
 #define SENSOR_CHAR_UUID    "19B10001-E8F2-537E-4F6C-D104768A1214"  // Sensor data (notify)
 #define COMMAND_CHAR_UUID   "19B10002-E8F2-537E-4F6C-D104768A1214"  // Commands from app (write)
-#define CRASH_CHAR_UUID     "19B10003-E8F2-537E-4F6C-D104768A1214"  // Crash alert (notify)
+#define CRASH_CHAR_UUID     "19B10003-E8F2-537E-4F6C-D104768A1214"  // Crash events (read + indicate)
+#define TELEMETRY_CHAR_UUID "19B10004-E8F2-537E-4F6C-D104768A1214"  // Batched IMU stream (notify)
+
+#define LINK_CHAR_UUID      "19B10005-E8F2-537E-4F6C-D104768A1214"  // Negotiated link parameters (read)
+#define BLACKBOX_CHAR_UUID  "19B10006-E8F2-537E-4F6C-D104768A1214"  // Black box download (write + notify)
+#define TRACE_CHAR_UUID     "19B10007-E8F2-537E-4F6C-D104768A1214"  // Latency histograms (read, write = reset)
+#define SPEED_CHAR_UUID     "19B10008-E8F2-537E-4F6C-D104768A1214"  // Speed / course fixes from app (write)
+#define RIDE_CHAR_UUID      "19B10009-E8F2-537E-4F6C-D104768A1214"  // Ride log download (write + notify)
+#define HEALTH_CHAR_UUID    "19B1000A-E8F2-537E-4F6C-D104768A1214"  // Health metrics (read, write = reset peaks)
+
+// Batched stream: a partly filled frame is sent after this long, so the
+// radio wakes once per full frame while moving data and never holds a
+// sample longer than this
+#define TELEMETRY_MAX_LATENCY_MS 100
+
+// Local ATT MTU offered to the central. 247 gives 244-byte notifications
+// (16 samples per telemetry frame) and fits one 2M PHY data-length packet.
+#define BLE_PREFERRED_MTU 247
+
+// Connection intervals in 1.25 ms units, within Apple's accessory
+// guidelines (min >= 15 ms, max >= min + 15 ms, timeout 2-6 s).
+// Streaming: one event per telemetry frame at 200 Hz (12-16 samples).
+#define BLE_STREAM_INTERVAL_MIN   12   // 15 ms
+#define BLE_STREAM_INTERVAL_MAX   24   // 30 ms
+// Idle: matches the 10 Hz legacy frame
+#define BLE_IDLE_INTERVAL_MIN     72   // 90 ms
+#define BLE_IDLE_INTERVAL_MAX     96   // 120 ms
+#define BLE_CONN_LATENCY          0    // Keep app commands responsive
+#define BLE_SUPERVISION_TIMEOUT   400  // 4 s, 10 ms units
+// Power save (helmet stationary): commands still arrive within
+// (latency + 1) * max interval = 450 ms
+#define BLE_POWERSAVE_INTERVAL_MIN  96   // 120 ms
+#define BLE_POWERSAVE_INTERVAL_MAX  120  // 150 ms
+#define BLE_POWERSAVE_CONN_LATENCY  2
+
+// Advertising intervals in 0.625 ms units, Apple's recommended steps:
+// fast for BLE_ADV_FAST_MS after boot, a disconnect or a crash, then
+// backed off - less while moving, 1022.5 ms while stationary
+#define BLE_ADV_INTERVAL_FAST_MIN    32    // 20 ms
+#define BLE_ADV_INTERVAL_FAST_MAX    48    // 30 ms
+#define BLE_ADV_INTERVAL_ACTIVE_MIN  244   // 152.5 ms
+#define BLE_ADV_INTERVAL_ACTIVE_MAX  338   // 211.25 ms
+#define BLE_ADV_INTERVAL_IDLE        1636  // 1022.5 ms
+#define BLE_ADV_FAST_MS              30000
+// After a disconnect only bonded phones and the one just lost may
+// connect for this long (advertising.h)
+#define BLE_ADV_RECONNECT_MS         5000
 
 // ============================================
 // BLE COMMANDS (from iOS app)
@@ -66,6 +327,68 @@
 #define CMD_CRASH_FALSE_ALARM 0x05  // User responded - not a real crash
 #define CMD_PARTY_MODE      0x06
 #define CMD_NORMAL_MODE     0x07
+#define CMD_RECALIBRATE     0x08  // Forget IMU calibration and estimate it again
+
+// Framed writes (command.h): [CMD_FRAME_MAGIC][seq] then TLV commands
+// [type][len][value]. Types 0x01-0x08 are the codes above with len 0.
+#define CMD_FRAME_MAGIC     0xA5
+#define CMD_SET_SETTING     0x20  // [id][value] (settings.h)
+#define CMD_GET_SETTING     0x21  // [id] -> ack data [id][value]
+#define CMD_RESET_SETTINGS  0x22  // Back to the config.h defaults
+
+// Per-command status in the ack indication
+#define CMD_STATUS_OK               0x00
+#define CMD_STATUS_UNKNOWN_COMMAND  0x01
+#define CMD_STATUS_BAD_LENGTH       0x02
+#define CMD_STATUS_UNKNOWN_SETTING  0x03
+#define CMD_STATUS_OUT_OF_RANGE     0x04
+
+// First byte of an ack indication that more of the same ack follows
+// (the last or only one starts with CMD_FRAME_MAGIC)
+#define CMD_ACK_CONTINUED   0xA6
+
+// Frames buffered between the BLE callback and the control task (power
+// of two), and how long an unconfirmed ack indication blocks the next
+#define CMD_QUEUE_LENGTH     4
+#define CMD_ACK_TIMEOUT_MS   1000
+
+// Crash events (crash_event.h): events awaiting confirmation by the app,
+// stages buffered from the detection task (power of two), how long an
+// indication may go unconfirmed, and the retry backoff after that
+#define CRASH_OUTBOX_SIZE          4
+#define CRASH_EVENT_QUEUE_LENGTH   4
+#define CRASH_INDICATE_TIMEOUT_MS  1000
+#define CRASH_RETRY_BASE_MS        250
+#define CRASH_RETRY_MAX_MS         8000
+
+// Runtime settings (settings.h) kept in NVS: stored-form version, and
+// how long the settings must stay unchanged before they are written
+// (a slider in the app would otherwise wear the flash)
+#define SETTINGS_NVS_NAMESPACE   "settings"
+#define SETTINGS_SCHEMA_VERSION  1
+#define SETTINGS_SAVE_DELAY_MS   2000
+
+// Black box characteristic: app writes [op](args), helmet answers by notify
+#define BLACKBOX_CMD_LIST   0x01  // -> LIST, then one ENTRY per record
+#define BLACKBOX_CMD_READ   0x02  // [id u32][offset u32] -> DATA..., DONE
+#define BLACKBOX_CMD_ERASE  0x03  // -> ERASED
+
+#define BLACKBOX_RSP_LIST   0x81
+#define BLACKBOX_RSP_ENTRY  0x82
+#define BLACKBOX_RSP_DATA   0x83
+#define BLACKBOX_RSP_DONE   0x84
+#define BLACKBOX_RSP_ERASED 0x85
+
+// Ride log characteristic: same scheme as the black box
+#define RIDELOG_CMD_LIST    0x01  // -> LIST, then one ENTRY per session
+#define RIDELOG_CMD_READ    0x02  // [fromSeq u32][offset u16][toSeq u32] -> DATA..., DONE
+#define RIDELOG_CMD_ERASE   0x03  // -> ERASED
+
+#define RIDELOG_RSP_LIST    0x91
+#define RIDELOG_RSP_ENTRY   0x92
+#define RIDELOG_RSP_DATA    0x93
+#define RIDELOG_RSP_DONE    0x94
+#define RIDELOG_RSP_ERASED  0x95
 
 // ============================================
 // HELMET STATES
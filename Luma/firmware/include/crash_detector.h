@@ -0,0 +1,78 @@
+#ifndef CRASH_DETECTOR_H
+#define CRASH_DETECTOR_H
+
+#include <stdint.h>
+#include "config.h"
+#include "numeric.h"
+
+// ============================================
+// CRASH DETECTOR (full-rate, multi-sample)
+// ============================================
+//
+// Runs on every IMU sample (IMU_SAMPLE_RATE_HZ), so an impact of a few
+// milliseconds still lands on at least one sample:
+//
+//   WATCH   track free fall (|a| < CRASH_FREEFALL_G) and tumbling
+//           (|gyro| > CRASH_TUMBLE_DPS) in the last CRASH_PRE_MS
+//   IMPACT  opened by |a| > CRASH_G_THRESHOLD; for CRASH_IMPACT_MS
+//           integrate (|a| - 1 g) and keep the peak
+//   SETTLE  for CRASH_SETTLE_MS count still samples
+//
+// A crash needs the impact energy plus a free fall / tumble before it
+// or stillness after it. A pothole is a short spike (no energy) with
+// the rider still riding (no stillness). With a fall / tumble, or a
+// peak above CRASH_SEVERE_G, the decision comes as soon as the impact
+// window closes; otherwise after the settle window. Every opened window
+// is decided within CRASH_IMPACT_MS + CRASH_SETTLE_MS.
+//
+// Magnitudes in Math::Value (numeric.h); the gyro comes in as a float
+// squared magnitude, as the calibrated gyro is float in both backends.
+
+// Outcome of one impact window
+struct CrashReport {
+    float peakG;
+    float energyGs;      // g-seconds above 1 g in the impact window
+    bool preSignature;   // Free fall or tumbling before / during the impact
+    bool still;          // Stillness after the impact
+    bool severe;         // Peak above CRASH_SEVERE_G
+    bool crash;          // Decision
+    uint16_t samples;    // Samples from the peak to the decision
+};
+
+template <typename Math>
+class CrashDetector {
+public:
+    typedef typename Math::Value Value;
+
+    CrashDetector();
+
+    void reset();
+
+    // Peak that opens an impact window (the crashG setting, converted
+    // once per change by the caller; CRASH_G_THRESHOLD until set)
+    void setImpactG(Value g) { impactG = g; }
+
+    // One sample: |a| and |gyro|² (°/s). Returns true when an impact
+    // window has been decided; `report` says how.
+    bool update(Value gForce, float gyroSq, CrashReport& report);
+
+    // An impact window is open (decision pending)
+    bool pending() const { return phase != PHASE_WATCH; }
+
+private:
+    enum Phase { PHASE_WATCH, PHASE_IMPACT, PHASE_SETTLE };
+
+    Phase phase;
+    uint16_t phaseSamples;     // Samples since the phase began
+    uint16_t freefallRun;      // Consecutive free-fall samples
+    uint16_t sinceSignature;   // Samples since the last free fall / tumble
+    uint16_t stillSamples;
+    Value impactG;
+    Value peak;
+    Value energy;              // Sum of (|a| - 1 g), g-samples
+    bool preSignature;
+
+    bool decide(bool still, CrashReport& report);
+};
+
+#endif // CRASH_DETECTOR_H
@@ -0,0 +1,113 @@
+#ifndef CRASH_EVENT_H
+#define CRASH_EVENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "crash_detector.h"
+
+// ============================================
+// CRASH EVENTS (CRASH_CHAR_UUID)
+// ============================================
+//
+// Every crash is an event with an id, the time it happened and a summary
+// of the impact. It goes through up to three stages, each sent as an
+// indication on the crash characteristic:
+//   detected   the crash alert starts (byte 0 is the legacy 0x01 alert)
+//   confirmed  nobody answered within the confirmation time
+//   cancelled  the app reported a false alarm
+//
+// Events wait in the outbox until the app confirms them - across
+// disconnects, with backed-off retries while an indication goes
+// unconfirmed - and are sent again as soon as the app subscribes after a
+// reconnect. A later stage replaces an earlier one not yet delivered.
+//
+// Indication (16 bytes, little-endian):
+//   [0]       stage       CRASH_STAGE_*
+//   [1]       flags       CRASH_FLAG_*
+//   [2..3]    id          From 1 at boot, same for every stage of one crash
+//   [4..7]    ageMs       Time since the crash when this indication was sent
+//   [8..9]    peakG       Peak acceleration, 0.01 g
+//   [10..11]  energyGs    Impact energy, 0.001 g·s
+//   [12..13]  pitch       int16, 0.01° at the impact
+//   [14..15]  roll        int16, 0.01° at the impact
+// It fits a 23-byte ATT MTU, so a reconnected phone gets it before the
+// MTU exchange.
+
+#define CRASH_EVENT_LEN 16
+
+enum CrashStage {
+    CRASH_STAGE_DETECTED  = 0x01,
+    CRASH_STAGE_CONFIRMED = 0x02,
+    CRASH_STAGE_CANCELLED = 0x03
+};
+
+#define CRASH_FLAG_PRE_SIGNATURE  0x01  // Free fall or tumbling before the impact
+#define CRASH_FLAG_STILL          0x02  // Stillness after the impact
+#define CRASH_FLAG_SEVERE         0x04  // Peak above CRASH_SEVERE_G
+#define CRASH_FLAG_NO_REPORT      0x08  // Not from the impact rules (classifier): peak and energy are 0
+
+struct CrashEvent {
+    uint16_t id;
+    uint8_t stage;        // CRASH_STAGE_*
+    uint8_t flags;        // CRASH_FLAG_*
+    uint32_t timestampMs; // millis() at the crash
+    float peakG;
+    float energyGs;
+    float pitchDeg;
+    float rollDeg;
+};
+
+// Detected-stage event from the detector's impact report, or with
+// CRASH_FLAG_NO_REPORT if `impact` is null
+CrashEvent crashEventMake(uint16_t id, uint32_t timestampMs, const CrashReport* impact,
+                          float pitchDeg, float rollDeg);
+
+// Indication payload as sent at `nowMs`; returns CRASH_EVENT_LEN
+size_t crashEventEncode(const CrashEvent& event, uint32_t nowMs, uint8_t* out);
+
+// Undelivered events, oldest first, sent one at a time (control task
+// only). The caller indicates the event due() returns, then reports the
+// outcome with confirmed() or failed().
+class CrashOutbox {
+public:
+    CrashOutbox();
+
+    // Queue an event, or a later stage of one already queued. Returns
+    // false if the outbox was full and the oldest event was dropped.
+    bool post(const CrashEvent& event);
+
+    // The event to indicate now; false if none is due or one is in flight
+    bool due(uint32_t nowMs, CrashEvent& event);
+
+    // The app confirmed the indication of due()'s event
+    void confirmed();
+
+    // No confirmation (timeout, link lost, stack busy): retry after a
+    // backoff that doubles per attempt
+    void failed(uint32_t nowMs);
+
+    // A subscriber appeared (connect or reconnect): send everything now
+    void retryNow();
+
+    bool inFlight() const { return sending; }
+    uint8_t pending() const { return count; }
+
+    // Milliseconds until the next event is due, 0 if now, UINT32_MAX if
+    // nothing is waiting for the clock
+    uint32_t msUntilDue(uint32_t nowMs) const;
+
+private:
+    struct Entry {
+        CrashEvent event;
+        uint8_t attempts;
+        uint8_t sentStage;   // Stage of the indication in flight
+        uint32_t nextMs;     // Earliest (re)send
+    };
+
+    Entry entries[CRASH_OUTBOX_SIZE];  // Oldest first
+    uint8_t count;
+    bool sending;                      // entries[0] is in flight
+};
+
+#endif // CRASH_EVENT_H
@@ -0,0 +1,125 @@
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include <stdint.h>
+#include "config.h"
+#include "crash_detector.h"
+#include "filters.h"
+#include "imu_sample.h"
+#include "numeric.h"
+#include "orientation.h"
+#include "rf_classifier.h"
+#include "speed_fusion.h"
+
+// ============================================
+// DETECTION PIPELINE (hardware-independent)
+// ============================================
+//
+// Everything between a raw IMU sample and a state change: unit
+// conversion, calibration, fusion, the brake / crash decision and its
+// dispatch to the state machine. No Arduino or ESP-IDF calls, so the
+// native replay (src/host/replay.cpp) runs exactly this code.
+//
+// Templated over the numeric backend (numeric.h); both FloatMath and
+// FixedMath are instantiated in detection.cpp, DetectionPipeline is the
+// one selected by DETECTION_FIXED_POINT.
+
+// Processed sensor data for one sample
+struct SensorData {
+    float gForce;       // Current G-force magnitude
+    float avgGForce;    // Averaged G-force
+    float accelX;       // Acceleration X (g, bike frame)
+    float accelY;       // Acceleration Y (g)
+    float accelZ;       // Acceleration Z (g)
+    float gyroX;        // Angular rate X (°/s, bias removed)
+    float gyroY;        // Angular rate Y (°/s)
+    float gyroZ;        // Angular rate Z (°/s)
+    float forwardAccel; // Linear acceleration along the heading (g)
+    float avgForwardAccel;
+    float pitch;        // Pitch angle (filled at telemetry rate)
+    float roll;         // Roll angle (filled at telemetry rate)
+    float speedMps;     // Fused speed (speed_fusion.h), if speedValid
+    bool speedValid;    // A phone fix arrived within SPEED_FIX_TIMEOUT_MS
+    bool isBraking;     // Braking detected
+    bool isCrash;       // Crash detected
+};
+
+// detectionDispatch() results
+#define DETECTED_CRASH 0x01  // Entered STATE_CRASH_ALERT
+#define DETECTED_BRAKE 0x02  // Entered STATE_BRAKING
+#define DETECTED_TURN_BRAKE 0x04  // Braking while a turn signal holds the state
+
+template <typename Math>
+class BasicDetectionPipeline {
+public:
+    typedef typename Math::Value Value;
+
+    BasicDetectionPipeline();
+
+    // Forget all filter history (averages, orientation, classifier)
+    void reset();
+
+    // Convert, calibrate and fuse one sample
+    SensorData filter(const ImuSample& sample);
+
+    // Brake / crash decision for the sample just filtered
+    void classify(SensorData& data);
+
+    // Forget the averages after a crash so it cannot trigger twice
+    void resetAverages();
+
+    // Speed / course fix from the phone, applied before the next sample
+    void correctSpeed(const SpeedFix& fix);
+
+    // The last impact window decided since the previous call, crash or
+    // not (for logging outside the per-sample path)
+    bool takeCrashReport(CrashReport& report);
+
+    // Tilt of the last sample (trig, call at telemetry rate)
+    float pitchDeg() const;
+    float rollDeg() const;
+
+private:
+    // Take over the current settings snapshot (thresholds in Value)
+    void applySettings();
+
+    // Take over the fused accel bias (after a fix or a timeout)
+    void applyBias();
+
+    MovingAverage<Value, SENSOR_SAMPLE_SIZE> gForceAverage;
+    MovingAverage<Value, SENSOR_SAMPLE_SIZE> forwardAverage;
+    OrientationFilter orientation;
+    EventClassifier classifier;
+    CrashDetector<Math> crashDetector;
+    SpeedFilter speed;
+    CrashReport crashReport;
+    bool crashReportPending;
+    uint32_t lastSampleUs;
+
+    // Last filtered sample, in Value, for classify()
+    Value gForce;
+    Value avgForwardAccel;
+
+    // Converted once per change instead of per sample (float to Q16.16
+    // is a soft-float multiply)
+    uint32_t settingsSeen;     // settingsGeneration() of brakeG
+    Value brakeG;              // -brakeG setting
+    bool biasValid;            // speed.valid() when forwardBias was taken
+    Value forwardBias;         // speed.biasG()
+};
+
+#if DETECTION_FIXED_POINT
+typedef BasicDetectionPipeline<FixedMath> DetectionPipeline;
+#else
+typedef BasicDetectionPipeline<FloatMath> DetectionPipeline;
+#endif
+
+// Raise the classified sample's events on the state machine; returns the
+// DETECTED_* transitions that happened
+uint8_t detectionDispatch(const SensorData& data);
+
+// End the brake light: BRAKE_FLASH_DURATION after the onset, or with a
+// valid speed a hold scaled by the speed lost (see BRAKE_HOLD_MIN_MS)
+void detectionCheckTimeouts(uint32_t nowMs);
+
+#endif // DETECTION_H
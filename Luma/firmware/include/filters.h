@@ -0,0 +1,239 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stddef.h>
+#include <math.h>
+
+// ============================================
+// HEADER-ONLY SIGNAL FILTERS
+// ============================================
+//
+// Fixed-size, allocation-free filters for the per-sample path. Window
+// lengths are template parameters so buffers live inline in the owning
+// object and loops over the window unroll. Every filter exposes
+//
+//     T update(T x);   // feed one sample, return the filtered value
+//     void reset();    // forget history
+//
+// so filters can be stacked per axis with Cascade<>.
+
+// Running-sum moving average over the last N samples, O(1) per update.
+// Until N samples have been seen the average covers what is available.
+// setLength() shortens the window at run time; N stays the buffer size.
+template <typename T, size_t N>
+class MovingAverage {
+    static_assert(N > 0, "MovingAverage window must not be empty");
+
+public:
+    T update(T x) {
+        sum += x - window[index];
+        window[index] = x;
+
+        if (++index == length) {
+            index = 0;
+            // Re-sum once per window so float rounding cannot accumulate
+            resum();
+        }
+        if (count < length) count++;
+
+        return sum / (T)count;
+    }
+
+    T value() const { return count ? sum / (T)count : T(0); }
+    bool full() const { return count == length; }
+
+    // Window of `n` samples (1..N); forgets history when it changes
+    void setLength(size_t n) {
+        if (n < 1) n = 1;
+        if (n > N) n = N;
+        if (n == length) return;
+        length = n;
+        reset();
+    }
+    size_t getLength() const { return length; }
+
+    void reset() {
+        for (size_t i = 0; i < N; i++) window[i] = T(0);
+        sum = T(0);
+        index = 0;
+        count = 0;
+    }
+
+private:
+    void resum() {
+        T total = T(0);
+        for (size_t i = 0; i < length; i++) total += window[i];
+        sum = total;
+    }
+
+    T window[N] = {};
+    T sum = T(0);
+    size_t index = 0;
+    size_t count = 0;
+    size_t length = N;
+};
+
+// Exponential moving average: y += alpha * (x - y).
+// The first sample initialises the output so there is no start-up ramp.
+template <typename T>
+class Ema {
+public:
+    explicit Ema(T alpha = T(0.1)) : alpha(alpha) {}
+
+    void setAlpha(T a) { alpha = a; }
+
+    T update(T x) {
+        if (!primed) {
+            y = x;
+            primed = true;
+        } else {
+            y += alpha * (x - y);
+        }
+        return y;
+    }
+
+    T value() const { return y; }
+
+    void reset() {
+        y = T(0);
+        primed = false;
+    }
+
+private:
+    T alpha;
+    T y = T(0);
+    bool primed = false;
+};
+
+// Second-order IIR section (RBJ cookbook), transposed direct form II.
+// The response type is a template parameter; coefficients are computed
+// once in setup(), the per-sample cost is 5 multiplies.
+enum BiquadType {
+    BIQUAD_LOWPASS,
+    BIQUAD_HIGHPASS
+};
+
+template <BiquadType Type>
+class Biquad {
+public:
+    Biquad() {}
+    Biquad(float cutoffHz, float sampleRateHz, float q = 0.70710678f) {
+        setup(cutoffHz, sampleRateHz, q);
+    }
+
+    void setup(float cutoffHz, float sampleRateHz, float q = 0.70710678f) {
+        float w0 = 2.0f * (float)M_PI * cutoffHz / sampleRateHz;
+        float cosW0 = cosf(w0);
+        float alpha = sinf(w0) / (2.0f * q);
+        float a0 = 1.0f + alpha;
+
+        if (Type == BIQUAD_LOWPASS) {
+            b0 = (1.0f - cosW0) * 0.5f / a0;
+            b1 = (1.0f - cosW0) / a0;
+        } else {
+            b0 = (1.0f + cosW0) * 0.5f / a0;
+            b1 = -(1.0f + cosW0) / a0;
+        }
+        b2 = b0;
+        a1 = -2.0f * cosW0 / a0;
+        a2 = (1.0f - alpha) / a0;
+        reset();
+    }
+
+    float update(float x) {
+        float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        return y;
+    }
+
+    void reset() {
+        z1 = 0.0f;
+        z2 = 0.0f;
+    }
+
+private:
+    // Defaults to pass-through until setup() is called
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+    float a1 = 0.0f, a2 = 0.0f;
+    float z1 = 0.0f, z2 = 0.0f;
+};
+
+typedef Biquad<BIQUAD_LOWPASS> LowPassFilter;
+typedef Biquad<BIQUAD_HIGHPASS> HighPassFilter;
+
+// Sliding median of the last N samples - rejects single-sample spikes
+// (e.g. I2C glitches) without smearing edges. Keeps the window sorted,
+// so an update is one remove + one insert over N elements; meant for
+// small odd N (3, 5, 7).
+template <typename T, size_t N>
+class Median {
+    static_assert(N % 2 == 1, "Median window must be odd");
+
+public:
+    T update(T x) {
+        if (count < N) {
+            insertSorted(x, count);
+            history[count++] = x;
+        } else {
+            removeSorted(history[oldest]);
+            insertSorted(x, N - 1);
+            history[oldest] = x;
+            if (++oldest == N) oldest = 0;
+        }
+        return sorted[count / 2];
+    }
+
+    T value() const { return count ? sorted[count / 2] : T(0); }
+
+    void reset() {
+        count = 0;
+        oldest = 0;
+    }
+
+private:
+    // Insert into sorted[0..len) keeping order; sorted must have room
+    void insertSorted(T x, size_t len) {
+        size_t i = len;
+        while (i > 0 && sorted[i - 1] > x) {
+            sorted[i] = sorted[i - 1];
+            i--;
+        }
+        sorted[i] = x;
+    }
+
+    // Remove one occurrence of x from the full sorted window
+    void removeSorted(T x) {
+        size_t i = 0;
+        while (i < N - 1 && sorted[i] != x) i++;
+        for (; i < N - 1; i++) sorted[i] = sorted[i + 1];
+    }
+
+    T history[N] = {};  // Insertion order
+    T sorted[N] = {};
+    size_t count = 0;
+    size_t oldest = 0;
+};
+
+// Two filters in series; nest for longer chains, e.g.
+//     Cascade<Median<float, 3>, LowPassFilter> accelX;
+template <typename First, typename Second>
+class Cascade {
+public:
+    template <typename T>
+    T update(T x) { return secondStage.update(firstStage.update(x)); }
+
+    void reset() {
+        firstStage.reset();
+        secondStage.reset();
+    }
+
+    First& first() { return firstStage; }
+    Second& second() { return secondStage; }
+
+private:
+    First firstStage;
+    Second secondStage;
+};
+
+#endif // FILTERS_H
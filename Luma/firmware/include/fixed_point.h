@@ -0,0 +1,54 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+// ============================================
+// FIXED-POINT HELPERS (Q16.16 / Q15)
+// ============================================
+//
+// The ESP32-C3 has no FPU: every float add, multiply and sqrtf is a
+// soft-float library call, while the RV32IM integer multiply and divide
+// are single instructions. These helpers back FixedMath (numeric.h).
+//
+//   Q16.16  int32_t, 1.0 = 65536. Accelerations in g, angles in degrees.
+//   Q15     ratio in [0, 1], 1.0 = 32768 (atan2 table index).
+
+typedef int32_t q16_t;
+
+#define Q16_ONE   65536
+#define Q15_ONE   32768
+
+// Meant for compile-time constants: at run time it is a soft-float
+// multiply, so convert a value once when it changes, not per sample
+constexpr q16_t q16FromFloat(float x) {
+    return (q16_t)(x * (float)Q16_ONE + (x >= 0.0f ? 0.5f : -0.5f));
+}
+
+inline float q16ToFloat(q16_t x) {
+    return x * (1.0f / Q16_ONE);
+}
+
+// floor(sqrt(x)), 16 shift / subtract steps, no multiply
+inline uint32_t isqrt32(uint32_t x) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > x) bit >>= 2;
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// atan2(y, x) in Q16.16 degrees, -180..180. Inputs share any scale.
+// Octant reduction plus a 65-entry table with linear interpolation;
+// error below 0.005°.
+q16_t fixedAtan2Deg(int32_t y, int32_t x);
+
+#endif // FIXED_POINT_H
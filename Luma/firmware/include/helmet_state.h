@@ -0,0 +1,55 @@
+#ifndef HELMET_STATE_H
+#define HELMET_STATE_H
+
+#include <stdint.h>
+#include "config.h"
+
+#define HELMET_STATE_COUNT (STATE_PARTY + 1)
+
+// Inputs to the helmet state machine. App commands, detector outputs and
+// timeouts all go through stateDispatch() so every transition follows the
+// same rules regardless of which task raised it.
+enum HelmetEvent {
+    EVENT_TURN_LEFT_ON,
+    EVENT_TURN_LEFT_OFF,
+    EVENT_TURN_RIGHT_ON,
+    EVENT_TURN_RIGHT_OFF,
+    EVENT_CRASH_FALSE_ALARM,  // User cancelled the crash alert
+    EVENT_PARTY_MODE,
+    EVENT_NORMAL_MODE,
+    EVENT_CRASH_DETECTED,
+    EVENT_BRAKE_DETECTED,
+    EVENT_BRAKE_TIMEOUT
+};
+
+// Pure transition table: state reached from `current` on `event`
+// (returns `current` when the event is ignored in that state)
+HelmetState stateNext(HelmetState current, HelmetEvent event);
+
+// Current state (lock-free, safe from any task)
+HelmetState stateGet();
+
+// Atomically apply `event` to the current state. Returns true if the
+// state changed; `entered` (optional) receives the resulting state.
+// On a change the old state's exit action and the new state's entry
+// action run in the calling task before this returns.
+bool stateDispatch(HelmetEvent event, HelmetState* entered = nullptr);
+
+// millis() at which the current state was entered. Each state times its
+// own timeouts from here, so nothing carries over between states.
+// Published together with the state: whoever sees a state gets its entry
+// time. Exact for states younger than ~6 days.
+uint32_t stateEnteredMs();
+
+// ---- Entry / exit actions ----
+
+// Called with the state being left and the state being entered. Actions
+// may run in any task that dispatches events (detection, BLE host), so
+// they must be short and must not block - e.g. wake a task.
+typedef void (*StateAction)(HelmetState from, HelmetState to);
+
+// Register actions for `state` (either may be null). Call during setup,
+// before events are dispatched.
+void stateSetActions(HelmetState state, StateAction onEnter, StateAction onExit);
+
+#endif // HELMET_STATE_H
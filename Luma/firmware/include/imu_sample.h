@@ -0,0 +1,14 @@
+#ifndef IMU_SAMPLE_H
+#define IMU_SAMPLE_H
+
+#include <stdint.h>
+#include "mpu6500.h"
+
+// Timestamped sample produced by the sampling engine
+struct ImuSample {
+    uint32_t timestampUs;  // Time the sample was taken (micros() clock)
+    uint32_t sequence;     // Increments by one per sensor sample; a jump means samples were lost
+    ImuRawSample raw;
+};
+
+#endif // IMU_SAMPLE_H
@@ -0,0 +1,84 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <hal/cpu_hal.h>
+
+// ============================================
+// LATENCY TRACING (IMU sample -> brake light)
+// ============================================
+//
+// Always compiled in. Timestamps are CPU cycle counts; every stage is
+// recorded as the time since the sample's data-ready edge (its origin),
+// into a per-stage log-bucket histogram (min / avg / p99 / max).
+//
+// Per sample (detection task):
+//   ACQUIRED    sample dequeued by the detection task (FIFO + queue wait)
+//   FILTERED    unit conversion and filters done
+//   CLASSIFIED  brake / crash decision made
+// Per detected event (brake or crash that changed state):
+//   TRANSITION  state machine updated
+//   RENDERED    LED task rendered the new pattern's first frame
+//   LATCHED     RMT finished sending that frame (the strip latches after
+//               its reset time, ~50-300 us depending on the part)
+// Per ride log flash operation (ride log writer task), the time the call
+// held the flash - and with it the cache, stalling every task running
+// from flash; ACQUIRED shows what that does to the samples:
+//   RIDE_ERASE  one 4 KB sector erase
+//   RIDE_WRITE  one page program (up to 256 bytes)
+//
+// Each stage has a single writer task; readers get a best-effort copy.
+
+enum TraceStage {
+    TRACE_ACQUIRED,
+    TRACE_FILTERED,
+    TRACE_CLASSIFIED,
+    TRACE_TRANSITION,
+    TRACE_RENDERED,
+    TRACE_LATCHED,
+    TRACE_RIDE_ERASE,
+    TRACE_RIDE_WRITE,
+    TRACE_STAGE_COUNT
+};
+
+struct TraceStats {
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t avgUs;
+    uint32_t p99Us;  // Upper edge of the p99 bucket (<= 19% above the true value)
+    uint32_t maxUs;
+};
+
+// [version][stages] + per stage [count][min][avg][p99][max] as u32 LE
+#define TRACE_PACKED_VERSION 1
+#define TRACE_PACKED_LEN (2 + TRACE_STAGE_COUNT * 20)
+
+inline uint32_t traceNow() {
+    return cpu_hal_get_cycle_count();
+}
+
+void traceBegin();
+
+// Origin (in cycles) of a sample stamped with micros() at `timestampUs`
+uint32_t traceOrigin(uint32_t timestampUs);
+
+// Record `stage` as the time from `origin` to `now` (cycles)
+void traceRecord(TraceStage stage, uint32_t origin, uint32_t now = traceNow());
+
+// ---- Detection -> LED hand-off ----
+
+// A detected event changed the state; the LED task traces its frame
+void traceEventBegin(uint32_t origin);
+
+// LED task: take the pending event origin, if any
+bool traceEventTake(uint32_t& origin);
+
+// ---- Readout ----
+
+TraceStats traceGetStats(TraceStage stage);
+void traceReset();
+size_t tracePack(uint8_t* out);
+void tracePrint();
+
+#endif // LATENCY_TRACE_H
@@ -0,0 +1,45 @@
+#ifndef LED_ENGINE_H
+#define LED_ENGINE_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ============================================
+// LED ANIMATION ENGINE
+// ============================================
+//
+// Each helmet state maps to a pattern: a frame time and a table of
+// frames, indexed by time since the state was entered. update() renders
+// into a back buffer and starts an RMT transfer only when the frame index
+// has moved on, so between frames it costs one division. Layers (the
+// brake light during a turn signal) are patterns of their own, blended
+// over the state's frame.
+
+// Shown instead of the STATE_NORMAL pattern; any other state (brake,
+// crash, turn signals) takes precedence
+enum LedOverlay : uint8_t {
+    LED_OVERLAY_NONE,
+    LED_OVERLAY_STARTUP,       // Green sweep, plays once (cut short by any event)
+    LED_OVERLAY_SENSOR_FAULT   // Slow red blink while the IMU is missing
+};
+
+// Start the RMT output; returns false if the peripheral is unavailable
+bool ledEngineBegin();
+
+// Render the frame for `state` at `nowMs` if it is due. Returns the
+// milliseconds until the next frame is due.
+uint32_t ledEngineUpdate(HelmetState state, uint32_t nowMs);
+
+// Show all-off instead of the state's pattern (power manager sleep).
+// Takes effect on the next update; clearing it restarts the pattern.
+void ledEngineSetBlank(bool blank);
+
+// Select the overlay (any task); takes effect on the next update
+void ledEngineSetOverlay(LedOverlay overlay);
+
+// Show the brake light over a turn signal until `untilMs` (any task;
+// extending a running hold keeps its flash phase). Returns true if the
+// layer was off, i.e. the caller should wake the LED task.
+bool ledEngineHoldBrake(uint32_t nowMs, uint32_t untilMs);
+
+#endif // LED_ENGINE_H
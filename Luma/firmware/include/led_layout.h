@@ -0,0 +1,45 @@
+#ifndef LED_LAYOUT_H
+#define LED_LAYOUT_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ============================================
+// LED LAYOUT (compile-time geometry)
+// ============================================
+//
+// Where each effect draws, derived from the strip length. The strip runs
+// across the back of the helmet, left end first; a second strip chained
+// on the same data line is the same layout with the combined length.
+// Every index is a template constant, so the render loops unroll to
+// fixed stores whatever NUM_LEDS is.
+
+// `Count` LEDs counted from `Origin` in steps of `Stride` (segment index
+// 0 is the origin LED)
+template <uint16_t Origin, uint16_t Count, int Stride>
+struct LedSegment {
+    static constexpr uint16_t count = Count;
+    static constexpr uint16_t at(uint16_t i) { return (uint16_t)(Origin + Stride * (int)i); }
+};
+
+template <uint16_t N>
+struct LedLayout {
+    static_assert(N >= 6 && N % 2 == 0, "LED layout needs an even strip of at least 6 LEDs");
+
+    static constexpr uint16_t count = N;
+
+    // Turn signal halves, counted from the centre outwards (12 LEDs:
+    // left 5..0, right 6..11)
+    typedef LedSegment<N / 2 - 1, N / 2, -1> Left;
+    typedef LedSegment<N / 2, N / 2, 1> Right;
+
+    // Middle third, the running light (12 LEDs: 4..7)
+    typedef LedSegment<N / 2 - N / 6, 2 * (N / 6), 1> Center;
+
+    // The whole strip faces backwards: brake, crash and party
+    typedef LedSegment<0, N, 1> Rear;
+};
+
+typedef LedLayout<NUM_LEDS> Layout;
+
+#endif // LED_LAYOUT_H
@@ -0,0 +1,104 @@
+#ifndef LED_PATTERNS_H
+#define LED_PATTERNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "led_strip.h"
+
+// ============================================
+// COMPILE-TIME LED FRAME TABLES
+// ============================================
+//
+// Each animation is a periodic sequence of frames at a fixed frame time.
+// The per-frame data (brightness curve, colour wheel, lit-LED masks) is
+// generated by constexpr functions into static tables, so rendering a
+// frame is a table lookup per pixel. Tables that depend on the strip
+// length take it from the layout (led_layout.h).
+
+// ---- Table builder (C++11 has no std::index_sequence) ----
+
+template <size_t... I> struct Indices {};
+template <size_t N, size_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+template <typename T, size_t N>
+struct FrameTable {
+    T frames[N];
+    constexpr size_t size() const { return N; }
+    constexpr const T& operator[](size_t i) const { return frames[i]; }
+};
+
+// ---- Normal: breathing red, 30..100 in steps of 2, starting at 52 ----
+
+#define BREATH_FRAMES 70
+
+constexpr uint8_t breathLevel(size_t frame) {
+    return ((frame + 11) % BREATH_FRAMES) <= BREATH_FRAMES / 2
+        ? 30 + 2 * ((frame + 11) % BREATH_FRAMES)
+        : 30 + 2 * (BREATH_FRAMES - (frame + 11) % BREATH_FRAMES);
+}
+
+template <size_t... I>
+constexpr FrameTable<uint8_t, sizeof...(I)> makeBreath(Indices<I...>) {
+    return {{ breathLevel(I)... }};
+}
+
+// ---- Turn signals: sweep outwards twice, then hold ----
+// Length of the lit run on a half of `half` LEDs, from the centre. The
+// first 2 * half frames grow it by one LED per frame (restarting after
+// `half`); the TURN_HOLD_FRAMES after that hold the full run for the
+// pause between cycles.
+
+#define TURN_HOLD_FRAMES  2
+
+constexpr size_t turnFrames(size_t half) {
+    return 2 * half + TURN_HOLD_FRAMES;
+}
+
+constexpr uint8_t turnRun(size_t frame, size_t half) {
+    return (uint8_t)(frame < 2 * half ? frame % half + 1 : half);
+}
+
+template <size_t Half, size_t... I>
+constexpr FrameTable<uint8_t, sizeof...(I)> makeTurn(Indices<I...>) {
+    return {{ turnRun(I, Half)... }};
+}
+
+// ---- Party: HSV colour wheel (full saturation, value 200) ----
+// Same sector maths as Adafruit_NeoPixel::ColorHSV
+
+constexpr uint16_t wheelHue(size_t h) {
+    return (uint16_t)(((uint32_t)h * 256u * 1530u + 32768u) / 65536u);
+}
+
+constexpr uint8_t wheelScale(uint16_t c) {
+    return (uint8_t)((c * 201u) >> 8);
+}
+
+constexpr uint16_t wheelRed(uint16_t h) {
+    return h < 255 ? 255 : h < 510 ? 510 - h : h < 1020 ? 0 : h < 1275 ? h - 1020 : h < 1530 ? 255 : 255;
+}
+
+constexpr uint16_t wheelGreen(uint16_t h) {
+    return h < 255 ? h : h < 765 ? 255 : h < 1020 ? 1020 - h : 0;
+}
+
+constexpr uint16_t wheelBlue(uint16_t h) {
+    return h < 510 ? 0 : h < 765 ? h - 510 : h < 1275 ? 255 : h < 1530 ? 1530 - h : 0;
+}
+
+constexpr Rgb wheelColour(size_t h) {
+    return Rgb{ wheelScale(wheelRed(wheelHue(h))),
+                wheelScale(wheelGreen(wheelHue(h))),
+                wheelScale(wheelBlue(wheelHue(h))) };
+}
+
+template <size_t... I>
+constexpr FrameTable<Rgb, sizeof...(I)> makeWheel(Indices<I...>) {
+    return {{ wheelColour(I)... }};
+}
+
+#define WHEEL_SIZE 256
+
+#endif // LED_PATTERNS_H
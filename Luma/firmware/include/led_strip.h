@@ -0,0 +1,43 @@
+#ifndef LED_STRIP_H
+#define LED_STRIP_H
+
+#include <stdint.h>
+
+// ============================================
+// WS2812B OUTPUT (RMT, asynchronous)
+// ============================================
+//
+// Frames are encoded into RMT symbols and handed to the RMT peripheral,
+// which clocks them out on its own; the CPU is free and interrupts stay
+// enabled while the strip updates. A frame takes ~0.4 ms on the wire for
+// 12 LEDs.
+
+struct Rgb {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+// Configure the RMT channel for NUM_LEDS pixels on PIN_LED
+bool ledStripBegin();
+
+// Global brightness (0-255), applied when a frame is encoded
+void ledStripSetBrightness(uint8_t brightness);
+
+// True while the previous frame is still being sent
+bool ledStripBusy();
+
+// Start sending NUM_LEDS pixels; returns immediately. Returns false (and
+// drops the frame) if the previous one is still on the wire.
+bool ledStripShow(const Rgb* pixels);
+
+// Whole strip one colour (setup and error paths)
+bool ledStripFill(Rgb colour);
+
+// Frames handed to the RMT / completely sent since boot, and the cycle
+// count at which the last one finished (latency tracing)
+uint32_t ledStripFramesStarted();
+uint32_t ledStripFramesSent();
+uint32_t ledStripLastSentCycles();
+
+#endif // LED_STRIP_H
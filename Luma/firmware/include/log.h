@@ -0,0 +1,160 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// ============================================
+// DEFERRED LOGGING
+// ============================================
+//
+// LOG_E / LOG_W / LOG_I / LOG_D take a printf format and up to
+// LOG_MAX_ARGS arguments. Levels above LOG_LEVEL compile to nothing -
+// the arguments are not even evaluated.
+//
+// An enabled call does no formatting and no I/O: it copies the format
+// pointer, a timestamp and the raw argument words into a lock-free ring
+// (mpsc_queue.h). The log task formats and prints them at the lowest
+// priority. A full ring drops the record and counts it, so a log call
+// never blocks.
+//
+// Arguments: integers up to 32 bits, float / double (stored as float),
+// and strings that outlive the call (literals, const tables) - only the
+// pointer is kept.
+//
+// LOG_LEVEL follows CORE_DEBUG_LEVEL: the default env logs INFO, the
+// -release env (CORE_DEBUG_LEVEL=0) compiles all of it out.
+
+#define LOG_LEVEL_NONE     0
+#define LOG_LEVEL_ERROR    1
+#define LOG_LEVEL_WARN     2
+#define LOG_LEVEL_INFO     3
+#define LOG_LEVEL_DEBUG    4
+
+#ifndef LOG_LEVEL
+#ifdef CORE_DEBUG_LEVEL
+#define LOG_LEVEL CORE_DEBUG_LEVEL
+#else
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#define LOG_MAX_ARGS 8
+
+enum LogArgType : uint8_t {
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_FLOAT,
+    LOG_ARG_STRING
+};
+
+// One argument word: integers and float bits, or a string pointer
+union LogValue {
+    uint32_t bits;
+    const char* string;
+};
+
+struct LogArg {
+    LogValue value;
+    LogArgType type;
+};
+
+// Start the drain task (no-op when logging is compiled out)
+bool logBegin();
+
+// Records dropped because the ring was full, since boot
+uint32_t logDropped();
+
+// Queue one record (use the LOG_* macros)
+void logPush(uint8_t level, const char* format, const LogArg* args, uint8_t count);
+
+// ---- Argument packing ----
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, LogArg>::type
+logArg(T value) {
+    static_assert(sizeof(T) <= 4, "64-bit log arguments are not supported");
+    LogArg arg;
+    arg.value.bits = (uint32_t)(int32_t)value;
+    arg.type = LOG_ARG_INT;
+    return arg;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, LogArg>::type
+logArg(T value) {
+    static_assert(sizeof(T) <= 4, "64-bit log arguments are not supported");
+    LogArg arg;
+    arg.value.bits = (uint32_t)value;
+    arg.type = LOG_ARG_UINT;
+    return arg;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value, LogArg>::type
+logArg(T value) {
+    LogArg arg;
+    arg.value.bits = (uint32_t)(int32_t)value;
+    arg.type = LOG_ARG_INT;
+    return arg;
+}
+
+inline LogArg logArg(float value) {
+    union { float f; uint32_t u; } pun;
+    pun.f = value;
+    LogArg arg;
+    arg.value.bits = pun.u;
+    arg.type = LOG_ARG_FLOAT;
+    return arg;
+}
+
+inline LogArg logArg(double value) {
+    return logArg((float)value);
+}
+
+inline LogArg logArg(const char* value) {
+    LogArg arg;
+    arg.value.string = value;
+    arg.type = LOG_ARG_STRING;
+    return arg;
+}
+
+inline void logWrite(uint8_t level, const char* format) {
+    logPush(level, format, nullptr, 0);
+}
+
+template <typename... Args>
+inline void logWrite(uint8_t level, const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    const LogArg packed[] = { logArg(args)... };
+    logPush(level, format, packed, sizeof...(Args));
+}
+
+// ---- Macros ----
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_W(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) do {} while (0)
+#endif
+
+#endif // LOG_H
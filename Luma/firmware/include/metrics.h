@@ -0,0 +1,87 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================
+// HEALTH METRICS (HEALTH_CHAR_UUID)
+// ============================================
+//
+// Atomic counters and peak gauges bumped where things happen, levels
+// set by the task that owns a queue, plus values read when the frame is
+// packed (sampling stats, heap, task stacks). Counters only grow; the
+// app logs the frame and takes differences. Peaks are reset by a write
+// to the characteristic.
+//
+// Frame (all little-endian):
+//   [0]  version           METRICS_PACKED_VERSION
+//   [1]  tasks             Entries in the stack list at the end
+//   then u32 each:
+//     uptimeMs
+//     samplesTaken       Delivered + dropped by the sampling engine
+//     samplesExpected    IMU_SAMPLE_RATE_HZ x time at full rate
+//     sampleQueueDrops   Detection task fell behind
+//     fifoOverflows      MPU FIFO overrun and reset
+//     i2cErrors          Failed I2C transactions with the MPU
+//     detectionMaxUs     Longest detection batch
+//     detectionOverruns  Batches that took longer than their samples span
+//     ledFrameMaxUs      Longest LED render + encode
+//     notifyOk           Notifications / indications delivered to the stack
+//     notifyFailed       ... rejected by it (or indications unconfirmed)
+//     freeHeap
+//     minFreeHeap        Low-water mark since boot
+//     streamQueueDepth   Samples waiting for the telemetry frame
+//     streamQueueMax     Highest depth (of TELEMETRY_SAMPLE_QUEUE_LENGTH)
+//     crashOutboxPending Crash event indications not yet confirmed
+//   then per task (METRICS_TASK_NAMES order) u16 stack bytes never used,
+//   0xFFFF if the task is not running
+
+#define METRICS_PACKED_VERSION 2
+
+#define METRICS_TASK_COUNT 9
+#define METRICS_TASK_NAMES { "sampling", "detection", "control", "leds", "telemetry", \
+                             "blackbox", "ridelog", "power", "log" }
+
+#define METRICS_PACKED_LEN (2 + 16 * 4 + METRICS_TASK_COUNT * 2)
+
+enum MetricCounter {
+    METRIC_I2C_ERRORS,
+    METRIC_DETECTION_OVERRUNS,
+    METRIC_NOTIFY_OK,
+    METRIC_NOTIFY_FAILED,
+    METRIC_COUNTER_COUNT
+};
+
+enum MetricPeak {
+    METRIC_DETECTION_MAX_US,
+    METRIC_LED_FRAME_MAX_US,
+    METRIC_STREAM_QUEUE_MAX,
+    METRIC_PEAK_COUNT
+};
+
+enum MetricLevel {
+    METRIC_STREAM_QUEUE_DEPTH,
+    METRIC_CRASH_OUTBOX_PENDING,
+    METRIC_LEVEL_COUNT
+};
+
+// Any task, lock-free
+void metricsCount(MetricCounter counter, uint32_t n = 1);
+void metricsPeak(MetricPeak peak, uint32_t value);
+void metricsSetLevel(MetricLevel level, uint32_t value);
+
+// Full-rate sampling started or stopped (sensing start, power mode
+// hook); the time at full rate gives the expected sample count
+void metricsSetSampling(bool active);
+
+// ---- Readout ----
+
+uint32_t metricsGet(MetricCounter counter);
+uint32_t metricsGetPeak(MetricPeak peak);
+uint32_t metricsGetLevel(MetricLevel level);
+void metricsResetPeaks();
+size_t metricsPack(uint8_t* out);
+void metricsPrint();
+
+#endif // METRICS_H
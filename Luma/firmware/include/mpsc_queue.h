@@ -0,0 +1,76 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free multi-producer / single-consumer ring buffer (bounded,
+// per-slot sequence numbers).
+//
+// Any number of tasks may push(); exactly one task may pop(). Producers
+// claim a slot with one compare-and-swap and never wait on each other or
+// on the consumer. A producer preempted between claiming and filling its
+// slot only delays the consumer at that slot - nothing is lost or torn.
+// N must be a power of two.
+template <typename T, size_t N>
+class MpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscQueue size must be a power of two");
+
+public:
+    MpscQueue() {
+        for (size_t i = 0; i < N; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any task. Returns false (item dropped) when the queue is full.
+    bool push(const T& item) {
+        size_t write = writeIndex.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[write & (N - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)write;
+            if (diff == 0) {
+                if (writeIndex.compare_exchange_weak(write, write + 1, std::memory_order_relaxed)) {
+                    slot.item = item;
+                    slot.sequence.store(write + 1, std::memory_order_release);
+                    return true;
+                }
+                // Lost the slot to another producer; `write` was reloaded
+            } else if (diff < 0) {
+                return false;
+            } else {
+                write = writeIndex.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side. Returns false when the queue is empty (or the next
+    // slot is still being filled).
+    bool pop(T& item) {
+        Slot& slot = slots[readIndex & (N - 1)];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)sequence - (intptr_t)(readIndex + 1) < 0) {
+            return false;
+        }
+        item = slot.item;
+        slot.sequence.store(readIndex + N, std::memory_order_release);
+        readIndex++;
+        return true;
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Slot slots[N];
+    std::atomic<size_t> writeIndex{0};
+    size_t readIndex = 0;  // Consumer only
+};
+
+#endif // MPSC_QUEUE_H
@@ -0,0 +1,122 @@
+#ifndef MPU6500_H
+#define MPU6500_H
+
+#include <stdint.h>
+
+// ============================================
+// MPU6500 REGISTER MAP (subset used by firmware)
+// ============================================
+
+#define MPU6500_I2C_ADDR        0x68
+
+#define MPU6500_REG_SMPLRT_DIV    0x19
+#define MPU6500_REG_CONFIG        0x1A
+#define MPU6500_REG_GYRO_CONFIG   0x1B
+#define MPU6500_REG_ACCEL_CONFIG  0x1C
+#define MPU6500_REG_ACCEL_CONFIG2 0x1D
+#define MPU6500_REG_LP_ACCEL_ODR  0x1E
+#define MPU6500_REG_WOM_THR       0x1F
+#define MPU6500_REG_FIFO_EN       0x23
+#define MPU6500_REG_INT_PIN_CFG   0x37
+#define MPU6500_REG_INT_ENABLE    0x38
+#define MPU6500_REG_INT_STATUS    0x3A
+#define MPU6500_REG_ACCEL_XOUT_H  0x3B  // First byte of the 14-byte data block
+#define MPU6500_REG_ACCEL_INTEL_CTRL 0x69
+#define MPU6500_REG_USER_CTRL     0x6A
+#define MPU6500_REG_PWR_MGMT_1    0x6B
+#define MPU6500_REG_PWR_MGMT_2    0x6C
+#define MPU6500_REG_FIFO_COUNTH   0x72
+#define MPU6500_REG_FIFO_R_W      0x74
+
+// INT_STATUS bits
+#define MPU6500_INT_WOM           0x40
+#define MPU6500_INT_FIFO_OFLOW    0x10
+#define MPU6500_INT_RAW_RDY       0x01
+
+// ACCEL_XOUT_H .. GYRO_ZOUT_L = accel(6) + temp(2) + gyro(6)
+#define MPU6500_DATA_BLOCK_LEN  14
+
+// On-chip FIFO. With accel+temp+gyro enabled each FIFO packet has the
+// same layout as the data block above.
+#define MPU6500_FIFO_SIZE       512
+#define MPU6500_INTERNAL_RATE_HZ 1000  // Internal sample rate with DLPF enabled
+
+// Wake-on-motion threshold resolution and LP_ACCEL_ODR codes
+// (0.24 Hz * 2^code, code 0..11)
+#define MPU6500_WOM_MG_PER_LSB  4
+#define MPU6500_LP_ODR_31HZ     7
+#define MPU6500_LP_ODR_62HZ     8
+#define MPU6500_LP_ODR_125HZ    9
+
+// ============================================
+// SCALE FACTORS (match ranges set in mpuConfigure)
+// ============================================
+
+#define MPU6500_ACCEL_LSB_PER_G    4096.0f  // ±8g
+#define MPU6500_GYRO_LSB_PER_DPS   65.5f    // ±500°/s
+
+// Raw sample as read from the sensor (big-endian registers already decoded)
+struct ImuRawSample {
+    int16_t accelX;
+    int16_t accelY;
+    int16_t accelZ;
+    int16_t temperature;
+    int16_t gyroX;
+    int16_t gyroY;
+    int16_t gyroZ;
+};
+
+// Returns true if the MPU6500 ACKs its I2C address
+bool mpuProbe();
+
+// Gyro start-up time after leaving sleep (datasheet: 35 ms typical)
+#define MPU6500_GYRO_STARTUP_MS 35
+
+// Wake the sensor and set ±8g accel / ±500°/s gyro ranges. Waits
+// MPU6500_GYRO_STARTUP_MS so the first samples are settled.
+void mpuConfigure();
+
+// Write a single register
+void mpuWriteRegister(uint8_t reg, uint8_t value);
+
+// Burst-read `len` consecutive registers starting at `reg`.
+// Returns false on a short read (buffer contents are then undefined).
+bool mpuReadRegisters(uint8_t reg, uint8_t* buffer, uint8_t len);
+
+// Read accel, temperature and gyro in a single I2C transaction
+bool mpuReadSample(ImuRawSample& sample);
+
+// Decode one 14-byte data block / FIFO packet
+void mpuDecodeSample(const uint8_t* raw, ImuRawSample& sample);
+
+// ---- FIFO + data-ready interrupt ----
+
+// Set sample-rate divider for `rateHz` (1000 / n), enable DLPF, route
+// accel+temp+gyro to the FIFO and raise INT on every new sample.
+void mpuConfigureFifo(uint16_t rateHz);
+
+// Clear FIFO contents and re-enable it
+void mpuResetFifo();
+
+// Number of bytes currently in the FIFO, or -1 on I2C error
+int mpuReadFifoCount();
+
+// Read INT_STATUS (clears the latched status bits)
+uint8_t mpuReadIntStatus();
+
+// Burst-read `count` packets from the FIFO. Returns the number of
+// samples decoded into `samples` (stops early on a short read).
+uint16_t mpuReadFifo(ImuRawSample* samples, uint16_t count);
+
+// ---- Wake-on-motion (low-power accel) ----
+
+// Gyro to standby, accel duty-cycled at `lpOdr` (MPU6500_LP_ODR_*), FIFO
+// off. INT goes high and stays latched when any axis changes by more than
+// `thresholdMg` between samples; reading INT_STATUS clears it.
+void mpuEnableWakeOnMotion(uint16_t thresholdMg, uint8_t lpOdr);
+
+// Leave the low-power cycle with gyro and accel running. Follow with
+// mpuConfigureFifo(); the gyro needs ~35 ms to settle.
+void mpuDisableWakeOnMotion();
+
+#endif // MPU6500_H
@@ -0,0 +1,72 @@
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+#include <stdint.h>
+#include <math.h>
+#include "fixed_point.h"
+#include "mpu6500.h"
+
+// ============================================
+// NUMERIC BACKENDS (detection pipeline)
+// ============================================
+//
+// BasicDetectionPipeline<Math> (detection.h) does its magnitude,
+// averaging, thresholds and tilt in Math::Value:
+//
+//   FloatMath  float g, sqrtf / atan2f (soft-float on the ESP32-C3)
+//   FixedMath  Q16.16 g, integer sqrt on the raw counts, table atan2
+//
+// The Mahony fusion and the calibration rotation stay float in both.
+// DETECTION_FIXED_POINT (config.h) picks the one the firmware runs; the
+// benchmark env times both.
+
+struct FloatMath {
+    typedef float Value;
+
+    static constexpr Value fromFloat(float x) { return x; }
+    static float toFloat(Value x) { return x; }
+
+    // |a| in g, rotation-invariant so it does not need calibration
+    static Value magnitude(const ImuRawSample& raw) {
+        float x = raw.accelX / MPU6500_ACCEL_LSB_PER_G;
+        float y = raw.accelY / MPU6500_ACCEL_LSB_PER_G;
+        float z = raw.accelZ / MPU6500_ACCEL_LSB_PER_G;
+        return sqrtf(x * x + y * y + z * z);
+    }
+
+    // atan2(a, sqrt(b² + c²)) in degrees - pitch / roll from gravity
+    static float tiltDeg(float a, float b, float c) {
+        return atan2f(a, sqrtf(b * b + c * c)) * 57.29578f;
+    }
+};
+
+struct FixedMath {
+    typedef q16_t Value;
+
+    // Q16.16 per raw accel count
+    static constexpr int32_t ACCEL_Q16_PER_LSB = Q16_ONE / (int32_t)MPU6500_ACCEL_LSB_PER_G;
+    static_assert(ACCEL_Q16_PER_LSB * (int32_t)MPU6500_ACCEL_LSB_PER_G == Q16_ONE,
+                  "accel LSB/g must divide Q16_ONE");
+
+    static constexpr Value fromFloat(float x) { return q16FromFloat(x); }
+    static float toFloat(Value x) { return q16ToFloat(x); }
+
+    static Value magnitude(const ImuRawSample& raw) {
+        // Three int16 squares fit an unsigned 32-bit sum (< 3.3e9)
+        uint32_t sum = (uint32_t)((int32_t)raw.accelX * raw.accelX) +
+                       (uint32_t)((int32_t)raw.accelY * raw.accelY) +
+                       (uint32_t)((int32_t)raw.accelZ * raw.accelZ);
+        return (Value)isqrt32(sum) * ACCEL_Q16_PER_LSB;
+    }
+
+    static float tiltDeg(float a, float b, float c) {
+        // Gravity components are unit scale; Q14 keeps b² + c² in 32 bits
+        int32_t qa = (int32_t)(a * 16384.0f);
+        int32_t qb = (int32_t)(b * 16384.0f);
+        int32_t qc = (int32_t)(c * 16384.0f);
+        uint32_t horizontal = isqrt32((uint32_t)(qb * qb) + (uint32_t)(qc * qc));
+        return q16ToFloat(fixedAtan2Deg(qa, (int32_t)horizontal));
+    }
+};
+
+#endif // NUMERIC_H
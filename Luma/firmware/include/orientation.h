@@ -0,0 +1,69 @@
+#ifndef ORIENTATION_H
+#define ORIENTATION_H
+
+#include <stdint.h>
+
+// ============================================
+// ORIENTATION FILTER (Mahony accel + gyro fusion)
+// ============================================
+//
+// A unit quaternion is integrated from the gyro every sample and pulled
+// towards the measured gravity direction by a PI feedback on the
+// accel / estimate cross product. The accel correction is skipped while
+// |a| is more than ORIENTATION_ACCEL_GATE_G away from 1 g, so braking or
+// an impact cannot tilt the estimate; the gyro carries it through.
+//
+// After a reset the first sample aligns the estimate with gravity
+// directly (shortest-arc quaternion), so there is no convergence ramp.
+// Float only, no trig on the per-sample path.
+//
+// Frames: the body frame is the IMU's (X forward, Z up when worn
+// level). The level frame is the body frame with pitch and roll
+// removed: X is the helmet's heading projected onto the horizontal, Z
+// points up.
+
+// Acceleration with gravity removed, level frame (g)
+struct LinearAccel {
+    float forward;   // + speeding up, - braking
+    float lateral;   // + left
+    float vertical;  // + up
+};
+
+class OrientationFilter {
+public:
+    OrientationFilter();
+
+    // Forget the estimate; the next sample re-aligns with gravity
+    void reset();
+
+    // One sample: accel in g, gyro in °/s, dt in seconds. A dt above
+    // ORIENTATION_MAX_DT_S (a sampling gap) re-aligns first.
+    void update(float ax, float ay, float az,
+                float gx, float gy, float gz, float dt);
+
+    // Linear acceleration of the last update
+    const LinearAccel& linear() const { return lin; }
+
+    // Gravity direction in the body frame (unit vector, g)
+    float gravityX() const { return vx; }
+    float gravityY() const { return vy; }
+    float gravityZ() const { return vz; }
+
+    // Tilt in degrees, same sign convention as the legacy accel-only
+    // atan2 (uses trig - call at telemetry rate, not per sample)
+    float pitchDeg() const;
+    float rollDeg() const;
+
+private:
+    float q0, q1, q2, q3;          // Body -> earth rotation
+    float ix, iy, iz;              // Integral feedback (gyro bias, rad/s)
+    float vx, vy, vz;              // Gravity estimate in the body frame
+    float headingCos, headingSin;  // Level frame yaw (kept while vertical)
+    bool aligned;
+    LinearAccel lin;
+
+    void align(float ax, float ay, float az);
+    void updateGravity();
+};
+
+#endif // ORIENTATION_H
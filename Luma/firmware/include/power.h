@@ -0,0 +1,41 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+// ============================================
+// POWER MANAGER (activity-driven duty cycling)
+// ============================================
+//
+// The detection task reports every sample; once the helmet has been still
+// for POWER_IDLE_AFTER_MS the IMU is parked in wake-on-motion and the
+// device goes idle. Idle and disconnected long enough, it sleeps. Motion
+// seen by the IMU restores full-rate sampling from the sampling task
+// itself, so the ramp-up costs one low-power accel period plus a FIFO
+// reconfigure - no task round trip and no CPU wake-up latency beyond that.
+//
+// Idle is only entered from STATE_NORMAL, so a crash alert or brake light
+// never loses full-rate sensing while it is up.
+
+enum PowerMode {
+    POWER_ACTIVE,  // 200 Hz FIFO sampling, detection running
+    POWER_IDLE,    // IMU in wake-on-motion, slow BLE intervals
+    POWER_SLEEP    // Also disconnected: LEDs off, no advertising, light sleep
+};
+
+// Called from the power task on every mode change, before sleeping
+typedef void (*PowerModeHook)(PowerMode from, PowerMode to);
+
+// Start the power task. Call after samplingBegin().
+bool powerBegin(PowerModeHook onModeChange);
+
+// Detection task: one converted sample (g, °/s). Cheap: compares and,
+// when moving, one atomic store.
+void powerNoteSample(float gForce, float gyroX, float gyroY, float gyroZ);
+
+// BLE server callbacks: sleep is only entered while disconnected
+void powerSetConnected(bool connected);
+
+PowerMode powerGetMode();
+
+#endif // POWER_H
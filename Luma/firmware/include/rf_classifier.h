@@ -0,0 +1,40 @@
+#ifndef RF_CLASSIFIER_H
+#define RF_CLASSIFIER_H
+
+#include <stdint.h>
+#include "rf_features.h"
+#include "rf_model.h"
+
+// ============================================
+// ON-DEVICE RANDOM FOREST
+// ============================================
+
+struct RfResult {
+    uint8_t label;       // RF_CLASS_*
+    uint8_t confidence;  // Mean leaf probability of `label`, 0..255
+};
+
+// Evaluate the forest on one feature vector (RF_NUM_FEATURES raw,
+// unscaled values). `votes` receives the summed leaf probabilities per
+// class and may be null.
+RfResult rfPredict(const float* features, uint32_t* votes = nullptr);
+
+// Streaming classifier: takes every IMU sample, decimates to the model's
+// rate, keeps the window features up to date and re-runs the forest every
+// RF_HOP_SAMPLES model samples.
+class EventClassifier {
+public:
+    EventClassifier() { reset(); }
+
+    void reset();
+
+    // Returns true when a new classification is written to `result`
+    bool update(const ImuVector& sample, RfResult& result);
+
+private:
+    RfFeatureExtractor extractor;
+    uint16_t decimation;
+    uint16_t hop;
+};
+
+#endif // RF_CLASSIFIER_H
@@ -0,0 +1,66 @@
+#ifndef RF_FEATURES_H
+#define RF_FEATURES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rf_model.h"
+#include "window_features.h"
+
+// ============================================
+// STREAMING WINDOW FEATURES FOR THE RF CLASSIFIER
+// ============================================
+//
+// Same features, same order and same estimators as engineer_features()
+// in data-analysis/scripts/train_classifier.py, maintained incrementally
+// over the last RF_WINDOW_SIZE samples instead of recomputed per window.
+// export_classifier.py maps model feature names onto this enum, so the
+// order here is the contract - append only.
+
+enum RfFeature {
+    // accel_{x,y,z}_{mean,std,max,min,range,median,skew,kurtosis}
+    FEAT_ACCEL_X_MEAN, FEAT_ACCEL_X_STD, FEAT_ACCEL_X_MAX, FEAT_ACCEL_X_MIN,
+    FEAT_ACCEL_X_RANGE, FEAT_ACCEL_X_MEDIAN, FEAT_ACCEL_X_SKEW, FEAT_ACCEL_X_KURTOSIS,
+    FEAT_ACCEL_Y_MEAN, FEAT_ACCEL_Y_STD, FEAT_ACCEL_Y_MAX, FEAT_ACCEL_Y_MIN,
+    FEAT_ACCEL_Y_RANGE, FEAT_ACCEL_Y_MEDIAN, FEAT_ACCEL_Y_SKEW, FEAT_ACCEL_Y_KURTOSIS,
+    FEAT_ACCEL_Z_MEAN, FEAT_ACCEL_Z_STD, FEAT_ACCEL_Z_MAX, FEAT_ACCEL_Z_MIN,
+    FEAT_ACCEL_Z_RANGE, FEAT_ACCEL_Z_MEDIAN, FEAT_ACCEL_Z_SKEW, FEAT_ACCEL_Z_KURTOSIS,
+
+    FEAT_ACCEL_MAG_MEAN, FEAT_ACCEL_MAG_STD, FEAT_ACCEL_MAG_MAX, FEAT_ACCEL_MAG_RANGE,
+
+    // gyro_{x,y,z}_{mean,std,max,range}
+    FEAT_GYRO_X_MEAN, FEAT_GYRO_X_STD, FEAT_GYRO_X_MAX, FEAT_GYRO_X_RANGE,
+    FEAT_GYRO_Y_MEAN, FEAT_GYRO_Y_STD, FEAT_GYRO_Y_MAX, FEAT_GYRO_Y_RANGE,
+    FEAT_GYRO_Z_MEAN, FEAT_GYRO_Z_STD, FEAT_GYRO_Z_MAX, FEAT_GYRO_Z_RANGE,
+
+    FEAT_GYRO_MAG_MEAN, FEAT_GYRO_MAG_STD, FEAT_GYRO_MAG_MAX,
+
+    FEAT_JERK_MEAN, FEAT_JERK_MAX, FEAT_JERK_STD,
+    FEAT_ACCEL_ENERGY, FEAT_GYRO_ENERGY,
+    FEAT_ACCEL_X_ZCR,
+
+    RF_FEATURE_COUNT
+};
+
+class RfFeatureExtractor {
+public:
+    RfFeatureExtractor() { reset(); }
+
+    void reset();
+
+    // Feed one sample at the training rate (RF_SAMPLE_RATE_HZ)
+    void update(const ImuVector& s);
+
+    // True once a full window has been seen
+    bool ready() const { return window.full(); }
+
+    // Write RF_FEATURE_COUNT features for the current window
+    void compute(float* features) const;
+
+private:
+    static const size_t N = RF_WINDOW_SIZE;
+
+    ImuWindow<N> window;
+    SlidingMedian<N> medians[3];  // accel x/y/z (not O(1), RF-only)
+};
+
+#endif // RF_FEATURES_H
@@ -0,0 +1,61 @@
+#ifndef RF_MODEL_H
+#define RF_MODEL_H
+
+// ============================================
+// RANDOM FOREST MODEL (generated)
+// ============================================
+//
+// Placeholder - regenerate from a trained model with
+//
+//     cd data-analysis
+//     python scripts/export_classifier.py --model models/rf_classifier.pkl
+//
+// Until then RF_MODEL_AVAILABLE is 0 and detection keeps the threshold
+// rules. The layout below is exactly what the exporter writes.
+
+#include <stdint.h>
+
+#define RF_MODEL_AVAILABLE 0
+
+#define RF_WINDOW_SIZE     150  // Samples per window (EVENT_WINDOW_SIZE)
+#define RF_SAMPLE_RATE_HZ  50   // Rate the model was trained at
+#define RF_NUM_FEATURES    49
+#define RF_NUM_CLASSES     5
+#define RF_NUM_TREES       1
+#define RF_MAX_DEPTH       0
+
+// Class indices (sklearn orders classes alphabetically)
+#define RF_CLASS_BRAKE   0
+#define RF_CLASS_BUMP    1
+#define RF_CLASS_CRASH   2
+#define RF_CLASS_NORMAL  3
+#define RF_CLASS_TURN    4
+
+static const char* const RF_CLASS_NAMES[RF_NUM_CLASSES] = {
+    "brake", "bump", "crash", "normal", "turn"
+};
+
+// Trees are flattened into one node array. Leaves point to themselves, so
+// every tree is walked for exactly RF_MAX_DEPTH steps without branching on
+// node type. Thresholds already include the MinMaxScaler, so raw features
+// are compared directly: go left if features[feature] <= threshold.
+struct RfNode {
+    float threshold;
+    uint16_t left;
+    uint16_t right;
+    uint16_t leaf;     // Row in RF_LEAF_PROBS (leaves only)
+    uint8_t feature;
+};
+
+static const RfNode RF_NODES[] = {
+    { 0.0f, 0, 0, 0, 0 },
+};
+
+static const uint16_t RF_TREE_ROOTS[RF_NUM_TREES] = { 0 };
+
+// Per-leaf class probabilities scaled to 0..255
+static const uint8_t RF_LEAF_PROBS[][RF_NUM_CLASSES] = {
+    { 0, 0, 0, 255, 0 },
+};
+
+#endif // RF_MODEL_H
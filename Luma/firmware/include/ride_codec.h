@@ -0,0 +1,32 @@
+#ifndef RIDE_CODEC_H
+#define RIDE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================
+// RIDE LOG SAMPLE CODEC (portable)
+// ============================================
+//
+// The payload encoding of a ride log block (see ride_log.h): per sample,
+// each of the six axes as the zigzag varint of its difference from the
+// previous sample. Shared by the recorder and the host tests;
+// scripts/decode_rides.py is the reader.
+
+#define RIDE_AXES 6
+
+// Largest encoded sample: six deltas of up to 17 bits, 3 varint bytes each
+#define RIDE_SAMPLE_MAX_BYTES 18
+
+// Encode `values` against `previous`, which then holds `values`.
+// Returns the bytes written (at most RIDE_SAMPLE_MAX_BYTES).
+size_t rideEncodeSample(uint8_t* out, const int16_t values[RIDE_AXES], int16_t previous[RIDE_AXES]);
+
+// Decode one sample from `len` bytes, updating `previous` to it. Returns
+// the bytes read, 0 if the input ends inside the sample.
+size_t rideDecodeSample(const uint8_t* in, size_t len, int16_t previous[RIDE_AXES]);
+
+// CRC-32 (IEEE 802.3, as zlib.crc32) of the payload
+uint32_t rideCrc32(const uint8_t* data, size_t len);
+
+#endif // RIDE_CODEC_H
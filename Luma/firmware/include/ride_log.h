@@ -0,0 +1,111 @@
+#ifndef RIDE_LOG_H
+#define RIDE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "imu_sample.h"
+
+// ============================================
+// RIDE LOG (full-rate session recorder)
+// ============================================
+//
+// Every raw IMU sample goes to the "rides" flash partition, whether or
+// not a phone is connected, so rides can be synced afterwards. A session
+// is one stretch of full-rate sampling: it starts with the first sample
+// after boot or after idle, and ends when the helmet goes idle. Its
+// samples are numbered from 0 like the app's sample_index.
+//
+// The partition is a ring of 4 KB blocks, each self-contained: a header
+// and a payload of samples, every axis as the zigzag varint of its
+// difference from the previous sample in the block (the first one from
+// 0). Timestamps are implied by the sample rate; a gap (dropped samples)
+// starts a new block. The detection task encodes into a ring of RAM
+// blocks (ride_codec.h); a low-priority writer task programs full ones
+// and keeps the next block erased, so recording never touches flash.
+// Once the ring is full the oldest block is overwritten.
+//
+// Flash cost: each block is one sector erase (typically ~45 ms, up to
+// ~400 ms by the flash datasheets) and 17 page programs (~0.7 ms each),
+// every 2-3 s at 200 Hz. The cache is off for each of them, which stops
+// every task except IRAM interrupts, so the writer holds them back during
+// STATE_BRAKING and STATE_CRASH_ALERT and sends the blocks it kept in
+// RAM in one batch afterwards. The trace stages TRACE_RIDE_ERASE and
+// TRACE_RIDE_WRITE give the measured times.
+//
+// Wear: the ring wraps after ~11 minutes of riding (288 blocks), one
+// erase per sector per wrap; at 100k erase cycles that is ~18,000 hours
+// of riding.
+
+#define RIDE_LOG_MAGIC    0x4C524D4CUL  // "LMRL"
+#define RIDE_LOG_VERSION  1
+
+#define RIDE_BLOCK_SIZE   4096  // One flash sector
+
+// Block flags
+#define RIDE_BLOCK_SESSION_START  0x01  // First block of its session
+#define RIDE_BLOCK_AFTER_GAP      0x02  // Samples were lost just before it
+
+// Block header (32 bytes), payload follows
+struct RideBlockHeader {
+    uint32_t magic;               // RIDE_LOG_MAGIC
+    uint32_t seq;                 // Increments per block, survives reboots
+    uint32_t sessionId;           // Increments per session, survives reboots
+    uint32_t firstSampleIndex;    // Index in the session of the first sample
+    uint32_t firstTimestampUs;    // micros() of the first sample
+    uint32_t dataCrc;             // CRC-32 of the payload
+    uint16_t payloadLength;
+    uint16_t sampleCount;
+    uint16_t sampleRateHz;
+    uint8_t version;              // RIDE_LOG_VERSION
+    uint8_t flags;                // RIDE_BLOCK_*
+};
+
+static_assert(sizeof(RideBlockHeader) == 32, "RideBlockHeader is a wire format");
+
+#define RIDE_PAYLOAD_MAX (RIDE_BLOCK_SIZE - sizeof(RideBlockHeader))
+
+// Stored bytes of a block (header + payload)
+inline uint32_t rideBlockLength(const RideBlockHeader& h) {
+    return sizeof(RideBlockHeader) + h.payloadLength;
+}
+
+// Summary of one session in flash
+struct RideSession {
+    uint32_t sessionId;
+    uint32_t firstSeq;      // Oldest block still stored
+    uint32_t lastSeq;
+    uint32_t sampleCount;   // Samples in the stored blocks
+};
+
+// Find the partition, index the stored blocks and start the writer task.
+// Returns false (and records nothing) if the partition is missing.
+bool rideLogBegin();
+
+// ---- Detection task ----
+
+// Encode one sample into the current block (no flash access)
+void rideLogRecord(const ImuSample& sample);
+
+// ---- Any task ----
+
+// End the current session and flush its partial block; the next sample
+// starts a new one (power mode hook, on leaving POWER_ACTIVE)
+void rideLogNewSession();
+
+// Stored sessions, oldest first (reads flash - keep off the sensing path)
+uint16_t rideLogSessions(RideSession* sessions, uint16_t maxSessions);
+
+// Oldest and newest stored block; false if there is none
+bool rideLogRange(uint32_t& oldestSeq, uint32_t& newestSeq);
+
+// Copy up to `len` bytes of block `seq` from `offset` (header first).
+// Returns the bytes copied, 0 past its end or if `seq` is not stored.
+size_t rideLogRead(uint32_t seq, uint32_t offset, uint8_t* out, size_t len);
+
+// Ask the writer task to erase all blocks (asynchronous)
+void rideLogEraseAll();
+
+// Samples dropped because both RAM blocks were full, since boot
+uint32_t rideLogDropped();
+
+#endif // RIDE_LOG_H
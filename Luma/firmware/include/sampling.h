@@ -0,0 +1,46 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "imu_sample.h"
+
+// Sampling engine statistics
+struct SamplingStats {
+    uint32_t samples;        // Samples delivered to the queue
+    uint32_t fifoOverflows;  // Times the MPU FIFO overflowed and was reset
+    uint32_t queueDrops;     // Samples dropped because the consumer fell behind
+    uint32_t readErrors;     // Failed I2C transactions
+};
+
+// Configure the MPU6500 sample clock (FIFO + INT or polling, see
+// IMU_USE_FIFO) and start the high-priority sampling task. `consumer`
+// receives a task notification after every batch of new samples.
+// Call after mpuConfigure().
+bool samplingBegin(TaskHandle_t consumer);
+
+// Pop the next sample, non-blocking. Returns false if none is pending.
+// Single consumer only - call from the task passed to samplingBegin().
+bool samplingRead(ImuSample& sample);
+
+// Snapshot of the engine counters
+SamplingStats samplingGetStats();
+
+// ---- Low-power mode (FIFO mode only) ----
+
+typedef void (*SamplingWakeFn)();
+
+// Ask the sampling task to park the IMU in wake-on-motion and stop
+// delivering samples. On the first motion it restores full-rate FIFO
+// sampling by itself, then calls `onMotion` from the sampling task.
+// Returns false if low-power mode is unavailable (IMU_USE_FIFO 0).
+bool samplingEnterLowPower(SamplingWakeFn onMotion);
+
+// True while the IMU is parked in wake-on-motion
+bool samplingIsLowPower();
+
+// Check for motion now, e.g. after the INT edge was masked in light sleep
+void samplingWake();
+
+#endif // SAMPLING_H
@@ -0,0 +1,104 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// ============================================
+// RUNTIME SETTINGS
+// ============================================
+//
+// Tunables the app can change without a reflash. Defaults are the
+// config.h values; the command protocol (command.h) sets and reads them
+// by id, as little-endian values of the setting's type, and NVS keeps
+// them across boots (settings_store.cpp).
+//
+// Readers get the current snapshot with settingsGet() - one atomic
+// load, then plain field loads. A writer edits a copy and publishes it
+// whole, so readers never see half of a change. There are two slots:
+// a reader must not hold the reference across two publishes (read the
+// fields it needs, then let go - publishes come at BLE write rate).
+
+struct Settings {
+    float brakeG;                  // BRAKE_G_THRESHOLD
+    float crashG;                  // CRASH_G_THRESHOLD
+    uint32_t crashConfirmationMs;  // CRASH_CONFIRMATION_MS
+    uint16_t brakeFlashMs;         // BRAKE_FLASH_DURATION
+    uint16_t animationSpeedMs;     // DEFAULT_ANIMATION_SPEED
+    uint16_t turnSignalSpeedMs;    // TURN_SIGNAL_SPEED
+    uint8_t ledBrightness;         // LED_BRIGHTNESS
+    uint8_t averageSamples;        // SENSOR_SAMPLE_SIZE (and at most that)
+};
+
+// Ids on the wire and in NVS - never renumber
+enum SettingId : uint8_t {
+    SETTING_BRAKE_G            = 0x01,  // f32, g
+    SETTING_CRASH_G            = 0x02,  // f32, g
+    SETTING_CRASH_CONFIRMATION = 0x03,  // u32, ms
+    SETTING_BRAKE_FLASH        = 0x04,  // u16, ms
+    SETTING_ANIMATION_SPEED    = 0x05,  // u16, ms per frame
+    SETTING_TURN_SIGNAL_SPEED  = 0x06,  // u16, ms per frame
+    SETTING_LED_BRIGHTNESS     = 0x07,  // u8
+    SETTING_AVERAGE_SAMPLES    = 0x08   // u8, samples
+};
+
+enum SettingStatus {
+    SETTING_OK,
+    SETTING_UNKNOWN,       // No such id
+    SETTING_BAD_LENGTH,    // Value is not the setting's size
+    SETTING_OUT_OF_RANGE
+};
+
+// Longest encoded value
+#define SETTING_MAX_LEN 4
+
+// Current snapshot (any task)
+const Settings& settingsGet();
+
+// The config.h values
+const Settings& settingsDefaults();
+
+// Set one setting of `draft` from its encoded value
+SettingStatus settingsSet(Settings& draft, uint8_t id, const uint8_t* value, size_t len);
+
+// Encode one setting of `from` into `out` (SETTING_MAX_LEN bytes);
+// returns the length, 0 for an unknown id
+size_t settingsRead(const Settings& from, uint8_t id, uint8_t* out);
+
+// Make `draft` the current snapshot. One writer at a time: setup, then
+// the control task.
+void settingsPublish(const Settings& draft);
+
+// Counts publishes, so the store can tell when to save and readers can
+// keep values derived from a snapshot until it changes. A reader that
+// sees a new generation gets at least that snapshot from settingsGet().
+uint32_t settingsGeneration();
+
+// ---- Stored form ----
+//
+// [SETTINGS_SCHEMA_VERSION] then [id][len][value] per setting. Ids the
+// firmware does not know are skipped and missing ones keep their
+// defaults, so adding a setting needs no new version; bump it only
+// when an existing id changes meaning or type.
+
+// Bytes for every setting
+#define SETTINGS_ENCODED_MAX 64
+
+size_t settingsEncode(const Settings& from, uint8_t* out);
+
+// Defaults overlaid with the valid entries of `data`; false (and just
+// the defaults) for another schema version
+bool settingsDecode(const uint8_t* data, size_t len, Settings& out);
+
+// ---- NVS (firmware only, settings_store.cpp) ----
+
+// Load the stored settings in one read and publish them. Call in setup
+// before the tasks start.
+void settingsBegin();
+
+// Save once the settings have been unchanged for SETTINGS_SAVE_DELAY_MS.
+// Call from a low-priority task: a flash write can take tens of ms.
+void settingsService();
+
+#endif // SETTINGS_H
@@ -0,0 +1,69 @@
+#ifndef SPEED_FUSION_H
+#define SPEED_FUSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// ============================================
+// SPEED FUSION (phone GPS + forward accel)
+// ============================================
+//
+// Two-state Kalman filter on [speed, forward accel bias], run at the IMU
+// rate. Every sample predicts the speed from the forward linear
+// acceleration; every fix pushed by the app over SPEED_CHAR_UUID
+// corrects it. The bias state absorbs what the orientation filter leaves
+// of gravity on the forward axis (a nodding head, a misjudged mounting),
+// so the brake decision can subtract it.
+//
+// Between fixes the estimate follows the IMU, so a brake shows up in
+// the speed at once rather than a GPS second later. Without a fix for
+// SPEED_FIX_TIMEOUT_MS the estimate is invalid and the next fix starts
+// it over. Float only, about twenty operations per sample.
+
+// One fix from the phone
+struct SpeedFix {
+    float speedMps;
+    float courseDeg;     // Heading over ground, < 0 if unknown (not used by the filter)
+    float accuracyMps;   // Speed 1-sigma, <= 0 if unknown
+};
+
+// Packed size of a fix on SPEED_CHAR_UUID
+#define SPEED_FIX_LEN 5
+
+// Little-endian [speed u16 cm/s][course u16 0.01°, 0xFFFF unknown]
+// [accuracy u8 0.1 m/s, 0 unknown]; false if too short
+bool speedParseFix(const uint8_t* data, size_t len, SpeedFix& fix);
+
+class SpeedFilter {
+public:
+    SpeedFilter();
+
+    // Forget the estimate; invalid until the next fix
+    void reset();
+
+    // One sample: forward linear acceleration (g, gravity removed), dt
+    // in seconds
+    void predict(float forwardG, float dt);
+
+    // Correct with a fix from the phone
+    void correct(const SpeedFix& fix);
+
+    // A fix arrived within SPEED_FIX_TIMEOUT_MS
+    bool valid() const { return hasFix && sinceFixS < SPEED_FIX_TIMEOUT_MS * 0.001f; }
+
+    // Estimated speed (m/s, >= 0)
+    float speedMps() const { return v; }
+
+    // Estimated forward accel bias (g), 0 while invalid
+    float biasG() const;
+
+private:
+    float v;                // Speed, m/s
+    float b;                // Forward accel bias, m/s²
+    float p00, p01, p11;    // Covariance (symmetric)
+    float sinceFixS;
+    bool hasFix;
+};
+
+#endif // SPEED_FUSION_H
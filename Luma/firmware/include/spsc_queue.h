@@ -0,0 +1,58 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring buffer.
+//
+// Exactly one task may call push() and exactly one task (or the same one)
+// may call pop(). No locks, no allocation, never blocks - pair it with a
+// task notification when the consumer needs to sleep until data arrives.
+// N must be a power of two.
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    // Producer side. Returns false (item dropped) when the queue is full.
+    bool push(const T& item) {
+        size_t write = writeIndex.load(std::memory_order_relaxed);
+        size_t read = readIndex.load(std::memory_order_acquire);
+        if (write - read == N) {
+            return false;
+        }
+        buffer[write & (N - 1)] = item;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the queue is empty.
+    bool pop(T& item) {
+        size_t read = readIndex.load(std::memory_order_relaxed);
+        size_t write = writeIndex.load(std::memory_order_acquire);
+        if (read == write) {
+            return false;
+        }
+        item = buffer[read & (N - 1)];
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate fill level (exact when called from either end)
+    size_t size() const {
+        return writeIndex.load(std::memory_order_acquire) -
+               readIndex.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T buffer[N];
+    std::atomic<size_t> writeIndex{0};
+    std::atomic<size_t> readIndex{0};
+};
+
+#endif // SPSC_QUEUE_H
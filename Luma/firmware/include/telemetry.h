@@ -0,0 +1,88 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "imu_sample.h"
+
+// ============================================
+// BATCHED TELEMETRY FRAME (TELEMETRY_CHAR_UUID)
+// ============================================
+//
+// All fields little-endian, no padding.
+//
+// Header (10 bytes):
+//   [0]     version      TELEMETRY_PROTOCOL_VERSION
+//   [1]     flags        TELEMETRY_FLAG_*
+//   [2..3]  sequence     Frame counter, wraps at 65535
+//   [4..7]  timestampUs  Time of the first sample (device micros() clock)
+//   [8]     state        HelmetState when the frame was sent
+//   [9]     count        Number of samples that follow
+//
+// Sample (14 bytes), repeated `count` times:
+//   [0..1]   dtUs        Microseconds since the previous sample (0 for the first)
+//   [2..7]   accel x,y,z int16, MPU6500_ACCEL_LSB_PER_G LSB/g
+//   [8..13]  gyro x,y,z  int16, MPU6500_GYRO_LSB_PER_DPS LSB/(°/s)
+//
+// The legacy 13-byte frame on SENSOR_CHAR_UUID is unchanged.
+
+#define TELEMETRY_PROTOCOL_VERSION  1
+#define TELEMETRY_HEADER_LEN        10
+#define TELEMETRY_SAMPLE_LEN        14
+
+// Largest ATT attribute value
+#define TELEMETRY_MAX_PAYLOAD       512
+
+// Header flags
+#define TELEMETRY_FLAG_SAMPLES_LOST 0x01  // Samples were dropped before this frame
+
+// Packs timestamped samples into frames that fill one notification
+class TelemetryPacker {
+public:
+    TelemetryPacker();
+
+    // Usable payload per notification (ATT MTU - 3), clamped to the buffer
+    void setMaxPayload(size_t bytes);
+    size_t maxPayload() const { return payloadLimit; }
+
+    // Add a sample. Returns false if it does not fit (frame full, or the
+    // gap to the previous sample does not fit the 16-bit delta); the
+    // caller should finish() the frame and append again.
+    bool append(const ImuSample& sample);
+
+    // Mark that samples were lost since the last frame
+    void markSamplesLost() { flags |= TELEMETRY_FLAG_SAMPLES_LOST; }
+
+    // Samples waiting to be sent; a finished frame has none
+    uint8_t count() const { return finished ? 0 : sampleCount; }
+    bool empty() const { return count() == 0; }
+    bool full() const { return length + TELEMETRY_SAMPLE_LEN > payloadLimit; }
+
+    // Timestamp of the first sample in the pending frame
+    uint32_t firstTimestampUs() const { return firstTimestamp; }
+
+    // Write the header and return the frame length, or 0 if there is
+    // nothing new to send (empty, or already finished). The frame stays
+    // valid in data() until the next append(); the packer then starts a
+    // new one.
+    size_t finish(uint8_t state);
+    const uint8_t* data() const { return buffer; }
+
+    // Drop the pending samples without sending them
+    void discard() { startFrame(); }
+
+private:
+    void startFrame();
+
+    uint8_t buffer[TELEMETRY_MAX_PAYLOAD];
+    size_t payloadLimit;
+    size_t length;
+    uint8_t sampleCount;
+    uint8_t flags;
+    uint16_t frameSequence;
+    uint32_t firstTimestamp;
+    uint32_t lastTimestamp;
+    bool finished;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,176 @@
+#ifndef WINDOW_FEATURES_H
+#define WINDOW_FEATURES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "window_stats.h"
+
+// ============================================
+// SLIDING-WINDOW FEATURE ENGINE
+// ============================================
+//
+// Per-axis statistics over the last N samples, updated in O(1) amortised
+// time per sample with fixed memory, so cost does not grow with the
+// window or the IMU rate. Each AxisWindow owns its ring of samples; the
+// statistics are told which value enters and which leaves.
+//
+// "Jerk" is the first difference x[i] - x[i-1]; the N samples in the
+// window form N - 1 differences and N - 1 sign-change candidates.
+
+// One IMU sample in physical units (g, °/s)
+struct ImuVector {
+    float ax, ay, az;
+    float gx, gy, gz;
+};
+
+// Statistics of one signal. With JerkStats the mean / std of the first
+// difference (and of its magnitude) are tracked as well.
+template <size_t N, bool JerkStats = false>
+class AxisWindow {
+    static_assert(N >= 2, "AxisWindow needs at least two samples");
+
+public:
+    AxisWindow() { reset(); }
+
+    void reset() {
+        head = 0;
+        n = 0;
+        seen = 0;
+        crossings = 0;
+        stats.reset();
+        maximum.reset();
+        minimum.reset();
+        peakJerkMax.reset();
+        jerkMoments.reset();
+        absJerkMoments.reset();
+    }
+
+    void push(float x) {
+        if (n == N) {
+            // The oldest sample and the difference that ends at the next
+            // one both leave the window
+            float out = values[head];
+            float next = values[(head + 1) % N];
+            stats.replace(out, x);
+            crossings -= crossed(out, next);
+            if (JerkStats) {
+                jerkMoments.remove(next - out);
+                absJerkMoments.remove(fabsf(next - out));
+            }
+        } else {
+            stats.add(x);
+        }
+
+        if (n > 0) {
+            float prev = at(n - 1);
+            float d = x - prev;
+            crossings += crossed(prev, x);
+            peakJerkMax.push(seen, fabsf(d));
+            if (JerkStats) {
+                jerkMoments.add(d);
+                absJerkMoments.add(fabsf(d));
+            }
+        }
+        maximum.push(seen, x);
+        minimum.push(seen, x);
+
+        values[(head + n) % N] = x;
+        if (n == N) {
+            head = (head + 1) % N;
+        } else {
+            n++;
+        }
+
+        // Exact recompute once per window keeps float error bounded
+        if (++seen % N == 0) recompute();
+    }
+
+    // i-th sample in the window, 0 = oldest
+    float at(size_t i) const { return values[(head + i) % N]; }
+
+    size_t count() const { return n; }
+    bool full() const { return n == N; }
+
+    float mean() const { return stats.mean(); }
+    float variance() const { return stats.variance(); }    // ddof = 1
+    float stddev() const { return stats.stddev(); }         // ddof = 1
+    float skewness() const { return stats.skewness(); }
+    float kurtosis() const { return stats.kurtosis(); }
+    float max() const { return maximum.value(); }
+    float min() const { return minimum.value(); }
+    float range() const { return maximum.value() - minimum.value(); }
+
+    // Sum of squares over the window
+    float energy() const { return stats.sumSquares(); }
+
+    // Largest |x[i] - x[i-1]| in the window
+    float peakJerk() const { return peakJerkMax.value(); }
+
+    // Sign changes between consecutive samples (0 counts as its own sign)
+    uint16_t zeroCrossings() const { return crossings; }
+
+    // JerkStats only: signed differences (std is ddof = 0, as numpy)
+    // and mean |difference|
+    float jerkMean() const { return absJerkMoments.mean(); }
+    float jerkStd() const { return jerkMoments.stddevPopulation(); }
+
+private:
+    static float signOf(float x) { return (x > 0.0f) - (x < 0.0f); }
+    static uint16_t crossed(float a, float b) { return signOf(a) != signOf(b); }
+
+    void recompute() {
+        stats.recompute([this](size_t i) { return at(i); }, n);
+        if (JerkStats) {
+            jerkMoments.recompute([this](size_t i) { return at(i + 1) - at(i); }, n - 1);
+            absJerkMoments.recompute([this](size_t i) { return fabsf(at(i + 1) - at(i)); }, n - 1);
+        }
+    }
+
+    float values[N];
+    size_t head;      // Oldest sample once full
+    size_t n;         // Samples held
+    uint32_t seen;    // Samples pushed since reset (deque index)
+    uint16_t crossings;
+
+    SlidingMoments<N> stats;
+    SlidingMax<N> maximum;
+    SlidingMin<N> minimum;
+    SlidingMax<N - 1> peakJerkMax;
+    SlidingMoments<N> jerkMoments;
+    SlidingMoments<N> absJerkMoments;
+};
+
+// All six IMU axes plus accel / gyro magnitude over the same window
+template <size_t N>
+class ImuWindow {
+public:
+    void reset() {
+        for (int a = 0; a < 3; a++) {
+            accel[a].reset();
+            gyro[a].reset();
+        }
+        accelMag.reset();
+        gyroMag.reset();
+    }
+
+    void update(const ImuVector& s) {
+        accel[0].push(s.ax);
+        accel[1].push(s.ay);
+        accel[2].push(s.az);
+        gyro[0].push(s.gx);
+        gyro[1].push(s.gy);
+        gyro[2].push(s.gz);
+        accelMag.push(sqrtf(s.ax * s.ax + s.ay * s.ay + s.az * s.az));
+        gyroMag.push(sqrtf(s.gx * s.gx + s.gy * s.gy + s.gz * s.gz));
+    }
+
+    bool full() const { return accelMag.full(); }
+
+    AxisWindow<N> accel[3];
+    AxisWindow<N> gyro[3];
+    AxisWindow<N, true> accelMag;  // Jerk = diff of the accel magnitude
+    AxisWindow<N> gyroMag;
+};
+
+#endif // WINDOW_FEATURES_H
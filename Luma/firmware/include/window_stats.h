@@ -0,0 +1,227 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+// ============================================
+// SLIDING-WINDOW STATISTICS
+// ============================================
+//
+// Building blocks for window features that must be updated every sample.
+// All are fixed-size (window length N is a template parameter) and do no
+// allocation. The owner keeps the window contents and tells each block
+// which value enters and which leaves.
+
+// Mean and central moment sums M2..M4 of a sliding window.
+//
+// Add/remove use the pairwise-update formulas of Welford/Pébay, so the
+// moments stay centred and do not suffer the cancellation of raw power
+// sums. recompute() restores exact values from the window contents; call
+// it once per window length to stop float rounding from drifting.
+template <size_t N>
+class SlidingMoments {
+public:
+    void reset() {
+        n = 0;
+        mu = m2 = m3 = m4 = 0.0f;
+    }
+
+    void add(float x) {
+        float n1 = (float)n;
+        n++;
+        float nf = (float)n;
+        float delta = x - mu;
+        float deltaN = delta / nf;
+        float deltaN2 = deltaN * deltaN;
+        float term1 = delta * deltaN * n1;
+
+        mu += deltaN;
+        m4 += term1 * deltaN2 * (nf * nf - 3.0f * nf + 3.0f) + 6.0f * deltaN2 * m2 - 4.0f * deltaN * m3;
+        m3 += term1 * deltaN * (nf - 2.0f) - 3.0f * deltaN * m2;
+        m2 += term1;
+    }
+
+    void remove(float x) {
+        if (n <= 1) {
+            reset();
+            return;
+        }
+        // Inverse of add(): recover the moments of the remaining n-1 values
+        float nf = (float)n;
+        float na = nf - 1.0f;
+        float muA = (nf * mu - x) / na;
+        float delta = x - muA;
+        float delta2 = delta * delta;
+
+        float m2a = m2 - delta2 * na / nf;
+        float m3a = m3 - delta2 * delta * na * (na - 1.0f) / (nf * nf) + 3.0f * delta * m2a / nf;
+        float m4a = m4 - delta2 * delta2 * na * (na * na - na + 1.0f) / (nf * nf * nf)
+                       - 6.0f * delta2 * m2a / (nf * nf) + 4.0f * delta * m3a / nf;
+
+        n--;
+        mu = muA;
+        m2 = m2a > 0.0f ? m2a : 0.0f;
+        m3 = m3a;
+        m4 = m4a > 0.0f ? m4a : 0.0f;
+    }
+
+    // Slide the window: `out` leaves, `in` enters
+    void replace(float out, float in) {
+        remove(out);
+        add(in);
+    }
+
+    // Exact two-pass recompute; get(i) returns the i-th of `count` values
+    template <typename Getter>
+    void recompute(Getter get, size_t count) {
+        reset();
+        if (count == 0) return;
+
+        float sum = 0.0f;
+        for (size_t i = 0; i < count; i++) sum += get(i);
+        mu = sum / (float)count;
+
+        for (size_t i = 0; i < count; i++) {
+            float d = get(i) - mu;
+            float d2 = d * d;
+            m2 += d2;
+            m3 += d2 * d;
+            m4 += d2 * d2;
+        }
+        n = count;
+    }
+
+    size_t count() const { return n; }
+    float mean() const { return mu; }
+    float sum() const { return mu * (float)n; }
+
+    // Sum of squares, e.g. signal energy
+    float sumSquares() const { return m2 + (float)n * mu * mu; }
+
+    // Sample variance / standard deviation (ddof = 1, as pandas)
+    float variance() const { return n > 1 ? m2 / (float)(n - 1) : 0.0f; }
+    float stddev() const { return sqrtf(variance()); }
+
+    // Population standard deviation (ddof = 0, as numpy)
+    float stddevPopulation() const { return n > 0 ? sqrtf(m2 / (float)n) : 0.0f; }
+
+    // Adjusted Fisher-Pearson skewness (pandas Series.skew)
+    float skewness() const {
+        if (n < 3 || m2 <= 0.0f) return 0.0f;
+        float nf = (float)n;
+        return (nf * sqrtf(nf - 1.0f) / (nf - 2.0f)) * (m3 / (m2 * sqrtf(m2)));
+    }
+
+    // Unbiased excess kurtosis (pandas Series.kurtosis)
+    float kurtosis() const {
+        if (n < 4 || m2 <= 0.0f) return 0.0f;
+        float nf = (float)n;
+        float numerator = nf * (nf + 1.0f) * (nf - 1.0f) * m4;
+        float denominator = (nf - 2.0f) * (nf - 3.0f) * m2 * m2;
+        float adjust = 3.0f * (nf - 1.0f) * (nf - 1.0f) / ((nf - 2.0f) * (nf - 3.0f));
+        return numerator / denominator - adjust;
+    }
+
+private:
+    size_t n = 0;
+    float mu = 0.0f;
+    float m2 = 0.0f;
+    float m3 = 0.0f;
+    float m4 = 0.0f;
+};
+
+// Sliding maximum (IsMax = true) or minimum over the last N samples using
+// a monotonic deque: amortised O(1) per sample, exact.
+template <size_t N, bool IsMax>
+class SlidingExtremum {
+public:
+    void reset() {
+        head = 0;
+        size = 0;
+    }
+
+    // `index` must increase by one per call (sample counter)
+    void push(uint32_t index, float x) {
+        // Expire entries that leave the window with this sample
+        while (size > 0 && indices[head] + N <= index) {
+            head = (head + 1) % N;
+            size--;
+        }
+        // Drop entries that can never be the extremum again
+        while (size > 0 && !dominates(values[slot(size - 1)], x)) {
+            size--;
+        }
+        indices[slot(size)] = index;
+        values[slot(size)] = x;
+        size++;
+    }
+
+    float value() const { return size ? values[head] : 0.0f; }
+
+private:
+    static bool dominates(float kept, float incoming) {
+        return IsMax ? kept > incoming : kept < incoming;
+    }
+
+    size_t slot(size_t offset) const { return (head + offset) % N; }
+
+    uint32_t indices[N] = {};
+    float values[N] = {};
+    size_t head = 0;
+    size_t size = 0;
+};
+
+template <size_t N> using SlidingMax = SlidingExtremum<N, true>;
+template <size_t N> using SlidingMin = SlidingExtremum<N, false>;
+
+// Sliding median over the last N samples. The window is kept sorted, so
+// each update is one binary search plus an O(N) move; the median of an
+// even count is the mean of the two middle values (as pandas).
+template <size_t N>
+class SlidingMedian {
+public:
+    void reset() { n = 0; }
+
+    void add(float x) {
+        size_t pos = lowerBound(x);
+        for (size_t i = n; i > pos; i--) sorted[i] = sorted[i - 1];
+        sorted[pos] = x;
+        n++;
+    }
+
+    void remove(float x) {
+        size_t pos = lowerBound(x);
+        if (pos >= n || sorted[pos] != x) return;
+        for (size_t i = pos; i + 1 < n; i++) sorted[i] = sorted[i + 1];
+        n--;
+    }
+
+    void replace(float out, float in) {
+        remove(out);
+        add(in);
+    }
+
+    float value() const {
+        if (n == 0) return 0.0f;
+        if (n & 1) return sorted[n / 2];
+        return 0.5f * (sorted[n / 2 - 1] + sorted[n / 2]);
+    }
+
+private:
+    size_t lowerBound(float x) const {
+        size_t lo = 0, hi = n;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (sorted[mid] < x) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    float sorted[N] = {};
+    size_t n = 0;
+};
+
+#endif // WINDOW_STATS_H
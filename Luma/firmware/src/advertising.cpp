@@ -0,0 +1,170 @@
+/*
+ * Advertising / reconnect manager - fast bursts, back-off and the status
+ * byte in the advert
+ *
+ * The advert is built by hand (flags, 128-bit service UUID and the
+ * manufacturer data fill 27 of its 31 bytes); the name and the
+ * preferred connection interval go in the scan response.
+ */
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <atomic>
+#include <string>
+#include "config.h"
+#include "advertising.h"
+#include "log.h"
+
+// Set by the host task, read by the telemetry task
+static std::atomic<bool> connected{false};
+static std::atomic<bool> disconnectSeen{false};
+static std::atomic<uint8_t> powerMode{POWER_ACTIVE};
+static ble_addr_t lastPeer;                   // Valid once hasLastPeer is set
+static std::atomic<bool> hasLastPeer{false};
+
+// Telemetry task only
+static NimBLEAdvertising* advertising = nullptr;
+static AdvPhase phase = ADV_PHASE_OFF;
+static uint32_t burstStartMs = 0;
+static bool reconnectBurst = false;  // The burst follows a disconnect
+static uint8_t advertisedStatus = 0;
+static uint8_t appliedMode = POWER_ACTIVE;
+
+static void setAdvertData(uint8_t status) {
+    NimBLEAdvertisementData data;
+    data.setFlags(BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+    data.setCompleteServices(NimBLEUUID(SERVICE_UUID));
+
+    const char manufacturer[4] = {
+        (char)(ADV_COMPANY_ID & 0xFF), (char)(ADV_COMPANY_ID >> 8),
+        (char)ADV_STATUS_VERSION, (char)status
+    };
+    data.setManufacturerData(std::string(manufacturer, sizeof(manufacturer)));
+    advertising->setAdvertisementData(data);
+    advertisedStatus = status;
+}
+
+static void setScanResponseData() {
+    NimBLEAdvertisementData data;
+    data.setName(BLE_DEVICE_NAME);
+
+    // Peripheral preferred connection interval (AD type 0x12), idle range;
+    // the link manager raises it when streaming
+    const char interval[6] = {
+        5, 0x12,
+        (char)(BLE_IDLE_INTERVAL_MIN & 0xFF), (char)(BLE_IDLE_INTERVAL_MIN >> 8),
+        (char)(BLE_IDLE_INTERVAL_MAX & 0xFF), (char)(BLE_IDLE_INTERVAL_MAX >> 8)
+    };
+    data.addData(std::string(interval, sizeof(interval)));
+    advertising->setScanResponseData(data);
+}
+
+// Filter accept list = bonded phones + the one just disconnected; false
+// if there is nobody to accept (the burst is then open to everyone)
+static bool fillAcceptList() {
+    while (NimBLEDevice::getWhiteListCount() > 0) {
+        NimBLEDevice::whiteListRemove(NimBLEDevice::getWhiteListAddress(0));
+    }
+    for (int i = 0; i < NimBLEDevice::getNumBonds(); i++) {
+        NimBLEDevice::whiteListAdd(NimBLEDevice::getBondedAddress(i));
+    }
+    if (hasLastPeer.load(std::memory_order_acquire)) {
+        NimBLEAddress peer(lastPeer);
+        if (!NimBLEDevice::onWhiteList(peer)) NimBLEDevice::whiteListAdd(peer);
+    }
+    return NimBLEDevice::getWhiteListCount() > 0;
+}
+
+static void enterPhase(AdvPhase next) {
+    // The accept list and intervals can only change while stopped
+    advertising->stop();
+    phase = next;
+    if (next == ADV_PHASE_OFF) return;
+
+    bool acceptListOnly = next == ADV_PHASE_RECONNECT && fillAcceptList();
+    advertising->setScanFilter(false, acceptListOnly);
+
+    if (next == ADV_PHASE_SLOW) {
+        bool active = appliedMode == POWER_ACTIVE;
+        advertising->setMinInterval(active ? BLE_ADV_INTERVAL_ACTIVE_MIN : BLE_ADV_INTERVAL_IDLE);
+        advertising->setMaxInterval(active ? BLE_ADV_INTERVAL_ACTIVE_MAX : BLE_ADV_INTERVAL_IDLE);
+    } else {
+        advertising->setMinInterval(BLE_ADV_INTERVAL_FAST_MIN);
+        advertising->setMaxInterval(BLE_ADV_INTERVAL_FAST_MAX);
+    }
+    advertising->start();
+    LOG_D("BLE: advertising phase %u", (uint32_t)next);
+}
+
+void advBegin(NimBLEServer* server, uint8_t status) {
+    server->advertiseOnDisconnect(false);  // advService() restarts it
+    advertising = NimBLEDevice::getAdvertising();
+    setAdvertData(status);
+    setScanResponseData();
+
+    burstStartMs = millis();
+    reconnectBurst = false;
+    enterPhase(ADV_PHASE_FAST);
+}
+
+void advOnConnect(const ble_gap_conn_desc* desc) {
+    lastPeer = desc->peer_id_addr;
+    hasLastPeer.store(true, std::memory_order_release);
+    connected = true;
+}
+
+void advOnDisconnect() {
+    connected = false;
+    disconnectSeen = true;
+}
+
+void advSetPowerMode(PowerMode mode) {
+    powerMode = mode;
+}
+
+void advService(uint32_t nowMs, uint8_t status) {
+    if (advertising == nullptr) return;
+
+    if (disconnectSeen.exchange(false)) {
+        burstStartMs = nowMs;
+        reconnectBurst = true;
+        phase = ADV_PHASE_OFF;  // The stack stopped advertising on connect
+    }
+
+    // A new crash while nobody is connected: advertise it fast
+    bool crashRaised = (status & ADV_STATUS_CRASH) && !(advertisedStatus & ADV_STATUS_CRASH);
+    if (status != advertisedStatus) {
+        setAdvertData(status);  // Takes effect while advertising
+    }
+    if (crashRaised && !connected) {
+        burstStartMs = nowMs;
+        reconnectBurst = false;
+        phase = ADV_PHASE_OFF;  // Re-enter below at the fast interval
+    }
+
+    uint8_t mode = powerMode.load();
+    bool modeChanged = mode != appliedMode;
+    appliedMode = mode;
+
+    AdvPhase wanted;
+    uint32_t sinceBurst = nowMs - burstStartMs;
+    if (connected || mode == POWER_SLEEP) {
+        wanted = ADV_PHASE_OFF;
+    } else if (reconnectBurst && sinceBurst < BLE_ADV_RECONNECT_MS) {
+        wanted = ADV_PHASE_RECONNECT;
+    } else if (sinceBurst < BLE_ADV_FAST_MS) {
+        wanted = ADV_PHASE_FAST;
+    } else {
+        wanted = ADV_PHASE_SLOW;
+    }
+
+    if (connected) {
+        phase = ADV_PHASE_OFF;  // Connecting ended advertising already
+    } else if (wanted != phase || (modeChanged && wanted == ADV_PHASE_SLOW)) {
+        enterPhase(wanted);
+    }
+}
+
+AdvPhase advGetPhase() {
+    return phase;
+}
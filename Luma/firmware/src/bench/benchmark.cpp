@@ -0,0 +1,317 @@
+/*
+ * Hot-path microbenchmarks - replaces main.cpp in the *-bench envs
+ *
+ * Each stage runs BENCH_WARMUP untimed and BENCH_ITERATIONS timed
+ * iterations; every iteration is timed on its own with the CPU cycle
+ * counter, so the median and min are not moved by the odd preemption
+ * (BLE host, tick) that lands in the mean and max. The timer overhead is
+ * measured first and subtracted. The suite repeats every
+ * BENCH_REPEAT_MS so runs can be compared for drift.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <NimBLEDevice.h>
+#include <string.h>
+#include <algorithm>
+#include "config.h"
+#include "calibration.h"
+#include "detection.h"
+#include "helmet_state.h"
+#include "latency_trace.h"
+#include "led_engine.h"
+#include "led_strip.h"
+#include "mpu6500.h"
+#include "rf_classifier.h"
+#include "rf_features.h"
+#include "telemetry.h"
+
+#define BENCH_ITERATIONS 2000
+#define BENCH_WARMUP     32
+#define BENCH_REPEAT_MS  10000
+#define BENCH_INPUTS     256   // Synthetic samples, cycled through
+
+// Set per env in platformio.ini so reports say what they measured
+#ifndef BENCH_OPT_LABEL
+#define BENCH_OPT_LABEL "?"
+#endif
+
+static uint32_t cycles[BENCH_ITERATIONS];
+static uint32_t timerOverhead = 0;
+
+static ImuSample inputs[BENCH_INPUTS];
+static ImuVector vectors[BENCH_INPUTS];
+static float features[RF_NUM_FEATURES];
+
+// Both numeric backends, whichever DETECTION_FIXED_POINT selects
+static BasicDetectionPipeline<FloatMath> floatDetector;
+static BasicDetectionPipeline<FixedMath> fixedDetector;
+static RfFeatureExtractor extractor;
+static EventClassifier classifier;
+static TelemetryPacker packer;
+
+static NimBLECharacteristic* benchChar = nullptr;
+static bool imuPresent = false;
+
+// Keeps results alive so the optimizer cannot drop the work
+static volatile float sink;
+
+// ============================================
+// HARNESS
+// ============================================
+
+typedef void (*BenchFn)(uint32_t i);
+
+static void printHeader() {
+    Serial.println();
+    Serial.printf("=== Luma hot-path benchmark (%s, %u MHz, gcc %s) ===\n",
+                  BENCH_OPT_LABEL, (unsigned)getCpuFrequencyMhz(), __VERSION__);
+    Serial.printf("%u iterations per stage, timer overhead %u cycles (subtracted)\n",
+                  (unsigned)BENCH_ITERATIONS, (unsigned)timerOverhead);
+    Serial.printf("%-22s %8s %8s %8s %8s %8s %9s\n",
+                  "stage", "min", "median", "p99", "max", "mean", "median us");
+}
+
+// Time `fn` per iteration and print cycle statistics. `setup` (optional)
+// runs untimed before every iteration.
+static void bench(const char* name, BenchFn fn, BenchFn setup = nullptr) {
+    for (uint32_t i = 0; i < BENCH_WARMUP; i++) {
+        if (setup) setup(i);
+        fn(i);
+    }
+
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        if (setup) setup(i);
+        uint32_t start = traceNow();
+        fn(i);
+        uint32_t elapsed = traceNow() - start;
+        elapsed = elapsed > timerOverhead ? elapsed - timerOverhead : 0;
+        cycles[i] = elapsed;
+        sum += elapsed;
+    }
+
+    std::sort(cycles, cycles + BENCH_ITERATIONS);
+    uint32_t median = cycles[BENCH_ITERATIONS / 2];
+    Serial.printf("%-22s %8u %8u %8u %8u %8u %9.2f\n", name,
+                  (unsigned)cycles[0], (unsigned)median,
+                  (unsigned)cycles[BENCH_ITERATIONS * 99 / 100],
+                  (unsigned)cycles[BENCH_ITERATIONS - 1],
+                  (unsigned)(sum / BENCH_ITERATIONS),
+                  median / (float)getCpuFrequencyMhz());
+}
+
+static void measureTimerOverhead() {
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < 256; i++) {
+        uint32_t start = traceNow();
+        uint32_t elapsed = traceNow() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    timerOverhead = best;
+}
+
+// Deterministic ride-like input: ~1 g down, noise on every axis
+static void makeInputs() {
+    uint32_t seed = 0x1234567;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        int16_t noise[6];
+        for (int a = 0; a < 6; a++) {
+            seed = seed * 1664525u + 1013904223u;
+            noise[a] = (int16_t)((seed >> 16) % 801) - 400;
+        }
+        ImuSample& s = inputs[i];
+        s.raw.accelX = noise[0];
+        s.raw.accelY = noise[1];
+        s.raw.accelZ = (int16_t)MPU6500_ACCEL_LSB_PER_G + noise[2];
+        s.raw.gyroX = noise[3] / 4;
+        s.raw.gyroY = noise[4] / 4;
+        s.raw.gyroZ = noise[5] / 4;
+
+        ImuVector& v = vectors[i];
+        v.ax = s.raw.accelX / MPU6500_ACCEL_LSB_PER_G;
+        v.ay = s.raw.accelY / MPU6500_ACCEL_LSB_PER_G;
+        v.az = s.raw.accelZ / MPU6500_ACCEL_LSB_PER_G;
+        v.gx = s.raw.gyroX / MPU6500_GYRO_LSB_PER_DPS;
+        v.gy = s.raw.gyroY / MPU6500_GYRO_LSB_PER_DPS;
+        v.gz = s.raw.gyroZ / MPU6500_GYRO_LSB_PER_DPS;
+    }
+}
+
+// ============================================
+// STAGES
+// ============================================
+
+static void benchI2cSample(uint32_t) {
+    ImuRawSample raw;
+    mpuReadSample(raw);
+    sink = raw.accelZ;
+}
+
+static void benchI2cFifoCount(uint32_t) {
+    sink = mpuReadFifoCount();
+}
+
+// Input `i`, stamped so time keeps running as the table wraps
+static ImuSample nextSample(uint32_t i) {
+    ImuSample s = inputs[i % BENCH_INPUTS];
+    s.timestampUs = i * (1000000 / IMU_SAMPLE_RATE_HZ);
+    s.sequence = i;
+    return s;
+}
+
+template <typename Math> BasicDetectionPipeline<Math>& pipeline();
+template <> BasicDetectionPipeline<FloatMath>& pipeline<FloatMath>() { return floatDetector; }
+template <> BasicDetectionPipeline<FixedMath>& pipeline<FixedMath>() { return fixedDetector; }
+
+template <typename Math>
+static void benchFilter(uint32_t i) {
+    SensorData data = pipeline<Math>().filter(nextSample(i));
+    sink = data.avgForwardAccel;
+}
+
+template <typename Math>
+static void benchFilterClassify(uint32_t i) {
+    SensorData data = pipeline<Math>().filter(nextSample(i));
+    pipeline<Math>().classify(data);
+    sink = data.isBraking;
+}
+
+template <typename Math>
+static void benchPitchRoll(uint32_t) {
+    sink = pipeline<Math>().pitchDeg() + pipeline<Math>().rollDeg();
+}
+
+template <typename Math>
+static void benchMagnitude(uint32_t i) {
+    sink = Math::toFloat(Math::magnitude(inputs[i % BENCH_INPUTS].raw));
+}
+
+static void benchFeatureUpdate(uint32_t i) {
+    extractor.update(vectors[i % BENCH_INPUTS]);
+}
+
+static void benchFeatureCompute(uint32_t) {
+    extractor.compute(features);
+    sink = features[0];
+}
+
+static void benchForest(uint32_t) {
+    RfResult result = rfPredict(features);
+    sink = result.confidence;
+}
+
+static void benchClassifierStream(uint32_t i) {
+    RfResult result;
+    sink = classifier.update(vectors[i % BENCH_INPUTS], result);
+}
+
+static void waitStripIdle(uint32_t) {
+    while (ledStripBusy()) {}
+}
+
+static void benchLedFrame(uint32_t i) {
+    // Party renders every pixel; 20 ms per frame, so each call is a new frame
+    sink = ledEngineUpdate(STATE_PARTY, i * 20);
+}
+
+static void benchLedShow(uint32_t i) {
+    static Rgb pixels[NUM_LEDS];
+    pixels[i % NUM_LEDS].r = (uint8_t)i;
+    sink = ledStripShow(pixels);
+}
+
+static void benchTelemetryPack(uint32_t i) {
+    if (!packer.append(nextSample(i)) || packer.full()) {
+        sink = packer.finish((uint8_t)STATE_NORMAL);
+    }
+}
+
+static void benchBleNotify(uint32_t) {
+    static uint8_t frame[13];
+    benchChar->setValue(frame, sizeof(frame));
+    benchChar->notify();
+}
+
+// ============================================
+// SETUP & LOOP
+// ============================================
+
+static void runSuite() {
+    printHeader();
+
+    if (imuPresent) {
+        bench("i2c sample (14 B)", benchI2cSample);
+        bench("i2c fifo count", benchI2cFifoCount);
+    } else {
+        Serial.println("i2c: MPU6500 not found, skipped");
+    }
+
+    floatDetector.reset();
+    fixedDetector.reset();
+    bench("magnitude (float)", benchMagnitude<FloatMath>);
+    bench("magnitude (fixed)", benchMagnitude<FixedMath>);
+    bench("filter (float)", benchFilter<FloatMath>);
+    bench("filter (fixed)", benchFilter<FixedMath>);
+    bench("filter+classify float", benchFilterClassify<FloatMath>);
+    bench("filter+classify fixed", benchFilterClassify<FixedMath>);
+    bench("pitch + roll (float)", benchPitchRoll<FloatMath>);
+    bench("pitch + roll (fixed)", benchPitchRoll<FixedMath>);
+
+    extractor.reset();
+    for (uint32_t i = 0; i < RF_WINDOW_SIZE; i++) extractor.update(vectors[i % BENCH_INPUTS]);
+    bench("feature update", benchFeatureUpdate);
+    bench("feature compute", benchFeatureCompute);
+    bench(RF_MODEL_AVAILABLE ? "forest" : "forest (placeholder)", benchForest);
+    classifier.reset();
+    bench("classifier stream", benchClassifierStream);
+
+    bench("led render + show", benchLedFrame, waitStripIdle);
+    bench("led show", benchLedShow, waitStripIdle);
+
+    packer.setMaxPayload(TELEMETRY_MAX_PAYLOAD);
+    bench("telemetry pack", benchTelemetryPack);
+    bench(benchChar->getSubscribedCount() > 0 ? "ble notify" : "ble notify (no sub)",
+          benchBleNotify);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    Wire.begin(PIN_SDA, PIN_SCL);
+    Wire.setClock(400000);
+    imuPresent = mpuProbe();
+    if (imuPresent) {
+        mpuConfigure();
+        mpuConfigureFifo(IMU_SAMPLE_RATE_HZ);
+    }
+
+    ledEngineBegin();
+    traceBegin();
+
+    // Identity and complete, so estimation never runs inside a timing
+    Calibration identity;
+    memset(&identity, 0, sizeof(identity));
+    identity.version = CALIBRATION_VERSION;
+    identity.flags = CALIBRATION_GYRO_BIAS | CALIBRATION_MOUNTING;
+    for (int i = 0; i < 3; i++) identity.rotation[i][i] = 1.0f;
+    calibrationSet(&identity);
+
+    // Connect and subscribe from a central to measure notify with a peer
+    NimBLEDevice::init(BLE_DEVICE_NAME);
+    NimBLEServer* server = NimBLEDevice::createServer();
+    NimBLEService* service = server->createService(SERVICE_UUID);
+    benchChar = service->createCharacteristic(SENSOR_CHAR_UUID, NIMBLE_PROPERTY::NOTIFY);
+    service->start();
+    NimBLEDevice::getAdvertising()->addServiceUUID(SERVICE_UUID);
+    NimBLEDevice::startAdvertising();
+
+    makeInputs();
+    measureTimerOverhead();
+}
+
+void loop() {
+    runSuite();
+    delay(BENCH_REPEAT_MS);
+}
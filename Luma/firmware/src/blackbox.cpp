@@ -0,0 +1,311 @@
+/*
+ * Black box - pre/post-event IMU capture to a flash partition
+ *
+ * Ownership of the RAM ring is handed between tasks by captureState:
+ * the detection task writes it while RECORDING / POST_TRIGGER, the writer
+ * task reads it while FROZEN and hands it back by re-arming. Flash is only
+ * touched by the writer task (and by reads for download), in page-sized
+ * calls, so the cache-disabled windows stay short enough for the IMU FIFO
+ * to absorb them.
+ */
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <string.h>
+#include "config.h"
+#include "blackbox.h"
+#include "log.h"
+
+#define BLACKBOX_PRE_SAMPLES   (BLACKBOX_PRE_MS * IMU_SAMPLE_RATE_HZ / 1000)
+#define BLACKBOX_POST_SAMPLES  (BLACKBOX_POST_MS * IMU_SAMPLE_RATE_HZ / 1000)
+#define BLACKBOX_RING_SAMPLES  (BLACKBOX_PRE_SAMPLES + BLACKBOX_POST_SAMPLES)
+
+#define FLASH_SECTOR_SIZE  4096
+#define FLASH_WRITE_CHUNK  256   // One flash page per write call
+
+// Slot = largest record rounded up to whole sectors
+#define SLOT_SIZE (((sizeof(BlackBoxHeader) + BLACKBOX_RING_SAMPLES * sizeof(BlackBoxSample)) \
+                    + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE)
+
+#define SLOT_EMPTY 0xFFFFFFFFUL
+
+static_assert(BLACKBOX_RING_SAMPLES <= 0xFFFF, "sampleCount is 16 bits");
+
+enum CaptureState : uint8_t {
+    CAPTURE_DISABLED,      // No partition
+    CAPTURE_RECORDING,     // Ring is filling, waiting for a trigger
+    CAPTURE_POST_TRIGGER,  // Triggered, recording the post-event window
+    CAPTURE_FROZEN         // Writer task owns the ring
+};
+
+static const esp_partition_t* partition = nullptr;
+static TaskHandle_t writerTaskHandle = nullptr;
+static std::atomic<uint8_t> captureState{CAPTURE_DISABLED};
+static std::atomic<bool> eraseRequested{false};
+
+// ---- RAM ring (see ownership note above) ----
+static BlackBoxSample ring[BLACKBOX_RING_SAMPLES];
+static uint16_t ringHead = 0;    // Next slot to write
+static uint16_t ringFilled = 0;
+static uint16_t postRemaining = 0;
+static BlackBoxHeader pending;   // Header of the capture in progress
+
+// ---- Slot index (writer task updates, readers scan) ----
+static uint32_t slotIds[BLACKBOX_MAX_SLOTS];
+static uint16_t slotCount = 0;
+static uint16_t nextSlot = 0;
+static uint32_t nextId = 0;
+
+// ============================================
+// FLASH LAYOUT
+// ============================================
+
+static uint32_t slotOffset(uint16_t slot) {
+    return (uint32_t)slot * SLOT_SIZE;
+}
+
+static bool readHeader(uint16_t slot, BlackBoxHeader& header) {
+    if (esp_partition_read(partition, slotOffset(slot), &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    return header.magic == BLACKBOX_MAGIC &&
+           header.version == BLACKBOX_VERSION &&
+           header.sampleCount <= BLACKBOX_RING_SAMPLES;
+}
+
+// Build the index and continue after the newest record
+static void scanSlots() {
+    uint32_t newestId = 0;
+    bool any = false;
+    nextSlot = 0;
+
+    for (uint16_t slot = 0; slot < slotCount; slot++) {
+        BlackBoxHeader header;
+        if (!readHeader(slot, header)) {
+            slotIds[slot] = SLOT_EMPTY;
+            continue;
+        }
+        slotIds[slot] = header.id;
+        if (!any || header.id > newestId) {
+            newestId = header.id;
+            nextSlot = (slot + 1) % slotCount;
+            any = true;
+        }
+    }
+    nextId = any ? newestId + 1 : 1;
+}
+
+static bool eraseSlot(uint16_t slot) {
+    slotIds[slot] = SLOT_EMPTY;
+    // Sector by sector so higher-priority tasks run in between
+    for (uint32_t offset = 0; offset < SLOT_SIZE; offset += FLASH_SECTOR_SIZE) {
+        if (esp_partition_erase_range(partition, slotOffset(slot) + offset, FLASH_SECTOR_SIZE) != ESP_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeChunked(uint32_t offset, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t n = len < FLASH_WRITE_CHUNK ? len : FLASH_WRITE_CHUNK;
+        if (esp_partition_write(partition, offset, data, n) != ESP_OK) {
+            return false;
+        }
+        offset += n;
+        data += n;
+        len -= n;
+        taskYIELD();
+    }
+    return true;
+}
+
+// ============================================
+// WRITER TASK
+// ============================================
+
+// Write the frozen ring into nextSlot (already erased)
+static bool writeCapture() {
+    uint16_t count = ringFilled;
+    uint16_t oldest = (ringHead + BLACKBOX_RING_SAMPLES - count) % BLACKBOX_RING_SAMPLES;
+    uint32_t base = slotOffset(nextSlot);
+    uint32_t offset = base + sizeof(BlackBoxHeader);
+    uint32_t crc = 0;
+
+    // The ring may wrap: write it as up to two contiguous runs
+    uint16_t firstRun = BLACKBOX_RING_SAMPLES - oldest;
+    if (firstRun > count) firstRun = count;
+    const uint8_t* runs[2] = { (const uint8_t*)&ring[oldest], (const uint8_t*)&ring[0] };
+    size_t lengths[2] = { firstRun * sizeof(BlackBoxSample),
+                          (size_t)(count - firstRun) * sizeof(BlackBoxSample) };
+
+    for (int i = 0; i < 2; i++) {
+        if (lengths[i] == 0) continue;
+        if (!writeChunked(offset, runs[i], lengths[i])) return false;
+        crc = esp_rom_crc32_le(crc, runs[i], lengths[i]);
+        offset += lengths[i];
+    }
+
+    pending.magic = BLACKBOX_MAGIC;
+    pending.id = nextId;
+    pending.dataCrc = crc;
+    pending.version = BLACKBOX_VERSION;
+    pending.sampleRateHz = IMU_SAMPLE_RATE_HZ;
+    pending.sampleCount = count;
+    pending.triggerIndex = count - BLACKBOX_POST_SAMPLES;
+
+    // Header last: it is what marks the record as complete
+    if (esp_partition_write(partition, base, &pending, sizeof(pending)) != ESP_OK) {
+        return false;
+    }
+    slotIds[nextSlot] = nextId;
+    nextId++;
+    nextSlot = (nextSlot + 1) % slotCount;
+    return true;
+}
+
+static void rearm() {
+    ringHead = 0;
+    ringFilled = 0;
+    captureState.store(CAPTURE_RECORDING, std::memory_order_release);
+}
+
+static void writerTask(void* param) {
+    // Keep the next slot erased so a capture only has to program pages
+    bool nextErased = eraseSlot(nextSlot);
+    rearm();
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (captureState.load(std::memory_order_acquire) == CAPTURE_FROZEN) {
+            if (nextErased && writeCapture()) {
+                LOG_I("Black box: record %u saved (%u samples)", nextId - 1, ringFilled);
+            } else {
+                LOG_E("Black box: flash write failed");
+            }
+            rearm();
+            nextErased = eraseSlot(nextSlot);
+        }
+
+        if (eraseRequested.exchange(false)) {
+            for (uint16_t slot = 0; slot < slotCount; slot++) {
+                eraseSlot(slot);
+            }
+            nextSlot = 0;
+            nextErased = true;
+            LOG_I("Black box: erased");
+        }
+    }
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+bool blackboxBegin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         ESP_PARTITION_SUBTYPE_ANY,
+                                         BLACKBOX_PARTITION_LABEL);
+    if (partition == nullptr) {
+        Serial.println("Black box: no partition, capture disabled");
+        return false;
+    }
+
+    slotCount = partition->size / SLOT_SIZE;
+    if (slotCount > BLACKBOX_MAX_SLOTS) slotCount = BLACKBOX_MAX_SLOTS;
+    if (slotCount < 2) {
+        Serial.println("Black box: partition too small");
+        return false;
+    }
+    scanSlots();
+
+    if (xTaskCreate(writerTask, "blackbox", TASK_STACK_BLACKBOX, nullptr,
+                    TASK_PRIORITY_BLACKBOX, &writerTaskHandle) != pdPASS) {
+        return false;
+    }
+
+    Serial.print("Black box: ");
+    Serial.print(slotCount);
+    Serial.print(" slots, next record ");
+    Serial.println(nextId);
+    return true;
+}
+
+void blackboxRecord(const ImuSample& sample) {
+    uint8_t state = captureState.load(std::memory_order_acquire);
+    if (state != CAPTURE_RECORDING && state != CAPTURE_POST_TRIGGER) return;
+
+    BlackBoxSample& s = ring[ringHead];
+    s.timestampUs = sample.timestampUs;
+    s.accel[0] = sample.raw.accelX;
+    s.accel[1] = sample.raw.accelY;
+    s.accel[2] = sample.raw.accelZ;
+    s.gyro[0] = sample.raw.gyroX;
+    s.gyro[1] = sample.raw.gyroY;
+    s.gyro[2] = sample.raw.gyroZ;
+
+    if (++ringHead == BLACKBOX_RING_SAMPLES) ringHead = 0;
+    if (ringFilled < BLACKBOX_RING_SAMPLES) ringFilled++;
+
+    if (state == CAPTURE_POST_TRIGGER && --postRemaining == 0) {
+        captureState.store(CAPTURE_FROZEN, std::memory_order_release);
+        xTaskNotifyGive(writerTaskHandle);
+    }
+}
+
+bool blackboxTrigger(BlackBoxReason reason) {
+    if (captureState.load(std::memory_order_acquire) != CAPTURE_RECORDING) return false;
+
+    // The newest recorded sample is the one that triggered
+    uint16_t last = (ringHead + BLACKBOX_RING_SAMPLES - 1) % BLACKBOX_RING_SAMPLES;
+    pending.reason = reason;
+    pending.triggerTimestampUs = ringFilled > 0 ? ring[last].timestampUs : micros();
+    postRemaining = BLACKBOX_POST_SAMPLES > 0 ? BLACKBOX_POST_SAMPLES : 1;
+    captureState.store(CAPTURE_POST_TRIGGER, std::memory_order_release);
+    return true;
+}
+
+uint16_t blackboxList(BlackBoxHeader* headers, uint16_t maxHeaders) {
+    if (partition == nullptr) return 0;
+
+    // Oldest first = walk the circle starting at the write position
+    uint16_t found = 0;
+    for (uint16_t i = 0; i < slotCount && found < maxHeaders; i++) {
+        uint16_t slot = (nextSlot + i) % slotCount;
+        if (slotIds[slot] == SLOT_EMPTY) continue;
+        if (readHeader(slot, headers[found])) found++;
+    }
+    return found;
+}
+
+size_t blackboxRead(uint32_t id, uint32_t offset, uint8_t* out, size_t len) {
+    if (partition == nullptr || id == SLOT_EMPTY) return 0;
+
+    for (uint16_t slot = 0; slot < slotCount; slot++) {
+        if (slotIds[slot] != id) continue;
+
+        BlackBoxHeader header;
+        if (!readHeader(slot, header) || header.id != id) return 0;
+
+        uint32_t length = blackboxRecordLength(header);
+        if (offset >= length) return 0;
+        if (len > length - offset) len = length - offset;
+
+        if (esp_partition_read(partition, slotOffset(slot) + offset, out, len) != ESP_OK) {
+            return 0;
+        }
+        return len;
+    }
+    return 0;
+}
+
+void blackboxEraseAll() {
+    if (writerTaskHandle == nullptr) return;
+    eraseRequested = true;
+    xTaskNotifyGive(writerTaskHandle);
+}
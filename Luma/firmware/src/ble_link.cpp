@@ -0,0 +1,129 @@
+/*
+ * BLE connection-parameter manager (MTU, interval, PHY)
+ *
+ * After connect we start an MTU exchange, request 2M PHY and the idle
+ * interval; the interval is re-requested whenever the telemetry profile
+ * changes. What the central actually granted is read back from the
+ * NimBLE host on demand, so there is no cached copy to go stale.
+ */
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include "config.h"
+#include "ble_link.h"
+
+static NimBLEServer* linkServer = nullptr;
+static volatile uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE;
+static volatile LinkProfile activeProfile = LINK_PROFILE_IDLE;
+static volatile bool powerSave = false;
+
+static void requestInterval(LinkProfile profile) {
+    uint16_t handle = connHandle;
+    if (handle == BLE_HS_CONN_HANDLE_NONE) return;
+
+    uint16_t minInterval = BLE_IDLE_INTERVAL_MIN;
+    uint16_t maxInterval = BLE_IDLE_INTERVAL_MAX;
+    uint16_t latency = BLE_CONN_LATENCY;
+    if (powerSave) {
+        minInterval = BLE_POWERSAVE_INTERVAL_MIN;
+        maxInterval = BLE_POWERSAVE_INTERVAL_MAX;
+        latency = BLE_POWERSAVE_CONN_LATENCY;
+    } else if (profile == LINK_PROFILE_STREAMING) {
+        minInterval = BLE_STREAM_INTERVAL_MIN;
+        maxInterval = BLE_STREAM_INTERVAL_MAX;
+    }
+
+    linkServer->updateConnParams(handle, minInterval, maxInterval,
+                                 latency, BLE_SUPERVISION_TIMEOUT);
+}
+
+void linkBegin(NimBLEServer* server) {
+    linkServer = server;
+    NimBLEDevice::setMTU(BLE_PREFERRED_MTU);
+}
+
+void linkOnConnect(ble_gap_conn_desc* desc) {
+    connHandle = desc->conn_handle;
+
+    // Don't wait for the central to ask for a larger MTU
+    ble_gattc_exchange_mtu(desc->conn_handle, nullptr, nullptr);
+
+    // Nothing is subscribed yet; start idle and let telemetry upgrade
+    activeProfile = LINK_PROFILE_IDLE;
+    requestInterval(activeProfile);
+
+    // 2M PHY where the central supports it (ignored on 1M-only phones)
+    ble_gap_set_prefered_le_phy(desc->conn_handle,
+                                BLE_GAP_LE_PHY_2M_MASK,
+                                BLE_GAP_LE_PHY_2M_MASK,
+                                BLE_GAP_LE_PHY_CODED_ANY);
+}
+
+void linkOnDisconnect() {
+    connHandle = BLE_HS_CONN_HANDLE_NONE;
+    activeProfile = LINK_PROFILE_IDLE;
+}
+
+void linkSetProfile(LinkProfile profile) {
+    if (profile == activeProfile) return;
+    activeProfile = profile;
+    requestInterval(profile);
+}
+
+void linkSetPowerSave(bool enabled) {
+    if (enabled == powerSave) return;
+    powerSave = enabled;
+    requestInterval(activeProfile);
+}
+
+// The handle can outlive the link until onDisconnect runs, and the
+// stack reports 0 for it; never let callers see less than the default
+static uint16_t peerMtu(uint16_t handle) {
+    uint16_t mtu = linkServer->getPeerMTU(handle);
+    return mtu < 23 ? 23 : mtu;
+}
+
+LinkParams linkGetParams() {
+    LinkParams params = { 23, 0, 0, 0, 1, 1 };
+    uint16_t handle = connHandle;
+    if (handle == BLE_HS_CONN_HANDLE_NONE) return params;
+
+    ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(handle, &desc) == 0) {
+        params.interval = desc.conn_itvl;
+        params.latency = desc.conn_latency;
+        params.supervisionTimeout = desc.supervision_timeout;
+    }
+
+    params.mtu = peerMtu(handle);
+
+    uint8_t txPhy, rxPhy;
+    if (ble_gap_read_le_phy(handle, &txPhy, &rxPhy) == 0) {
+        params.txPhy = txPhy;
+        params.rxPhy = rxPhy;
+    }
+    return params;
+}
+
+uint16_t linkGetMtu() {
+    uint16_t handle = connHandle;
+    if (handle == BLE_HS_CONN_HANDLE_NONE) return 23;
+    return peerMtu(handle);
+}
+
+uint16_t linkGetConnHandle() {
+    return connHandle;
+}
+
+size_t linkPackParams(uint8_t* out) {
+    LinkParams p = linkGetParams();
+    uint16_t fields[4] = { p.mtu, p.interval, p.latency, p.supervisionTimeout };
+
+    for (int i = 0; i < 4; i++) {
+        out[i * 2] = (uint8_t)fields[i];
+        out[i * 2 + 1] = (uint8_t)(fields[i] >> 8);
+    }
+    out[8] = p.txPhy;
+    out[9] = p.rxPhy;
+    return LINK_PARAMS_LEN;
+}
@@ -0,0 +1,300 @@
+/*
+ * IMU calibration - online estimation, applied per sample
+ *
+ * Estimation runs in the detection task and costs a few adds per sample
+ * only while a part is still missing. Windows accumulate moments around
+ * their first sample so the float sums do not cancel. Finished results
+ * are queued for calibration_store.cpp. Hardware-independent.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include "config.h"
+#include "calibration.h"
+#include "spsc_queue.h"
+
+#define CAL_REST_SAMPLES   (CAL_REST_MS * IMU_SAMPLE_RATE_HZ / 1000)
+#define CAL_MOUNT_SAMPLES  (CAL_MOUNT_MS * IMU_SAMPLE_RATE_HZ / 1000)
+#define CAL_SIGN_SAMPLES   (CAL_SIGN_MS * IMU_SAMPLE_RATE_HZ / 1000)
+
+#define CAL_COMPLETE (CALIBRATION_GYRO_BIAS | CALIBRATION_MOUNTING)
+
+static_assert(CAL_SIGN_SAMPLES < CAL_MOUNT_SAMPLES, "sign window is part of the mounting window");
+
+// Detection task only, except activeFlags / restartRequested
+static Calibration active;
+static std::atomic<uint8_t> activeFlags{0};
+static std::atomic<bool> restartRequested{false};
+
+// Detection -> telemetry task, for the NVS write
+static SpscQueue<Calibration, 2> finished;
+
+// Still window for the gyro bias
+struct RestWindow {
+    uint32_t n;
+    float shift[3];
+    float sum[3];
+    float sumSq[3];
+};
+
+// Riding window for the mounting rotation
+struct MountWindow {
+    bool started;
+    uint32_t n;
+    float shift[3];
+    float sum[3];
+    float sumProducts[3][3];
+    float signSum[3];  // First CAL_SIGN_SAMPLES only
+};
+
+static RestWindow rest;
+static MountWindow mount;
+
+// ============================================
+// HELPERS
+// ============================================
+
+static void setIdentity(Calibration& c) {
+    memset(&c, 0, sizeof(c));
+    c.version = CALIBRATION_VERSION;
+    for (int i = 0; i < 3; i++) c.rotation[i][i] = 1.0f;
+}
+
+static float dot(const float a[3], const float b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static bool normalize(float v[3]) {
+    float norm = sqrtf(dot(v, v));
+    if (norm < 1e-6f) return false;
+    for (int i = 0; i < 3; i++) v[i] /= norm;
+    return true;
+}
+
+static float accelDeviation(const float accel[3]) {
+    return fabsf(sqrtf(dot(accel, accel)) - 1.0f);
+}
+
+// ============================================
+// GYRO BIAS
+// ============================================
+
+// True (and `bias` set) when a full window was still enough
+static bool updateRest(const float accel[3], const float gyro[3], float bias[3]) {
+    if (accelDeviation(accel) > CAL_REST_MAX_G) {
+        rest.n = 0;
+        return false;
+    }
+
+    if (rest.n == 0) {
+        memset(&rest, 0, sizeof(rest));
+        memcpy(rest.shift, gyro, sizeof(rest.shift));
+    }
+    for (int a = 0; a < 3; a++) {
+        float d = gyro[a] - rest.shift[a];
+        rest.sum[a] += d;
+        rest.sumSq[a] += d * d;
+    }
+    if (++rest.n < CAL_REST_SAMPLES) return false;
+
+    bool still = true;
+    float nf = (float)rest.n;
+    for (int a = 0; a < 3; a++) {
+        float mean = rest.sum[a] / nf;
+        float variance = rest.sumSq[a] / nf - mean * mean;
+        bias[a] = rest.shift[a] + mean;
+        if (variance > CAL_GYRO_MAX_STD_DPS * CAL_GYRO_MAX_STD_DPS ||
+            fabsf(bias[a]) > CAL_GYRO_MAX_BIAS_DPS) {
+            still = false;  // Turning slowly, or not a plausible bias
+        }
+    }
+    rest.n = 0;
+    return still;
+}
+
+// ============================================
+// MOUNTING ROTATION
+// ============================================
+
+static bool solveMount(float rotation[3][3]) {
+    float nf = (float)mount.n;
+
+    float mean[3], up[3];
+    for (int i = 0; i < 3; i++) {
+        mean[i] = mount.sum[i] / nf;
+        up[i] = mount.shift[i] + mean[i];
+    }
+    if (!normalize(up)) return false;
+
+    // Covariance, then projected onto the horizontal: P C P, P = I - u u^T
+    float cov[3][3], proj[3][3], tmp[3][3], horiz[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            cov[i][j] = mount.sumProducts[i][j] / nf - mean[i] * mean[j];
+            proj[i][j] = (i == j ? 1.0f : 0.0f) - up[i] * up[j];
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            tmp[i][j] = cov[i][0] * proj[0][j] + cov[i][1] * proj[1][j] + cov[i][2] * proj[2][j];
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            horiz[i][j] = proj[i][0] * tmp[0][j] + proj[i][1] * tmp[1][j] + proj[i][2] * tmp[2][j];
+        }
+    }
+
+    // Dominant horizontal axis by power iteration, seeded with sensor X
+    // (or Y if X is nearly vertical)
+    float forward[3] = { proj[0][0], proj[1][0], proj[2][0] };
+    if (dot(forward, forward) < 0.1f) {
+        for (int i = 0; i < 3; i++) forward[i] = proj[i][1];
+    }
+    if (!normalize(forward)) return false;
+
+    for (int iter = 0; iter < 16; iter++) {
+        float next[3];
+        for (int i = 0; i < 3; i++) next[i] = dot(horiz[i], forward);
+        memcpy(forward, next, sizeof(forward));
+        if (!normalize(forward)) return false;
+    }
+
+    // The other horizontal eigenvalue is what is left of the trace
+    float hv[3];
+    for (int i = 0; i < 3; i++) hv[i] = dot(horiz[i], forward);
+    float major = dot(forward, hv);
+    float minor = horiz[0][0] + horiz[1][1] + horiz[2][2] - major;
+    if (major < CAL_MOUNT_MIN_G * CAL_MOUNT_MIN_G || major < CAL_MOUNT_MIN_RATIO * minor) {
+        return false;  // Not enough (or not clearly one-axis) riding motion
+    }
+
+    // Pulling away speeds up; if that is inconclusive assume the sensor
+    // X axis points forward rather than backward
+    float pullAway[3];
+    for (int i = 0; i < 3; i++) {
+        pullAway[i] = mount.shift[i] + mount.signSum[i] / (float)CAL_SIGN_SAMPLES;
+    }
+    float along = dot(pullAway, forward);
+    bool flip = fabsf(along) >= CAL_MOUNT_MIN_SIGN_G ? along < 0.0f : forward[0] < 0.0f;
+    if (flip) {
+        for (int i = 0; i < 3; i++) forward[i] = -forward[i];
+    }
+
+    // Rows: forward, left = up x forward, up
+    float left[3] = {
+        up[1] * forward[2] - up[2] * forward[1],
+        up[2] * forward[0] - up[0] * forward[2],
+        up[0] * forward[1] - up[1] * forward[0]
+    };
+    memcpy(rotation[0], forward, sizeof(forward));
+    memcpy(rotation[1], left, sizeof(left));
+    memcpy(rotation[2], up, sizeof(up));
+    return true;
+}
+
+// True (and `rotation` set) when a riding window gave a clear answer
+static bool updateMount(const float accel[3], float rotation[3][3]) {
+    if (!mount.started) {
+        // The window opens when the helmet starts moving
+        if (accelDeviation(accel) <= CAL_REST_MAX_G) return false;
+        memset(&mount, 0, sizeof(mount));
+        memcpy(mount.shift, accel, sizeof(mount.shift));
+        mount.started = true;
+    }
+
+    float d[3];
+    for (int i = 0; i < 3; i++) {
+        d[i] = accel[i] - mount.shift[i];
+        mount.sum[i] += d[i];
+        if (mount.n < CAL_SIGN_SAMPLES) mount.signSum[i] += d[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            mount.sumProducts[i][j] += d[i] * d[j];
+        }
+    }
+    if (++mount.n < CAL_MOUNT_SAMPLES) return false;
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < i; j++) {
+            mount.sumProducts[i][j] = mount.sumProducts[j][i];
+        }
+    }
+    mount.started = false;
+    return solveMount(rotation);
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void calibrationSet(const Calibration* calibration) {
+    if (calibration != nullptr && calibration->version == CALIBRATION_VERSION) {
+        active = *calibration;
+    } else {
+        setIdentity(active);
+    }
+    rest.n = 0;
+    mount.started = false;
+    activeFlags = active.flags;
+}
+
+bool calibrationUpdate(const float accel[3], const float gyro[3]) {
+    bool changed = false;
+    if (restartRequested.exchange(false)) {
+        setIdentity(active);
+        rest.n = 0;
+        mount.started = false;
+        changed = true;
+    }
+
+    uint8_t flags = active.flags;
+    if (flags == CAL_COMPLETE && !changed) return false;
+
+    float bias[3];
+    if (!(flags & CALIBRATION_GYRO_BIAS) && updateRest(accel, gyro, bias)) {
+        memcpy(active.gyroBias, bias, sizeof(bias));
+        flags |= CALIBRATION_GYRO_BIAS;
+        changed = true;
+    }
+
+    float rotation[3][3];
+    if (!(flags & CALIBRATION_MOUNTING) && updateMount(accel, rotation)) {
+        memcpy(active.rotation, rotation, sizeof(rotation));
+        flags |= CALIBRATION_MOUNTING;
+        changed = true;
+    }
+
+    if (changed) {
+        active.flags = flags;
+        activeFlags = flags;
+        finished.push(active);
+    }
+    return changed;
+}
+
+void calibrationApply(float accel[3], float gyro[3]) {
+    float a[3] = { accel[0], accel[1], accel[2] };
+    float g[3] = { gyro[0] - active.gyroBias[0],
+                   gyro[1] - active.gyroBias[1],
+                   gyro[2] - active.gyroBias[2] };
+
+    for (int i = 0; i < 3; i++) {
+        accel[i] = dot(active.rotation[i], a);
+        gyro[i] = dot(active.rotation[i], g);
+    }
+}
+
+void calibrationRestart() {
+    restartRequested = true;
+}
+
+bool calibrationTakeFinished(Calibration& calibration) {
+    return finished.pop(calibration);
+}
+
+uint8_t calibrationFlags() {
+    return activeFlags;
+}
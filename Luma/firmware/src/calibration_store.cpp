@@ -0,0 +1,47 @@
+/*
+ * IMU calibration - NVS load / save (firmware only)
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "calibration.h"
+#include "log.h"
+
+void calibrationBegin() {
+    Calibration stored;
+    bool found = false;
+
+    Preferences prefs;
+    if (prefs.begin(CAL_NVS_NAMESPACE, true)) {
+        found = prefs.getBytesLength("cal") == sizeof(stored) &&
+                prefs.getBytes("cal", &stored, sizeof(stored)) == sizeof(stored);
+        prefs.end();
+    }
+    calibrationSet(found ? &stored : nullptr);
+
+    uint8_t flags = calibrationFlags();
+    Serial.print("Calibration: ");
+    Serial.print(flags & CALIBRATION_GYRO_BIAS ? "gyro bias stored, " : "gyro bias pending, ");
+    Serial.println(flags & CALIBRATION_MOUNTING ? "mounting stored" : "mounting pending");
+}
+
+void calibrationService() {
+    Calibration c;
+    while (calibrationTakeFinished(c)) {
+        LOG_I("Calibration: gyro bias %.2f %.2f %.2f dps",
+              c.gyroBias[0], c.gyroBias[1], c.gyroBias[2]);
+        LOG_I("Calibration: forward %.2f %.2f %.2f, up %.2f %.2f %.2f",
+              c.rotation[0][0], c.rotation[0][1], c.rotation[0][2],
+              c.rotation[2][0], c.rotation[2][1], c.rotation[2][2]);
+
+        Preferences prefs;
+        if (!prefs.begin(CAL_NVS_NAMESPACE, false)) {
+            LOG_E("Calibration: NVS unavailable, not saved");
+            continue;
+        }
+        prefs.putBytes("cal", &c, sizeof(c));
+        prefs.end();
+        LOG_I("Calibration: saved");
+    }
+}
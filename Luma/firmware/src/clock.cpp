@@ -0,0 +1,10 @@
+/*
+ * Firmware clock for the hardware-independent modules
+ */
+
+#include <Arduino.h>
+#include "clock.h"
+
+uint32_t clockMillis() {
+    return millis();
+}
@@ -0,0 +1,149 @@
+/*
+ * Command protocol - TLV frames from the app, executed by the control
+ * task
+ */
+
+#include <string.h>
+#include "config.h"
+#include "calibration.h"
+#include "command.h"
+#include "helmet_state.h"
+#include "settings.h"
+
+bool commandParse(const uint8_t* data, size_t len, CommandFrame& frame) {
+    frame.count = 0;
+
+    if (len == 1) {
+        frame.framed = false;
+        frame.seq = 0;
+        frame.commands[0].type = data[0];
+        frame.commands[0].len = 0;
+        frame.count = 1;
+        return true;
+    }
+    if (len < 2 || data[0] != CMD_FRAME_MAGIC) return false;
+
+    frame.framed = true;
+    frame.seq = data[1];
+
+    size_t pos = 2;
+    while (pos + 2 <= len && frame.count < CMD_MAX_PER_FRAME) {
+        Command& cmd = frame.commands[frame.count++];
+        cmd.type = data[pos];
+        uint8_t valueLen = data[pos + 1];
+        pos += 2;
+
+        if (pos + valueLen > len) {
+            // Runs past the write: nothing after it can be trusted
+            cmd.len = CMD_LEN_MALFORMED;
+            break;
+        }
+        if (valueLen > CMD_MAX_VALUE) {
+            cmd.len = CMD_LEN_MALFORMED;
+        } else {
+            cmd.len = valueLen;
+            memcpy(cmd.value, &data[pos], valueLen);
+        }
+        pos += valueLen;
+    }
+    // A framed write with no commands is still acked (a ping)
+    return true;
+}
+
+static uint8_t settingStatus(SettingStatus status) {
+    switch (status) {
+        case SETTING_OK:         return CMD_STATUS_OK;
+        case SETTING_UNKNOWN:    return CMD_STATUS_UNKNOWN_SETTING;
+        case SETTING_BAD_LENGTH: return CMD_STATUS_BAD_LENGTH;
+        default:                 return CMD_STATUS_OUT_OF_RANGE;
+    }
+}
+
+// Run one command; `data` receives up to 1 + SETTING_MAX_LEN bytes of
+// reply, `dataLen` its length. Settings commands work on `draft`.
+static uint8_t execute(const Command& cmd, Settings& draft, uint8_t* data, uint8_t& dataLen) {
+    dataLen = 0;
+    if (cmd.len == CMD_LEN_MALFORMED) return CMD_STATUS_BAD_LENGTH;
+
+    // The single-byte commands take no value
+    bool simple = cmd.type >= CMD_TURN_LEFT_ON && cmd.type <= CMD_RECALIBRATE;
+    if (simple && cmd.len != 0) return CMD_STATUS_BAD_LENGTH;
+
+    switch (cmd.type) {
+        case CMD_TURN_LEFT_ON:      stateDispatch(EVENT_TURN_LEFT_ON); break;
+        case CMD_TURN_LEFT_OFF:     stateDispatch(EVENT_TURN_LEFT_OFF); break;
+        case CMD_TURN_RIGHT_ON:     stateDispatch(EVENT_TURN_RIGHT_ON); break;
+        case CMD_TURN_RIGHT_OFF:    stateDispatch(EVENT_TURN_RIGHT_OFF); break;
+        case CMD_CRASH_FALSE_ALARM: stateDispatch(EVENT_CRASH_FALSE_ALARM); break;
+        case CMD_PARTY_MODE:        stateDispatch(EVENT_PARTY_MODE); break;
+        case CMD_NORMAL_MODE:       stateDispatch(EVENT_NORMAL_MODE); break;
+        case CMD_RECALIBRATE:       calibrationRestart(); break;
+
+        case CMD_SET_SETTING:
+            if (cmd.len < 1) return CMD_STATUS_BAD_LENGTH;
+            return settingStatus(settingsSet(draft, cmd.value[0], &cmd.value[1], cmd.len - 1));
+
+        case CMD_GET_SETTING: {
+            if (cmd.len != 1) return CMD_STATUS_BAD_LENGTH;
+            size_t n = settingsRead(draft, cmd.value[0], &data[1]);
+            if (n == 0) return CMD_STATUS_UNKNOWN_SETTING;
+            data[0] = cmd.value[0];
+            dataLen = (uint8_t)(1 + n);
+            break;
+        }
+
+        case CMD_RESET_SETTINGS:
+            if (cmd.len != 0) return CMD_STATUS_BAD_LENGTH;
+            draft = settingsDefaults();
+            break;
+
+        default:
+            return CMD_STATUS_UNKNOWN_COMMAND;
+    }
+    return CMD_STATUS_OK;
+}
+
+size_t commandExecute(const CommandFrame& frame, uint8_t* ack) {
+    size_t len = 0;
+    if (frame.framed) {
+        ack[len++] = CMD_FRAME_MAGIC;
+        ack[len++] = frame.seq;
+    }
+
+    // All setting changes of a frame are published together
+    Settings draft = settingsGet();
+    for (uint8_t i = 0; i < frame.count; i++) {
+        const Command& cmd = frame.commands[i];
+        uint8_t data[1 + SETTING_MAX_LEN];
+        uint8_t dataLen;
+        uint8_t status = execute(cmd, draft, data, dataLen);
+
+        if (!frame.framed) continue;
+        ack[len++] = cmd.type;
+        ack[len++] = status;
+        ack[len++] = dataLen;
+        memcpy(&ack[len], data, dataLen);
+        len += dataLen;
+    }
+    if (memcmp(&draft, &settingsGet(), sizeof(draft)) != 0) {
+        settingsPublish(draft);
+    }
+    return len;
+}
+
+size_t commandAckPart(const uint8_t* ack, size_t len, size_t& pos, size_t maxLen, uint8_t* out) {
+    if (pos < 2) pos = 2;
+
+    size_t outLen = 2;
+    while (pos + 3 <= len) {
+        size_t entryLen = 3 + ack[pos + 2];
+        if (outLen + entryLen > maxLen) break;
+        memcpy(&out[outLen], &ack[pos], entryLen);
+        outLen += entryLen;
+        pos += entryLen;
+    }
+    if (outLen == 2) pos = len;  // Nothing fits: never stall on a part
+    out[0] = pos < len ? CMD_ACK_CONTINUED : CMD_FRAME_MAGIC;
+    out[1] = ack[1];
+    return outLen;
+}
@@ -0,0 +1,122 @@
+/*
+ * Crash detector - impact window over the full-rate |a| stream
+ *
+ * A handful of compares and one add per sample; nothing is buffered, the
+ * pre-impact signature is a pair of counters.
+ */
+
+#include "config.h"
+#include "crash_detector.h"
+
+#define CRASH_IMPACT_SAMPLES   (CRASH_IMPACT_MS * IMU_SAMPLE_RATE_HZ / 1000)
+#define CRASH_FREEFALL_SAMPLES (CRASH_FREEFALL_MS * IMU_SAMPLE_RATE_HZ / 1000)
+#define CRASH_PRE_SAMPLES      (CRASH_PRE_MS * IMU_SAMPLE_RATE_HZ / 1000)
+#define CRASH_SETTLE_SAMPLES   (CRASH_SETTLE_MS * IMU_SAMPLE_RATE_HZ / 1000)
+
+static_assert(CRASH_IMPACT_SAMPLES > 0 && CRASH_SETTLE_SAMPLES > 0, "crash windows too short");
+static_assert(CRASH_PRE_SAMPLES < 0xFFFF && CRASH_SETTLE_SAMPLES < 0xFFFF, "crash windows too long");
+
+template <typename Math>
+CrashDetector<Math>::CrashDetector() : impactG(Math::fromFloat(CRASH_G_THRESHOLD)) {
+    reset();
+}
+
+template <typename Math>
+void CrashDetector<Math>::reset() {
+    phase = PHASE_WATCH;
+    phaseSamples = 0;
+    freefallRun = 0;
+    sinceSignature = 0xFFFF;
+    stillSamples = 0;
+    peak = Value(0);
+    energy = Value(0);
+    preSignature = false;
+}
+
+template <typename Math>
+bool CrashDetector<Math>::decide(bool still, CrashReport& report) {
+    static constexpr Value SEVERE_G = Math::fromFloat(CRASH_SEVERE_G);
+    static constexpr Value ENERGY_MIN = Math::fromFloat(CRASH_ENERGY_GS * IMU_SAMPLE_RATE_HZ);
+
+    bool energetic = energy >= ENERGY_MIN;
+    report.peakG = Math::toFloat(peak);
+    report.energyGs = Math::toFloat(energy) / IMU_SAMPLE_RATE_HZ;
+    report.preSignature = preSignature;
+    report.still = still;
+    report.severe = peak >= SEVERE_G;
+    report.crash = energetic && (report.severe || preSignature || still);
+    report.samples = (phase == PHASE_SETTLE ? CRASH_IMPACT_SAMPLES : 0) + phaseSamples;
+
+    phase = PHASE_WATCH;
+    phaseSamples = 0;
+    sinceSignature = 0xFFFF;  // The impact's own tumble does not carry over
+    return true;
+}
+
+template <typename Math>
+bool CrashDetector<Math>::update(Value gForce, float gyroSq, CrashReport& report) {
+    static constexpr Value ONE_G = Math::fromFloat(1.0f);
+    static constexpr Value SEVERE_G = Math::fromFloat(CRASH_SEVERE_G);
+    static constexpr Value ENERGY_MIN = Math::fromFloat(CRASH_ENERGY_GS * IMU_SAMPLE_RATE_HZ);
+    static constexpr Value FREEFALL_G = Math::fromFloat(CRASH_FREEFALL_G);
+    static constexpr Value STILL_LO = Math::fromFloat(1.0f - CRASH_STILL_G);
+    static constexpr Value STILL_HI = Math::fromFloat(1.0f + CRASH_STILL_G);
+
+    bool tumbling = gyroSq > CRASH_TUMBLE_DPS * CRASH_TUMBLE_DPS;
+
+    switch (phase) {
+        case PHASE_WATCH:
+            if (gForce < FREEFALL_G) {
+                if (freefallRun < 0xFFFF) freefallRun++;
+            } else {
+                freefallRun = 0;
+            }
+            if (tumbling || freefallRun >= CRASH_FREEFALL_SAMPLES) {
+                sinceSignature = 0;
+            } else if (sinceSignature < 0xFFFF) {
+                sinceSignature++;
+            }
+
+            if (gForce > impactG) {
+                phase = PHASE_IMPACT;
+                phaseSamples = 0;
+                peak = Value(0);
+                energy = Value(0);
+                preSignature = sinceSignature <= CRASH_PRE_SAMPLES;
+                freefallRun = 0;
+            } else {
+                return false;
+            }
+            // Fall through - the peak sample is the first of the window
+
+        case PHASE_IMPACT:
+            if (gForce > peak) peak = gForce;
+            if (gForce > ONE_G) energy += gForce - ONE_G;
+            if (tumbling) preSignature = true;
+            if (++phaseSamples < CRASH_IMPACT_SAMPLES) return false;
+
+            // Decided without stillness: a short spike (no energy), a near
+            // full-scale hit, or an impact that followed a fall / tumble
+            if (energy < ENERGY_MIN || peak >= SEVERE_G || preSignature) {
+                return decide(false, report);
+            }
+
+            phase = PHASE_SETTLE;
+            phaseSamples = 0;
+            stillSamples = 0;
+            return false;
+
+        case PHASE_SETTLE:
+            if (gForce > STILL_LO && gForce < STILL_HI &&
+                gyroSq < CRASH_STILL_DPS * CRASH_STILL_DPS) {
+                stillSamples++;
+            }
+            if (++phaseSamples < CRASH_SETTLE_SAMPLES) return false;
+            return decide(stillSamples * 100u >= CRASH_SETTLE_SAMPLES * (uint32_t)CRASH_STILL_PERCENT,
+                          report);
+    }
+    return false;
+}
+
+template class CrashDetector<FloatMath>;
+template class CrashDetector<FixedMath>;
@@ -0,0 +1,148 @@
+/*
+ * Crash events - impact summary, indication payload and the outbox that
+ * keeps them until the app confirms
+ */
+
+#include <string.h>
+#include "crash_event.h"
+
+static uint16_t saturateU16(float value) {
+    if (value <= 0.0f) return 0;
+    if (value >= 65535.0f) return 65535;
+    return (uint16_t)(value + 0.5f);
+}
+
+static int16_t saturateI16(float value) {
+    if (value <= -32768.0f) return -32768;
+    if (value >= 32767.0f) return 32767;
+    return (int16_t)(value < 0.0f ? value - 0.5f : value + 0.5f);
+}
+
+CrashEvent crashEventMake(uint16_t id, uint32_t timestampMs, const CrashReport* impact,
+                          float pitchDeg, float rollDeg) {
+    CrashEvent event;
+    event.id = id;
+    event.stage = CRASH_STAGE_DETECTED;
+    event.timestampMs = timestampMs;
+    event.pitchDeg = pitchDeg;
+    event.rollDeg = rollDeg;
+    if (impact == nullptr) {
+        event.flags = CRASH_FLAG_NO_REPORT;
+        event.peakG = 0.0f;
+        event.energyGs = 0.0f;
+        return event;
+    }
+    event.flags = (impact->preSignature ? CRASH_FLAG_PRE_SIGNATURE : 0) |
+                  (impact->still ? CRASH_FLAG_STILL : 0) |
+                  (impact->severe ? CRASH_FLAG_SEVERE : 0);
+    event.peakG = impact->peakG;
+    event.energyGs = impact->energyGs;
+    return event;
+}
+
+size_t crashEventEncode(const CrashEvent& event, uint32_t nowMs, uint8_t* out) {
+    uint32_t ageMs = nowMs - event.timestampMs;
+    uint16_t peak = saturateU16(event.peakG * 100.0f);
+    uint16_t energy = saturateU16(event.energyGs * 1000.0f);
+    int16_t pitch = saturateI16(event.pitchDeg * 100.0f);
+    int16_t roll = saturateI16(event.rollDeg * 100.0f);
+
+    out[0] = event.stage;
+    out[1] = event.flags;
+    memcpy(&out[2], &event.id, 2);
+    memcpy(&out[4], &ageMs, 4);
+    memcpy(&out[8], &peak, 2);
+    memcpy(&out[10], &energy, 2);
+    memcpy(&out[12], &pitch, 2);
+    memcpy(&out[14], &roll, 2);
+    return CRASH_EVENT_LEN;
+}
+
+// ============================================
+// OUTBOX
+// ============================================
+
+CrashOutbox::CrashOutbox() : count(0), sending(false) {}
+
+bool CrashOutbox::post(const CrashEvent& event) {
+    // A later stage of a queued crash replaces it and goes out at once
+    for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].event.id == event.id) {
+            entries[i].event = event;
+            entries[i].attempts = 0;
+            return true;
+        }
+    }
+
+    bool dropped = false;
+    if (count == CRASH_OUTBOX_SIZE) {
+        // Drop the oldest, but never the one in flight
+        uint8_t victim = sending ? 1 : 0;
+        memmove(&entries[victim], &entries[victim + 1],
+                (count - victim - 1) * sizeof(Entry));
+        count--;
+        dropped = true;
+    }
+
+    Entry& entry = entries[count++];
+    entry.event = event;
+    entry.attempts = 0;
+    entry.sentStage = 0;
+    entry.nextMs = 0;
+    return !dropped;
+}
+
+bool CrashOutbox::due(uint32_t nowMs, CrashEvent& event) {
+    if (sending || count == 0) return false;
+
+    Entry& head = entries[0];
+    if (head.attempts > 0 && (int32_t)(nowMs - head.nextMs) < 0) return false;
+
+    head.sentStage = head.event.stage;
+    sending = true;
+    event = head.event;
+    return true;
+}
+
+void CrashOutbox::confirmed() {
+    if (!sending) return;
+    sending = false;
+
+    // A new stage arrived while the old one was in flight: send it next
+    if (entries[0].event.stage != entries[0].sentStage) {
+        entries[0].attempts = 0;
+        return;
+    }
+    count--;
+    memmove(&entries[0], &entries[1], count * sizeof(Entry));
+}
+
+void CrashOutbox::failed(uint32_t nowMs) {
+    if (!sending) return;
+    sending = false;
+
+    Entry& head = entries[0];
+    if (head.attempts < 255) head.attempts++;
+
+    uint32_t backoff = CRASH_RETRY_BASE_MS;
+    for (uint8_t i = 1; i < head.attempts && backoff < CRASH_RETRY_MAX_MS; i++) {
+        backoff *= 2;
+    }
+    if (backoff > CRASH_RETRY_MAX_MS) backoff = CRASH_RETRY_MAX_MS;
+    head.nextMs = nowMs + backoff;
+}
+
+void CrashOutbox::retryNow() {
+    for (uint8_t i = 0; i < count; i++) {
+        entries[i].attempts = 0;
+    }
+}
+
+uint32_t CrashOutbox::msUntilDue(uint32_t nowMs) const {
+    if (sending || count == 0) return UINT32_MAX;
+
+    const Entry& head = entries[0];
+    if (head.attempts == 0) return 0;
+    int32_t remaining = (int32_t)(head.nextMs - nowMs);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Detection pipeline - raw sample to brake / crash decision
+ *
+ * Moved out of main.cpp so it builds without the hardware: the firmware
+ * detection task and the native replay share this file unchanged.
+ */
+
+#include <math.h>
+#include "config.h"
+#include "calibration.h"
+#include "clock.h"
+#include "detection.h"
+#include "helmet_state.h"
+#include "settings.h"
+
+// ============================================
+// PIPELINE
+// ============================================
+
+template <typename Math>
+BasicDetectionPipeline<Math>::BasicDetectionPipeline() {
+    reset();
+}
+
+template <typename Math>
+void BasicDetectionPipeline<Math>::reset() {
+    resetAverages();
+    orientation.reset();
+    classifier.reset();
+    crashDetector.reset();
+    speed.reset();
+    crashReportPending = false;
+    lastSampleUs = 0;
+    gForce = Value(0);
+    avgForwardAccel = Value(0);
+    applySettings();
+    applyBias();
+}
+
+template <typename Math>
+void BasicDetectionPipeline<Math>::applySettings() {
+    settingsSeen = settingsGeneration();
+    const Settings& settings = settingsGet();
+
+    // A new window length restarts both averages
+    gForceAverage.setLength(settings.averageSamples);
+    forwardAverage.setLength(settings.averageSamples);
+    brakeG = Math::fromFloat(-settings.brakeG);
+    crashDetector.setImpactG(Math::fromFloat(settings.crashG));
+}
+
+template <typename Math>
+void BasicDetectionPipeline<Math>::applyBias() {
+    biasValid = speed.valid();
+    forwardBias = Math::fromFloat(speed.biasG());
+}
+
+template <typename Math>
+void BasicDetectionPipeline<Math>::resetAverages() {
+    gForceAverage.reset();
+    forwardAverage.reset();
+}
+
+template <typename Math>
+void BasicDetectionPipeline<Math>::correctSpeed(const SpeedFix& fix) {
+    speed.correct(fix);
+    applyBias();
+}
+
+template <typename Math>
+SensorData BasicDetectionPipeline<Math>::filter(const ImuSample& sample) {
+    SensorData data = {0};
+    const ImuRawSample& raw = sample.raw;
+
+    if (settingsGeneration() != settingsSeen) {
+        applySettings();
+    }
+
+    // Resultant G-force (magnitude) straight from the counts; rotating
+    // into the bike frame does not change it
+    gForce = Math::magnitude(raw);
+
+    // Update moving average; only trust it once the window is full
+    Value avg = gForceAverage.update(gForce);
+    data.gForce = Math::toFloat(gForce);
+    data.avgGForce = gForceAverage.full() ? Math::toFloat(avg) : data.gForce;
+
+    // Convert to G (±8g range = 4096 LSB/g)
+    float accel[3] = { raw.accelX / MPU6500_ACCEL_LSB_PER_G,
+                       raw.accelY / MPU6500_ACCEL_LSB_PER_G,
+                       raw.accelZ / MPU6500_ACCEL_LSB_PER_G };
+
+    // Convert to °/s (±500°/s range = 65.5 LSB/°/s)
+    float gyro[3] = { raw.gyroX / MPU6500_GYRO_LSB_PER_DPS,
+                      raw.gyroY / MPU6500_GYRO_LSB_PER_DPS,
+                      raw.gyroZ / MPU6500_GYRO_LSB_PER_DPS };
+
+    // Gyro bias and mounting rotation -> bike frame (X forward, Z up).
+    // A new calibration changes the frame, so the fusion starts over.
+    if (calibrationUpdate(accel, gyro)) {
+        orientation.reset();
+        forwardAverage.reset();
+    }
+    calibrationApply(accel, gyro);
+
+    data.accelX = accel[0];
+    data.accelY = accel[1];
+    data.accelZ = accel[2];
+    data.gyroX = gyro[0];
+    data.gyroY = gyro[1];
+    data.gyroZ = gyro[2];
+
+    // Fuse accel + gyro; gravity removed, in the direction of travel
+    float dt = (sample.timestampUs - lastSampleUs) * 1e-6f;
+    lastSampleUs = sample.timestampUs;
+    orientation.update(data.accelX, data.accelY, data.accelZ,
+                       data.gyroX, data.gyroY, data.gyroZ, dt);
+    data.forwardAccel = orientation.linear().forward;
+
+    // Speed from the forward accel between phone fixes. The brake
+    // average uses the accel with the fused bias removed (0 without
+    // fixes), so residual gravity from a tilted head does not add up.
+    if (dt <= ORIENTATION_MAX_DT_S) {
+        speed.predict(data.forwardAccel, dt);
+    }
+    data.speedValid = speed.valid();
+    data.speedMps = speed.speedMps();
+    if (data.speedValid != biasValid) {
+        applyBias();  // Fix timed out: no bias to remove
+    }
+    avgForwardAccel = forwardAverage.update(Math::fromFloat(data.forwardAccel) - forwardBias);
+    data.avgForwardAccel = Math::toFloat(avgForwardAccel);
+
+    return data;
+}
+
+template <typename Math>
+void BasicDetectionPipeline<Math>::classify(SensorData& data) {
+    // Crash detection - impact window over the full-rate stream
+    float gyroSq = data.gyroX * data.gyroX + data.gyroY * data.gyroY + data.gyroZ * data.gyroZ;
+    if (crashDetector.update(gForce, gyroSq, crashReport)) {
+        crashReportPending = true;
+        if (crashReport.crash) data.isCrash = true;
+    }
+
+    // A brake needs something to brake from: at a standstill the
+    // forward accel is a nodding head. Unknown speed never blocks.
+    bool moving = !data.speedValid || data.speedMps >= BRAKE_MIN_SPEED_MPS;
+
+#if RF_MODEL_AVAILABLE
+    // Brake and crash from the trained classifier; the crash detector
+    // above stays as a backstop for impacts the model has not seen.
+    ImuVector vec = { data.accelX, data.accelY, data.accelZ,
+                      data.gyroX, data.gyroY, data.gyroZ };
+    RfResult event;
+    if (classifier.update(vec, event) && event.confidence >= RF_MIN_CONFIDENCE) {
+        if (event.label == RF_CLASS_CRASH) {
+            data.isCrash = true;
+        }
+        if (event.label == RF_CLASS_BRAKE && !data.isCrash && moving) {
+            data.isBraking = true;
+        }
+    }
+#else
+    // Brake detection - sustained deceleration along the direction of
+    // travel, independent of head tilt. Only if we're not in crash state.
+    if (!data.isCrash && moving && avgForwardAccel < brakeG) {
+        data.isBraking = true;
+    }
+#endif
+}
+
+template <typename Math>
+bool BasicDetectionPipeline<Math>::takeCrashReport(CrashReport& report) {
+    if (!crashReportPending) return false;
+    report = crashReport;
+    crashReportPending = false;
+    return true;
+}
+
+template <typename Math>
+float BasicDetectionPipeline<Math>::pitchDeg() const {
+    return Math::tiltDeg(orientation.gravityX(), orientation.gravityY(), orientation.gravityZ());
+}
+
+template <typename Math>
+float BasicDetectionPipeline<Math>::rollDeg() const {
+    return Math::tiltDeg(orientation.gravityY(), orientation.gravityX(), orientation.gravityZ());
+}
+
+template class BasicDetectionPipeline<FloatMath>;
+template class BasicDetectionPipeline<FixedMath>;
+
+// ============================================
+// STATE MACHINE
+// ============================================
+
+// Brake light hold (detection task only)
+static float brakeOnsetMps = 0.0f;
+static uint32_t brakeLastMs = 0;      // Last braking sample
+static uint32_t brakeHoldMs = BRAKE_HOLD_MIN_MS;
+static bool brakeSpeedScaled = false;
+
+// With a valid speed the hold follows the speed lost since the onset, so
+// a nod or a pothole that slips through flashes briefly while a real stop
+// keeps the full duration
+static void updateBrakeHold(const SensorData& data, bool onset) {
+    if (onset) {
+        brakeOnsetMps = data.speedMps;
+        brakeSpeedScaled = data.speedValid;
+        brakeHoldMs = BRAKE_HOLD_MIN_MS;
+    }
+    if (stateGet() != STATE_BRAKING) return;
+
+    if (!data.speedValid) {
+        brakeSpeedScaled = false;
+        return;
+    }
+    if (data.isBraking) {
+        brakeLastMs = clockMillis();
+    }
+
+    float lost = brakeOnsetMps - data.speedMps;
+    if (lost > 0.0f) {
+        uint32_t maxHold = settingsGet().brakeFlashMs;
+        uint32_t hold = BRAKE_HOLD_MIN_MS + (uint32_t)(lost * BRAKE_HOLD_MS_PER_MPS);
+        if (hold > maxHold) hold = maxHold;
+        if (hold > brakeHoldMs) brakeHoldMs = hold;
+    }
+}
+
+uint8_t detectionDispatch(const SensorData& data) {
+    uint8_t detected = 0;
+
+    if (data.isCrash && stateDispatch(EVENT_CRASH_DETECTED)) {
+        detected |= DETECTED_CRASH;
+    }
+
+    // The state machine ignores brakes during crash alert and turn
+    // signals; over a turn signal the LEDs show them as a layer
+    HelmetState entered;
+    if (data.isBraking) {
+        if (stateDispatch(EVENT_BRAKE_DETECTED, &entered)) {
+            detected |= DETECTED_BRAKE;
+        } else if (entered == STATE_TURN_LEFT || entered == STATE_TURN_RIGHT) {
+            detected |= DETECTED_TURN_BRAKE;
+        }
+    }
+    updateBrakeHold(data, detected & DETECTED_BRAKE);
+    return detected;
+}
+
+void detectionCheckTimeouts(uint32_t nowMs) {
+    if (stateGet() != STATE_BRAKING) return;
+
+    bool expired = brakeSpeedScaled
+        ? nowMs - brakeLastMs >= brakeHoldMs
+        : nowMs - stateEnteredMs() >= settingsGet().brakeFlashMs;
+    if (expired) {
+        stateDispatch(EVENT_BRAKE_TIMEOUT);
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * Fixed-point atan2 - table-driven, integer only
+ */
+
+#include "fixed_point.h"
+
+#define ATAN_TABLE_BITS  6
+#define ATAN_TABLE_SIZE  (1 << ATAN_TABLE_BITS)
+#define ATAN_FRAC_BITS   (15 - ATAN_TABLE_BITS)
+
+// atan(i / 64) in Q16.16 degrees, i = 0..64
+static const q16_t ATAN_TABLE[ATAN_TABLE_SIZE + 1] = {
+    0, 58666, 117304, 175884, 234379, 292760, 350999, 409070,
+    466945, 524598, 582003, 639135, 695970, 752484, 808654, 864460,
+    919879, 974893, 1029481, 1083627, 1137313, 1190524, 1243245, 1295461,
+    1347161, 1398332, 1448965, 1499049, 1548575, 1597536, 1645926, 1693738,
+    1740967, 1787610, 1833663, 1879123, 1923990, 1968261, 2011937, 2055018,
+    2097505, 2139399, 2180703, 2221419, 2261551, 2301101, 2340074, 2378474,
+    2416306, 2453574, 2490285, 2526443, 2562055, 2597126, 2631664, 2665673,
+    2699161, 2732134, 2764600, 2796564, 2828035, 2859019, 2889523, 2919554,
+    2949120,
+};
+
+// atan of a Q15 ratio in [0, 1] -> Q16.16 degrees, 0..45
+static q16_t atanRatio(uint32_t ratio) {
+    uint32_t index = ratio >> ATAN_FRAC_BITS;
+    if (index >= ATAN_TABLE_SIZE) return ATAN_TABLE[ATAN_TABLE_SIZE];
+    int32_t frac = ratio & ((1 << ATAN_FRAC_BITS) - 1);
+    int32_t span = ATAN_TABLE[index + 1] - ATAN_TABLE[index];
+    return ATAN_TABLE[index] + ((span * frac) >> ATAN_FRAC_BITS);
+}
+
+q16_t fixedAtan2Deg(int32_t y, int32_t x) {
+    uint32_t ax = x < 0 ? 0u - (uint32_t)x : (uint32_t)x;
+    uint32_t ay = y < 0 ? 0u - (uint32_t)y : (uint32_t)y;
+    if (ax == 0 && ay == 0) return 0;
+
+    // Keep both under 2^16 so the Q15 ratio fits 32 bits
+    while ((ax | ay) > 0xFFFF) {
+        ax >>= 1;
+        ay >>= 1;
+    }
+
+    q16_t angle;
+    if (ay <= ax) {
+        angle = atanRatio((ay << 15) / ax);
+    } else {
+        angle = 90 * Q16_ONE - atanRatio((ax << 15) / ay);
+    }
+    if (x < 0) angle = 180 * Q16_ONE - angle;
+    return y < 0 ? -angle : angle;
+}
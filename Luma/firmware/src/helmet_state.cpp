@@ -0,0 +1,109 @@
+/*
+ * Helmet state machine - lock-free transitions shared by all tasks
+ */
+
+#include <atomic>
+#include "clock.h"
+#include "helmet_state.h"
+
+struct StateActions {
+    StateAction onEnter;
+    StateAction onExit;
+};
+
+// State and entry time share one word, so a reader never pairs a new
+// state with the previous state's entry time: the state in the low
+// bits, the low 29 bits of millis() above it (wraps after ~6 days; only
+// the time since entry is ever used)
+#define STATE_BITS 3
+#define STATE_MASK ((1u << STATE_BITS) - 1)
+#define ENTERED_MASK (0xFFFFFFFFu >> STATE_BITS)
+
+static_assert(HELMET_STATE_COUNT <= (1 << STATE_BITS), "helmet states do not fit STATE_BITS");
+
+static std::atomic<uint32_t> stateWord{(uint32_t)STATE_NORMAL};
+static StateActions actions[HELMET_STATE_COUNT];
+
+HelmetState stateNext(HelmetState current, HelmetEvent event) {
+    // A crash alert can only be left by the user cancelling it
+    if (current == STATE_CRASH_ALERT) {
+        return event == EVENT_CRASH_FALSE_ALARM ? STATE_NORMAL : current;
+    }
+
+    switch (event) {
+        case EVENT_TURN_LEFT_ON:
+            return STATE_TURN_LEFT;
+
+        case EVENT_TURN_LEFT_OFF:
+            return current == STATE_TURN_LEFT ? STATE_NORMAL : current;
+
+        case EVENT_TURN_RIGHT_ON:
+            return STATE_TURN_RIGHT;
+
+        case EVENT_TURN_RIGHT_OFF:
+            return current == STATE_TURN_RIGHT ? STATE_NORMAL : current;
+
+        case EVENT_PARTY_MODE:
+            return STATE_PARTY;
+
+        case EVENT_NORMAL_MODE:
+            return STATE_NORMAL;
+
+        case EVENT_CRASH_DETECTED:
+            return STATE_CRASH_ALERT;
+
+        case EVENT_BRAKE_DETECTED:
+            // Turn signals keep the state; the LED engine layers the
+            // brake light over them
+            if (current == STATE_TURN_LEFT || current == STATE_TURN_RIGHT) {
+                return current;
+            }
+            return STATE_BRAKING;
+
+        case EVENT_BRAKE_TIMEOUT:
+            return current == STATE_BRAKING ? STATE_NORMAL : current;
+
+        case EVENT_CRASH_FALSE_ALARM:
+            break;
+    }
+    return current;
+}
+
+HelmetState stateGet() {
+    return (HelmetState)(stateWord.load(std::memory_order_acquire) & STATE_MASK);
+}
+
+bool stateDispatch(HelmetEvent event, HelmetState* entered) {
+    uint32_t word = stateWord.load(std::memory_order_acquire);
+    HelmetState current;
+    HelmetState next;
+
+    // Retry if another task changed the state between load and swap
+    do {
+        current = (HelmetState)(word & STATE_MASK);
+        next = stateNext(current, event);
+        if (next == current) {
+            if (entered) *entered = current;
+            return false;
+        }
+    } while (!stateWord.compare_exchange_weak(word, (clockMillis() << STATE_BITS) | (uint32_t)next,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire));
+
+    if (actions[current].onExit) actions[current].onExit(current, next);
+    if (actions[next].onEnter) actions[next].onEnter(current, next);
+
+    if (entered) *entered = next;
+    return true;
+}
+
+uint32_t stateEnteredMs() {
+    uint32_t entered = stateWord.load(std::memory_order_acquire) >> STATE_BITS;
+    uint32_t now = clockMillis();
+    return now - ((now - entered) & ENTERED_MASK);
+}
+
+void stateSetActions(HelmetState state, StateAction onEnter, StateAction onExit) {
+    actions[state].onEnter = onEnter;
+    actions[state].onExit = onExit;
+}
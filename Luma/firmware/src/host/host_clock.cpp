@@ -0,0 +1,16 @@
+/*
+ * Simulated clock for native builds
+ */
+
+#include "clock.h"
+#include "host_clock.h"
+
+static uint32_t nowMs = 0;
+
+uint32_t clockMillis() {
+    return nowMs;
+}
+
+void hostClockSet(uint32_t ms) {
+    nowMs = ms;
+}
@@ -0,0 +1,10 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <stdint.h>
+
+// Native builds only: set the time clockMillis() returns, so timeouts
+// follow the replayed data rather than the host's wall clock
+void hostClockSet(uint32_t ms);
+
+#endif // HOST_CLOCK_H
@@ -0,0 +1,397 @@
+/*
+ * Native replay - runs the firmware detection pipeline over recorded rides
+ *
+ * Reads InfluxDB annotated CSV exports (data-analysis/data), resamples
+ * each labelled event to IMU_SAMPLE_RATE_HZ and feeds it through exactly
+ * the detection.cpp the firmware runs, then scores the brake / crash
+ * decisions against the labels.
+ *
+ *   pio run -e native
+ *   .pio/build/native/program ../data-analysis/data/influxdata_*.csv
+ *
+ * Options: -v prints one line per event, -f replays the fixed-point
+ * pipeline (FixedMath) even if DETECTION_FIXED_POINT selects float.
+ */
+
+// The unit tests (test/, `pio test -e native`) link the same sources
+// and bring their own main()
+#ifndef PIO_UNIT_TESTING
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "calibration.h"
+#include "detection.h"
+#include "helmet_state.h"
+#include "host_clock.h"
+
+// ============================================
+// RECORDED DATA
+// ============================================
+
+struct Row {
+    long index;      // sample_index
+    double time;     // s since the epoch
+    float accel[3];  // g
+    float gyro[3];   // °/s
+};
+
+struct Event {
+    std::string id;
+    std::string label;
+    std::vector<Row> rows;
+};
+
+typedef std::vector<std::string> Record;
+
+// One CSV record; quoted fields may hold commas, quotes ("") and newlines.
+// Returns false at end of input.
+static bool readRecord(FILE* f, Record& record) {
+    record.clear();
+    std::string field;
+    bool quoted = false;
+    bool any = false;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        any = true;
+        if (quoted) {
+            if (c != '"') {
+                field += (char)c;
+            } else {
+                int next = fgetc(f);
+                if (next == '"') {
+                    field += '"';
+                } else {
+                    quoted = false;
+                    if (next != EOF) ungetc(next, f);
+                }
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            record.push_back(field);
+            field.clear();
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            field += (char)c;
+        }
+    }
+    if (!any) return false;
+    record.push_back(field);
+    return true;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static long daysFromCivil(long y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long)doe - 719468;
+}
+
+// RFC3339 UTC ("2025-12-15T09:59:34.845775104Z") -> s since the epoch
+static bool parseTime(const std::string& text, double& seconds) {
+    int y, mo, d, h, mi;
+    double s;
+    if (sscanf(text.c_str(), "%d-%d-%dT%d:%d:%lf", &y, &mo, &d, &h, &mi, &s) != 6) {
+        return false;
+    }
+    seconds = daysFromCivil(y, mo, d) * 86400.0 + h * 3600.0 + mi * 60.0 + s;
+    return true;
+}
+
+static int column(const Record& header, const char* name) {
+    for (size_t i = 0; i < header.size(); i++) {
+        if (header[i] == name) return (int)i;
+    }
+    return -1;
+}
+
+// Append the rows of every table in `path` that has IMU columns
+static bool loadFile(const char* path, std::map<std::string, Event>& events) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+
+    enum { AX, AY, AZ, GX, GY, GZ, EVENT_ID, LABEL, INDEX, TIME, COLUMN_COUNT };
+    static const char* names[COLUMN_COUNT] = {
+        "accel_x", "accel_y", "accel_z", "gyro_x", "gyro_y", "gyro_z",
+        "event_id", "label", "sample_index", "time"
+    };
+
+    Record record;
+    int cols[COLUMN_COUNT];
+    bool inTable = false;   // Header seen for the current table
+    bool useTable = false;  // ... and it has every column we need
+    size_t rows = 0;
+
+    while (readRecord(f, record)) {
+        // Annotations (#group, #datatype, #default) and blank lines
+        // separate tables
+        if (record.size() == 1 && record[0].empty()) {
+            inTable = false;
+            continue;
+        }
+        if (!record[0].empty() && record[0][0] == '#') {
+            inTable = false;
+            continue;
+        }
+
+        if (!inTable) {
+            inTable = true;
+            useTable = true;
+            for (int i = 0; i < COLUMN_COUNT; i++) {
+                cols[i] = column(record, names[i]);
+                if (cols[i] < 0) useTable = false;
+            }
+            continue;
+        }
+        if (!useTable) continue;
+
+        Row row;
+        bool ok = true;
+        for (int i = 0; i < COLUMN_COUNT; i++) {
+            if ((size_t)cols[i] >= record.size()) ok = false;
+        }
+        if (!ok || !parseTime(record[cols[TIME]], row.time)) continue;
+
+        row.index = atol(record[cols[INDEX]].c_str());
+        for (int a = 0; a < 3; a++) {
+            row.accel[a] = (float)atof(record[cols[AX + a]].c_str());
+            row.gyro[a] = (float)atof(record[cols[GX + a]].c_str());
+        }
+
+        Event& event = events[record[cols[EVENT_ID]]];
+        if (event.rows.empty()) {
+            event.id = record[cols[EVENT_ID]];
+            event.label = record[cols[LABEL]];
+        }
+        event.rows.push_back(row);
+        rows++;
+    }
+    fclose(f);
+
+    printf("%s: %zu samples\n", path, rows);
+    return true;
+}
+
+static bool byIndex(const Row& a, const Row& b) {
+    return a.index < b.index;
+}
+
+static bool byStart(const Event* a, const Event* b) {
+    return a->rows.front().time < b->rows.front().time;
+}
+
+// ============================================
+// REPLAY
+// ============================================
+
+// Prediction for one event, worst first
+enum Outcome { OUTCOME_NONE, OUTCOME_BRAKE, OUTCOME_CRASH, OUTCOME_COUNT };
+static const char* outcomeNames[OUTCOME_COUNT] = { "none", "brake", "crash" };
+
+static int16_t toRaw(float value, float lsbPerUnit) {
+    float raw = roundf(value * lsbPerUnit);
+    if (raw > 32767.0f) return 32767;
+    if (raw < -32768.0f) return -32768;
+    return (int16_t)raw;
+}
+
+// Back to STATE_NORMAL so each event starts like a fresh ride
+static void stateToNormal() {
+    stateDispatch(EVENT_CRASH_FALSE_ALARM);
+    stateDispatch(EVENT_NORMAL_MODE);
+}
+
+struct ReplayStats {
+    uint64_t samples;
+    double seconds;  // Replayed ride time
+};
+
+// Feed one event at IMU_SAMPLE_RATE_HZ, linearly interpolating between
+// the recorded samples. `clockUs` carries the simulated time across
+// events.
+template <typename Pipeline>
+static Outcome replayEvent(Pipeline& detector, const Event& event,
+                           uint64_t& clockUs, ReplayStats& stats) {
+    const std::vector<Row>& rows = event.rows;
+    const double step = 1.0 / IMU_SAMPLE_RATE_HZ;
+    const double start = rows.front().time;
+    const double duration = rows.back().time - start;
+
+    detector.reset();
+    stateToNormal();
+
+    uint8_t detected = 0;
+    size_t seg = 0;
+    for (double t = 0.0; t <= duration; t += step) {
+        while (seg + 2 < rows.size() && rows[seg + 1].time - start < t) seg++;
+        const Row& a = rows[seg];
+        const Row& b = rows[seg + 1 < rows.size() ? seg + 1 : seg];
+        double span = b.time - a.time;
+        float w = span > 0.0 ? (float)((t - (a.time - start)) / span) : 0.0f;
+        w = w < 0.0f ? 0.0f : (w > 1.0f ? 1.0f : w);
+
+        ImuSample sample;
+        sample.timestampUs = (uint32_t)clockUs;
+        sample.raw.accelX = toRaw(a.accel[0] + w * (b.accel[0] - a.accel[0]), MPU6500_ACCEL_LSB_PER_G);
+        sample.raw.accelY = toRaw(a.accel[1] + w * (b.accel[1] - a.accel[1]), MPU6500_ACCEL_LSB_PER_G);
+        sample.raw.accelZ = toRaw(a.accel[2] + w * (b.accel[2] - a.accel[2]), MPU6500_ACCEL_LSB_PER_G);
+        sample.raw.gyroX = toRaw(a.gyro[0] + w * (b.gyro[0] - a.gyro[0]), MPU6500_GYRO_LSB_PER_DPS);
+        sample.raw.gyroY = toRaw(a.gyro[1] + w * (b.gyro[1] - a.gyro[1]), MPU6500_GYRO_LSB_PER_DPS);
+        sample.raw.gyroZ = toRaw(a.gyro[2] + w * (b.gyro[2] - a.gyro[2]), MPU6500_GYRO_LSB_PER_DPS);
+        hostClockSet((uint32_t)(clockUs / 1000));
+
+        SensorData data = detector.filter(sample);
+        detector.classify(data);
+        uint8_t now = detectionDispatch(data);
+        if (now & DETECTED_CRASH) detector.resetAverages();
+        detected |= now;
+        detectionCheckTimeouts((uint32_t)(clockUs / 1000));
+
+        clockUs += 1000000 / IMU_SAMPLE_RATE_HZ;
+        stats.samples++;
+    }
+    stats.seconds += duration;
+
+    if (detected & DETECTED_CRASH) return OUTCOME_CRASH;
+    if (detected & DETECTED_BRAKE) return OUTCOME_BRAKE;
+    return OUTCOME_NONE;
+}
+
+// ============================================
+// REPORT
+// ============================================
+
+static Outcome expected(const std::string& label) {
+    if (label == "crash") return OUTCOME_CRASH;
+    if (label == "brake") return OUTCOME_BRAKE;
+    return OUTCOME_NONE;
+}
+
+static void printScores(const std::map<std::string, std::vector<int> >& confusion) {
+    for (int o = OUTCOME_BRAKE; o < OUTCOME_COUNT; o++) {
+        int tp = 0, fp = 0, fn = 0;
+        std::map<std::string, std::vector<int> >::const_iterator it;
+        for (it = confusion.begin(); it != confusion.end(); ++it) {
+            bool positive = expected(it->first) == o;
+            for (int p = 0; p < OUTCOME_COUNT; p++) {
+                int n = it->second[p];
+                if (positive && p == o) tp += n;
+                if (!positive && p == o) fp += n;
+                if (positive && p != o) fn += n;
+            }
+        }
+        double precision = tp + fp > 0 ? (double)tp / (tp + fp) : 0.0;
+        double recall = tp + fn > 0 ? (double)tp / (tp + fn) : 0.0;
+        printf("%-6s precision %5.1f%% (%d/%d)  recall %5.1f%% (%d/%d)\n",
+               outcomeNames[o], precision * 100.0, tp, tp + fp,
+               recall * 100.0, tp, tp + fn);
+    }
+}
+
+int main(int argc, char** argv) {
+    bool verbose = false;
+    bool fixed = DETECTION_FIXED_POINT != 0;
+    std::map<std::string, Event> events;
+    int files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+            continue;
+        }
+        if (strcmp(argv[i], "-f") == 0) {
+            fixed = true;
+            continue;
+        }
+        if (!loadFile(argv[i], events)) return 1;
+        files++;
+    }
+    if (files == 0) {
+        fprintf(stderr, "usage: %s [-v] [-f] export.csv...\n", argv[0]);
+        return 2;
+    }
+
+    // Recorded rows come out of Influx in string order of sample_index
+    std::vector<const Event*> ordered;
+    std::map<std::string, Event>::iterator it;
+    for (it = events.begin(); it != events.end(); ++it) {
+        std::sort(it->second.rows.begin(), it->second.rows.end(), byIndex);
+        if (it->second.label == "unknown") continue;  // Not scored
+        if (it->second.rows.size() < 2) continue;
+        ordered.push_back(&it->second);
+    }
+    std::sort(ordered.begin(), ordered.end(), byStart);
+
+    // The recordings are already in the frame detection expects; freeze
+    // calibration so no estimate replaces it mid-replay
+    Calibration identity;
+    memset(&identity, 0, sizeof(identity));
+    identity.version = CALIBRATION_VERSION;
+    identity.flags = CALIBRATION_GYRO_BIAS | CALIBRATION_MOUNTING;
+    for (int i = 0; i < 3; i++) identity.rotation[i][i] = 1.0f;
+    calibrationSet(&identity);
+
+    static BasicDetectionPipeline<FloatMath> floatDetector;
+    static BasicDetectionPipeline<FixedMath> fixedDetector;
+    printf("%s pipeline\n", fixed ? "Fixed-point" : "Float");
+    std::map<std::string, std::vector<int> > confusion;
+    ReplayStats stats = { 0, 0.0 };
+    uint64_t clockUs = 0;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ordered.size(); i++) {
+        const Event& event = *ordered[i];
+        Outcome outcome = fixed ? replayEvent(fixedDetector, event, clockUs, stats)
+                                : replayEvent(floatDetector, event, clockUs, stats);
+
+        std::vector<int>& row = confusion[event.label];
+        row.resize(OUTCOME_COUNT);
+        row[outcome]++;
+
+        if (verbose) {
+            printf("%s %-7s -> %s%s\n", event.id.c_str(), event.label.c_str(),
+                   outcomeNames[outcome],
+                   outcome == expected(event.label) ? "" : "  MISS");
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    // ---- Confusion table: label (rows) x prediction (columns) ----
+    printf("\n%-8s", "label");
+    for (int p = 0; p < OUTCOME_COUNT; p++) printf("%7s", outcomeNames[p]);
+    printf("\n");
+    std::map<std::string, std::vector<int> >::iterator c;
+    for (c = confusion.begin(); c != confusion.end(); ++c) {
+        printf("%-8s", c->first.c_str());
+        for (int p = 0; p < OUTCOME_COUNT; p++) printf("%7d", c->second[p]);
+        printf("\n");
+    }
+    printf("\n");
+    printScores(confusion);
+
+    printf("\n%zu events, %llu samples @ %d Hz, %.1f s of riding\n",
+           ordered.size(), (unsigned long long)stats.samples,
+           IMU_SAMPLE_RATE_HZ, stats.seconds);
+    if (elapsed > 0.0) {
+        printf("%.3f s: %.0f samples/s, %.0f events/s, %.0fx real time\n",
+               elapsed, stats.samples / elapsed, ordered.size() / elapsed,
+               stats.seconds / elapsed);
+    }
+    return 0;
+}
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,159 @@
+/*
+ * Latency tracing - per-stage histograms of cycle-counter deltas
+ *
+ * Histogram buckets are log-linear: exact below 4 us, then 4 buckets per
+ * power of two, so p99 is known to within a quarter octave from 1 us to
+ * ~1 s with 80 counters per stage.
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include "latency_trace.h"
+#include "log.h"
+
+#define TRACE_SUB_BITS 2
+#define TRACE_SUBS     (1 << TRACE_SUB_BITS)
+#define TRACE_BUCKETS  80
+
+struct StageHistogram {
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t sumUs;
+    uint32_t buckets[TRACE_BUCKETS];
+};
+
+static const char* const STAGE_NAMES[TRACE_STAGE_COUNT] = {
+    "acquired", "filtered", "classified", "transition", "rendered", "latched",
+    "ride erase", "ride write"
+};
+
+static StageHistogram histograms[TRACE_STAGE_COUNT];
+static std::atomic<bool> resetRequested[TRACE_STAGE_COUNT];
+static uint32_t cyclesPerUs = 160;
+
+// Detected event waiting for its LED frame
+static std::atomic<bool> eventPending{false};
+static std::atomic<uint32_t> eventOrigin{0};
+
+static uint8_t bucketOf(uint32_t us) {
+    if (us < TRACE_SUBS) return us;
+    int octave = 31 - __builtin_clz(us);
+    uint32_t sub = (us >> (octave - TRACE_SUB_BITS)) & (TRACE_SUBS - 1);
+    uint32_t bucket = (octave - TRACE_SUB_BITS + 1) * TRACE_SUBS + sub;
+    return bucket < TRACE_BUCKETS ? bucket : TRACE_BUCKETS - 1;
+}
+
+// Largest value that falls into `bucket`
+static uint32_t bucketUpper(uint8_t bucket) {
+    if (bucket < TRACE_SUBS) return bucket;
+    int octave = bucket / TRACE_SUBS + TRACE_SUB_BITS - 1;
+    uint32_t sub = bucket % TRACE_SUBS;
+    return ((TRACE_SUBS + sub + 1) << (octave - TRACE_SUB_BITS)) - 1;
+}
+
+static void clearHistogram(StageHistogram& h) {
+    memset(&h, 0, sizeof(h));
+    h.minUs = UINT32_MAX;
+}
+
+void traceBegin() {
+    cyclesPerUs = getCpuFrequencyMhz();
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        clearHistogram(histograms[s]);
+        resetRequested[s] = false;
+    }
+}
+
+uint32_t traceOrigin(uint32_t timestampUs) {
+    uint32_t nowCycles = traceNow();
+    uint32_t ageUs = micros() - timestampUs;
+    return nowCycles - ageUs * cyclesPerUs;
+}
+
+void traceRecord(TraceStage stage, uint32_t origin, uint32_t now) {
+    StageHistogram& h = histograms[stage];
+    if (resetRequested[stage].exchange(false)) {
+        clearHistogram(h);
+    }
+
+    uint32_t us = (now - origin) / cyclesPerUs;
+    h.count++;
+    h.sumUs += us;
+    if (us < h.minUs) h.minUs = us;
+    if (us > h.maxUs) h.maxUs = us;
+    h.buckets[bucketOf(us)]++;
+}
+
+void traceEventBegin(uint32_t origin) {
+    eventOrigin.store(origin, std::memory_order_relaxed);
+    eventPending.store(true, std::memory_order_release);
+}
+
+bool traceEventTake(uint32_t& origin) {
+    if (!eventPending.exchange(false, std::memory_order_acquire)) return false;
+    origin = eventOrigin.load(std::memory_order_relaxed);
+    return true;
+}
+
+TraceStats traceGetStats(TraceStage stage) {
+    const StageHistogram& h = histograms[stage];
+    TraceStats stats = { 0, 0, 0, 0, 0 };
+    uint32_t count = h.count;
+    if (count == 0) return stats;
+
+    stats.count = count;
+    stats.minUs = h.minUs;
+    stats.maxUs = h.maxUs;
+    stats.avgUs = (uint32_t)(h.sumUs / count);
+
+    // First bucket at which 99% of samples are covered
+    uint32_t target = count - count / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < TRACE_BUCKETS; b++) {
+        seen += h.buckets[b];
+        if (seen >= target) {
+            stats.p99Us = bucketUpper(b);
+            break;
+        }
+    }
+    if (stats.p99Us > stats.maxUs) stats.p99Us = stats.maxUs;
+    return stats;
+}
+
+void traceReset() {
+    // Applied by each stage's writer on its next record
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        resetRequested[s] = true;
+    }
+}
+
+size_t tracePack(uint8_t* out) {
+    out[0] = TRACE_PACKED_VERSION;
+    out[1] = TRACE_STAGE_COUNT;
+    uint8_t* p = out + 2;
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        TraceStats stats = traceGetStats((TraceStage)s);
+        uint32_t fields[5] = { stats.count, stats.minUs, stats.avgUs, stats.p99Us, stats.maxUs };
+        for (int f = 0; f < 5; f++) {
+            p[0] = (uint8_t)fields[f];
+            p[1] = (uint8_t)(fields[f] >> 8);
+            p[2] = (uint8_t)(fields[f] >> 16);
+            p[3] = (uint8_t)(fields[f] >> 24);
+            p += 4;
+        }
+    }
+    return TRACE_PACKED_LEN;
+}
+
+void tracePrint() {
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    LOG_I("Latency (us since data-ready):  count / min / avg / p99 / max");
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        TraceStats stats = traceGetStats((TraceStage)s);
+        LOG_I("  %-11s %8lu %7lu %7lu %7lu %7lu", STAGE_NAMES[s],
+              stats.count, stats.minUs, stats.avgUs, stats.p99Us, stats.maxUs);
+    }
+#endif
+}
@@ -0,0 +1,331 @@
+/*
+ * LED animation engine - time-indexed frame tables, rendered on demand
+ *
+ * A pattern's frame is a pure function of (frame index, table), so
+ * nothing animates through static counters and a state change simply
+ * restarts its pattern at frame 0. Positions come from the compile-time
+ * layout (led_layout.h).
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include <atomic>
+#include "config.h"
+#include "helmet_state.h"
+#include "latency_trace.h"
+#include "led_engine.h"
+#include "led_layout.h"
+#include "led_patterns.h"
+#include "led_strip.h"
+#include "metrics.h"
+#include "settings.h"
+
+#define TURN_FRAMES turnFrames(Layout::Left::count)
+
+static constexpr FrameTable<uint8_t, BREATH_FRAMES> BREATH =
+    makeBreath(MakeIndices<BREATH_FRAMES>::type());
+static constexpr FrameTable<uint8_t, TURN_FRAMES> TURN =
+    makeTurn<Layout::Left::count>(MakeIndices<TURN_FRAMES>::type());
+static constexpr FrameTable<Rgb, WHEEL_SIZE> WHEEL =
+    makeWheel(MakeIndices<WHEEL_SIZE>::type());
+
+static const Rgb RED = { 255, 0, 0 };
+static const Rgb DIM_RED = { 100, 0, 0 };
+static const Rgb WHITE = { 255, 255, 255 };
+static const Rgb ORANGE = { 255, 165, 0 };
+static const Rgb GREEN = { 0, 255, 0 };
+
+// ============================================
+// PATTERNS
+// ============================================
+
+typedef void (*RenderFn)(uint16_t frame, Rgb* pixels);
+
+struct LedPattern {
+    uint16_t frameMs;     // 0: from settings (frameMsFor)
+    uint16_t frameCount;
+    RenderFn render;
+};
+
+template <typename Segment>
+static void fill(Rgb* pixels, Rgb colour) {
+    for (uint16_t i = 0; i < Segment::count; i++) pixels[Segment::at(i)] = colour;
+}
+
+// Lit run of a turn signal, from the centre outwards
+template <typename Segment>
+static void fillRun(Rgb* pixels, uint8_t run, Rgb colour) {
+    for (uint16_t i = 0; i < Segment::count; i++) {
+        if (i < run) pixels[Segment::at(i)] = colour;
+    }
+}
+
+// Soft red glow on the centre LEDs
+static void renderNormal(uint16_t frame, Rgb* pixels) {
+    Rgb glow = { BREATH[frame], 0, 0 };
+    fill<Layout::Center>(pixels, glow);
+}
+
+static void renderBrake(uint16_t frame, Rgb* pixels) {
+    fill<Layout::Rear>(pixels, frame == 0 ? RED : DIM_RED);
+}
+
+static void renderTurnLeft(uint16_t frame, Rgb* pixels) {
+    fillRun<Layout::Left>(pixels, TURN[frame], ORANGE);
+}
+
+static void renderTurnRight(uint16_t frame, Rgb* pixels) {
+    fillRun<Layout::Right>(pixels, TURN[frame], ORANGE);
+}
+
+static void renderCrash(uint16_t frame, Rgb* pixels) {
+    fill<Layout::Rear>(pixels, frame == 0 ? RED : WHITE);
+}
+
+static void renderParty(uint16_t frame, Rgb* pixels) {
+    for (uint16_t i = 0; i < Layout::Rear::count; i++) {
+        pixels[Layout::Rear::at(i)] = WHEEL[(i * WHEEL_SIZE / Layout::count + frame) % WHEEL_SIZE];
+    }
+}
+
+// Indexed by HelmetState
+static const LedPattern PATTERNS[] = {
+    { 0,   BREATH_FRAMES, renderNormal },     // STATE_NORMAL
+    { 100, 2,             renderBrake },      // STATE_BRAKING
+    { 0,   TURN_FRAMES,   renderTurnLeft },   // STATE_TURN_LEFT
+    { 0,   TURN_FRAMES,   renderTurnRight },  // STATE_TURN_RIGHT
+    { 50,  2,             renderCrash },      // STATE_CRASH_ALERT
+    { 20,  WHEEL_SIZE,    renderParty },      // STATE_PARTY
+};
+
+static_assert(sizeof(PATTERNS) / sizeof(PATTERNS[0]) == HELMET_STATE_COUNT,
+              "one LED pattern per HelmetState");
+
+// Startup: light one more LED per frame, then hold all of them
+static void renderStartup(uint16_t frame, Rgb* pixels) {
+    for (uint16_t i = 0; i < Layout::Rear::count; i++) {
+        if (i <= frame) pixels[Layout::Rear::at(i)] = GREEN;
+    }
+}
+
+static void renderSensorFault(uint16_t frame, Rgb* pixels) {
+    if (frame == 0) fill<Layout::Rear>(pixels, RED);
+}
+
+// Indexed by LedOverlay - 1
+static const LedPattern OVERLAYS[] = {
+    { 50,  NUM_LEDS + 10, renderStartup },      // LED_OVERLAY_STARTUP (1.1 s with 12 LEDs)
+    { 500, 2,             renderSensorFault },  // LED_OVERLAY_SENSOR_FAULT
+};
+
+// ============================================
+// LAYERS
+// ============================================
+
+// A layer is a pattern of its own, started when it switches on and
+// blended over the state's frame in the states it applies to. The brake
+// light is one while a turn signal holds the state (the state machine
+// keeps the turn signal; detection only extends the hold).
+struct LedLayer {
+    LedPattern pattern;
+    uint16_t states;      // Bit per HelmetState the layer shows in
+};
+
+#define STATE_BIT(s) (1u << (s))
+
+static const LedLayer BRAKE_LAYER = {
+    { 100, 2, renderBrake },  // As STATE_BRAKING
+    STATE_BIT(STATE_TURN_LEFT) | STATE_BIT(STATE_TURN_RIGHT)
+};
+
+// Per-channel maximum: a layer shows where it is brighter, so the amber
+// of a turn signal stays readable over the brake light
+static void blendLighten(Rgb* pixels, const Rgb* layer) {
+    for (uint16_t i = 0; i < Layout::count; i++) {
+        if (layer[i].r > pixels[i].r) pixels[i].r = layer[i].r;
+        if (layer[i].g > pixels[i].g) pixels[i].g = layer[i].g;
+        if (layer[i].b > pixels[i].b) pixels[i].b = layer[i].b;
+    }
+}
+
+// Frame time of `state`; the running light and turn signals are tunable
+static uint16_t frameMsFor(HelmetState state) {
+    const Settings& settings = settingsGet();
+    switch (state) {
+        case STATE_NORMAL:     return settings.animationSpeedMs;
+        case STATE_TURN_LEFT:
+        case STATE_TURN_RIGHT: return settings.turnSignalSpeedMs;
+        default:               return PATTERNS[state].frameMs;
+    }
+}
+
+// ============================================
+// ENGINE
+// ============================================
+
+static Rgb backBuffer[NUM_LEDS];
+static Rgb layerBuffer[NUM_LEDS];
+static HelmetState activeState = STATE_NORMAL;
+static uint32_t patternStartMs = 0;
+static uint32_t shownStep = 0;   // Frame steps since the pattern started
+static bool frameValid = false;  // backBuffer holds the current step
+static std::atomic<bool> blankRequested{false};
+static std::atomic<uint8_t> overlayRequested{LED_OVERLAY_NONE};
+static uint8_t activeOverlay = LED_OVERLAY_NONE;
+static bool blanked = false;
+static uint8_t brightness = LED_BRIGHTNESS;
+static uint16_t frameMs = 0;    // Of activeState
+
+// Brake layer: held until brakeUntilMs (any task), shown from brakeStartMs
+static std::atomic<uint32_t> brakeUntilMs{0};
+static bool brakeLayerOn = false;
+static uint32_t brakeStartMs = 0;
+static uint32_t shownBrakeStep = 0;
+
+// Nothing animates while blank; the setter's wake-up ends the wait early
+#define BLANK_POLL_MS 1000
+
+// Detected event whose first frame is being traced
+static bool tracing = false;
+static bool awaitingLatch = false;
+static uint32_t traceOriginCycles = 0;
+static uint32_t tracedFrame = 0;
+
+bool ledEngineBegin() {
+    if (!ledStripBegin()) return false;
+    brightness = settingsGet().ledBrightness;
+    ledStripSetBrightness(brightness);
+    return true;
+}
+
+void ledEngineSetBlank(bool blank) {
+    blankRequested = blank;
+}
+
+void ledEngineSetOverlay(LedOverlay overlay) {
+    overlayRequested = overlay;
+}
+
+bool ledEngineHoldBrake(uint32_t nowMs, uint32_t untilMs) {
+    uint32_t previous = brakeUntilMs.exchange(untilMs);
+    return (int32_t)(previous - nowMs) <= 0;
+}
+
+// Overlay to show for `state`. The startup sweep ends itself once played
+// or as soon as another state shows, so it never delays a brake light.
+static uint8_t overlayFor(HelmetState state, uint32_t nowMs) {
+    uint8_t overlay = overlayRequested.load();
+    if (overlay == LED_OVERLAY_STARTUP) {
+        const LedPattern& sweep = OVERLAYS[LED_OVERLAY_STARTUP - 1];
+        bool played = activeOverlay == LED_OVERLAY_STARTUP &&
+                      nowMs - patternStartMs >= (uint32_t)sweep.frameMs * sweep.frameCount;
+        if (state != STATE_NORMAL || played) {
+            uint8_t expected = LED_OVERLAY_STARTUP;
+            overlayRequested.compare_exchange_strong(expected, LED_OVERLAY_NONE);
+            overlay = LED_OVERLAY_NONE;
+        }
+    }
+    return state == STATE_NORMAL ? overlay : (uint8_t)LED_OVERLAY_NONE;
+}
+
+uint32_t ledEngineUpdate(HelmetState state, uint32_t nowMs) {
+    bool blank = blankRequested.load();
+    if (blank != blanked) {
+        blanked = blank;
+        patternStartMs = nowMs;
+        frameValid = false;
+    }
+    if (blanked) {
+        if (!frameValid) {
+            memset(backBuffer, 0, sizeof(backBuffer));
+            frameValid = ledStripShow(backBuffer);
+        }
+        return frameValid ? BLANK_POLL_MS : 1;
+    }
+
+    // A new brightness from the app shows on the current frame
+    uint8_t wanted = settingsGet().ledBrightness;
+    if (wanted != brightness) {
+        brightness = wanted;
+        ledStripSetBrightness(brightness);
+        frameValid = false;
+    }
+
+    if (state != activeState) {
+        activeState = state;
+        patternStartMs = nowMs;
+        frameValid = false;
+        // Only state changes raised by detection carry a trace
+        tracing = traceEventTake(traceOriginCycles);
+        awaitingLatch = false;
+    }
+
+    uint8_t overlay = overlayFor(state, nowMs);
+    if (overlay != activeOverlay) {
+        activeOverlay = overlay;
+        patternStartMs = nowMs;
+        frameValid = false;
+    }
+    const LedPattern& pattern = overlay != LED_OVERLAY_NONE ? OVERLAYS[overlay - 1] : PATTERNS[state];
+
+    // A new frame time (settings) restarts the pattern at that speed
+    uint16_t ms = overlay != LED_OVERLAY_NONE ? pattern.frameMs : frameMsFor(state);
+    if (ms != frameMs) {
+        frameMs = ms;
+        patternStartMs = nowMs;
+        frameValid = false;
+    }
+
+    uint32_t elapsed = nowMs - patternStartMs;
+    uint32_t step = elapsed / frameMs;
+
+    // The brake layer starts its own pattern when the hold begins
+    uint32_t brakeLeft = brakeUntilMs.load() - nowMs;
+    bool brakeLayer = (BRAKE_LAYER.states & STATE_BIT(state)) && (int32_t)brakeLeft > 0;
+    if (brakeLayer != brakeLayerOn) {
+        brakeLayerOn = brakeLayer;
+        brakeStartMs = nowMs;
+        frameValid = false;
+    }
+    uint32_t brakeElapsed = nowMs - brakeStartMs;
+    uint32_t brakeStep = brakeLayerOn ? brakeElapsed / BRAKE_LAYER.pattern.frameMs : 0;
+
+    if (!frameValid || step != shownStep || brakeStep != shownBrakeStep) {
+        uint32_t renderStartUs = micros();
+        memset(backBuffer, 0, sizeof(backBuffer));
+        pattern.render(step % pattern.frameCount, backBuffer);
+        if (brakeLayerOn) {
+            memset(layerBuffer, 0, sizeof(layerBuffer));
+            BRAKE_LAYER.pattern.render(brakeStep % BRAKE_LAYER.pattern.frameCount, layerBuffer);
+            blendLighten(backBuffer, layerBuffer);
+        }
+        // A busy strip keeps the frame pending for the next call
+        frameValid = ledStripShow(backBuffer);
+        shownStep = step;
+        shownBrakeStep = brakeStep;
+        metricsPeak(METRIC_LED_FRAME_MAX_US, micros() - renderStartUs);
+
+        if (frameValid && tracing) {
+            traceRecord(TRACE_RENDERED, traceOriginCycles);
+            tracedFrame = ledStripFramesStarted();
+            tracing = false;
+            awaitingLatch = true;
+        }
+    }
+
+    // Completion time comes from the RMT interrupt; collect it once seen
+    if (awaitingLatch && (int32_t)(ledStripFramesSent() - tracedFrame) >= 0) {
+        traceRecord(TRACE_LATCHED, traceOriginCycles, ledStripLastSentCycles());
+        awaitingLatch = false;
+    }
+
+    // Poll quickly while a frame is pending on the strip or being traced
+    if (!frameValid || awaitingLatch) return 1;
+    uint32_t next = frameMs - elapsed % frameMs;
+    if (brakeLayerOn) {
+        uint16_t brakeMs = BRAKE_LAYER.pattern.frameMs;
+        if (brakeMs - brakeElapsed % brakeMs < next) next = brakeMs - brakeElapsed % brakeMs;
+        if (brakeLeft < next) next = brakeLeft;  // Hold ends: back to the plain frame
+    }
+    return next;
+}
@@ -0,0 +1,109 @@
+/*
+ * WS2812B driver on the ESP32-C3 RMT peripheral
+ *
+ * Replaces Adafruit_NeoPixel::show(), which waits for the whole frame to
+ * be sent. Here show() only encodes the frame and starts the RMT
+ * transmit; the symbol buffer is left alone until the transmit is done,
+ * which ledStripBusy() reports.
+ */
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "config.h"
+#include "latency_trace.h"
+#include "led_strip.h"
+
+#define LED_RMT_CHANNEL RMT_CHANNEL_0
+
+// 80 MHz APB / 2 = 25 ns per tick
+#define LED_RMT_CLK_DIV 2
+#define T0H_TICKS 16  // 0.40 us
+#define T0L_TICKS 34  // 0.85 us
+#define T1H_TICKS 32  // 0.80 us
+#define T1L_TICKS 18  // 0.45 us
+
+#define BITS_PER_LED 24
+
+static rmt_item32_t symbols[NUM_LEDS * BITS_PER_LED];
+static uint16_t brightnessScale = 256;  // brightness + 1, as Adafruit_NeoPixel
+static bool ready = false;
+
+static volatile uint32_t framesStarted = 0;
+static volatile uint32_t framesSent = 0;
+static volatile uint32_t lastSentCycles = 0;
+
+// RMT transmit-end interrupt: the last bit has left the pin
+static void IRAM_ATTR onTransmitDone(rmt_channel_t channel, void* arg) {
+    lastSentCycles = traceNow();
+    framesSent = framesSent + 1;
+}
+
+static void encodeByte(uint8_t value, rmt_item32_t* out) {
+    for (int bit = 0; bit < 8; bit++) {
+        bool one = value & (0x80 >> bit);
+        out[bit].level0 = 1;
+        out[bit].duration0 = one ? T1H_TICKS : T0H_TICKS;
+        out[bit].level1 = 0;
+        out[bit].duration1 = one ? T1L_TICKS : T0L_TICKS;
+    }
+}
+
+bool ledStripBegin() {
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)PIN_LED, LED_RMT_CHANNEL);
+    config.clk_div = LED_RMT_CLK_DIV;
+    // Two memory blocks halve the refill interrupts per frame
+    config.mem_block_num = 2;
+
+    if (rmt_config(&config) != ESP_OK) return false;
+    if (rmt_driver_install(LED_RMT_CHANNEL, 0, 0) != ESP_OK) return false;
+    rmt_register_tx_end_callback(onTransmitDone, nullptr);
+
+    ready = true;
+    return true;
+}
+
+void ledStripSetBrightness(uint8_t brightness) {
+    brightnessScale = (uint16_t)brightness + 1;
+}
+
+bool ledStripBusy() {
+    return ready && rmt_wait_tx_done(LED_RMT_CHANNEL, 0) != ESP_OK;
+}
+
+bool ledStripShow(const Rgb* pixels) {
+    if (!ready || ledStripBusy()) return false;
+
+    // WS2812B wire order is G, R, B
+    rmt_item32_t* out = symbols;
+    for (int i = 0; i < NUM_LEDS; i++) {
+        encodeByte((pixels[i].g * brightnessScale) >> 8, out);
+        encodeByte((pixels[i].r * brightnessScale) >> 8, out + 8);
+        encodeByte((pixels[i].b * brightnessScale) >> 8, out + 16);
+        out += BITS_PER_LED;
+    }
+
+    // The line idles low between frames, which is the latch/reset
+    if (rmt_write_items(LED_RMT_CHANNEL, symbols, NUM_LEDS * BITS_PER_LED, false) != ESP_OK) {
+        return false;
+    }
+    framesStarted = framesStarted + 1;
+    return true;
+}
+
+bool ledStripFill(Rgb colour) {
+    Rgb pixels[NUM_LEDS];
+    for (int i = 0; i < NUM_LEDS; i++) pixels[i] = colour;
+    return ledStripShow(pixels);
+}
+
+uint32_t ledStripFramesStarted() {
+    return framesStarted;
+}
+
+uint32_t ledStripFramesSent() {
+    return framesSent;
+}
+
+uint32_t ledStripLastSentCycles() {
+    return lastSentCycles;
+}
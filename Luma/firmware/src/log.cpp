@@ -0,0 +1,151 @@
+/*
+ * Deferred logging - binary records in, formatted lines out
+ *
+ * Formatting works one conversion at a time: the format is split at each
+ * '%' spec and every spec is handed to snprintf with the one argument it
+ * consumes, so the records never need a va_list.
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include "config.h"
+#include "log.h"
+#include "mpsc_queue.h"
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+
+struct LogRecord {
+    uint32_t timestampUs;
+    const char* format;
+    uint8_t level;
+    uint8_t count;
+    uint8_t types[LOG_MAX_ARGS];  // LogArgType, kept apart to avoid padding
+    LogValue args[LOG_MAX_ARGS];
+};
+
+static MpscQueue<LogRecord, LOG_QUEUE_SIZE> records;
+static std::atomic<uint32_t> droppedCount{0};
+static uint32_t droppedReported = 0;  // Drain side
+
+static const char LEVEL_TAGS[] = { '-', 'E', 'W', 'I', 'D' };
+
+void logPush(uint8_t level, const char* format, const LogArg* args, uint8_t count) {
+    LogRecord record;
+    record.timestampUs = micros();
+    record.format = format;
+    record.level = level;
+    record.count = count;
+    for (uint8_t i = 0; i < count; i++) {
+        record.types[i] = args[i].type;
+        record.args[i] = args[i].value;
+    }
+    if (!records.push(record)) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Append one conversion of `arg` formatted by `spec` (e.g. "%-8.2f")
+static size_t formatArg(char* out, size_t room, const char* spec, uint8_t type, LogValue value) {
+    char conversion = spec[strlen(spec) - 1];
+    int n;
+    switch (type) {
+        case LOG_ARG_FLOAT: {
+            union { uint32_t u; float f; } pun;
+            pun.u = value.bits;
+            n = snprintf(out, room, spec, (double)pun.f);
+            break;
+        }
+        case LOG_ARG_STRING:
+            n = conversion == 's' ? snprintf(out, room, spec, value.string)
+                                  : snprintf(out, room, "%p", (const void*)value.string);
+            break;
+        case LOG_ARG_INT:
+            n = snprintf(out, room, spec, (int)value.bits);
+            break;
+        default:
+            n = snprintf(out, room, spec, (unsigned)value.bits);
+            break;
+    }
+    if (n < 0) return 0;
+    return (size_t)n < room ? (size_t)n : room - 1;
+}
+
+static void formatRecord(const LogRecord& record, char* out, size_t size) {
+    size_t len = snprintf(out, size, "[%5lu.%03lu] %c ",
+                          (unsigned long)(record.timestampUs / 1000000),
+                          (unsigned long)(record.timestampUs / 1000 % 1000),
+                          LEVEL_TAGS[record.level < sizeof(LEVEL_TAGS) ? record.level : 0]);
+    const char* p = record.format;
+    uint8_t next = 0;
+
+    while (*p && len + 1 < size) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Copy the spec up to and including its conversion character;
+        // length modifiers (l, h, z) are dropped, arguments are 32-bit
+        char spec[16];
+        size_t s = 0;
+        spec[s++] = *p++;
+        while (*p && !strchr("diouxXcsfFeEgGp", *p) && s < sizeof(spec) - 2) {
+            if (!strchr("hlzjt", *p)) spec[s++] = *p;
+            p++;
+        }
+        if (!*p) break;
+        spec[s++] = *p++;
+        spec[s] = '\0';
+
+        if (next < record.count) {
+            len += formatArg(out + len, size - len, spec, record.types[next], record.args[next]);
+            next++;
+        }
+    }
+    out[len < size ? len : size - 1] = '\0';
+}
+
+static void drain() {
+    char line[LOG_LINE_MAX];
+    LogRecord record;
+    while (records.pop(record)) {
+        formatRecord(record, line, sizeof(line));
+        Serial.println(line);
+    }
+
+    uint32_t dropped = droppedCount.load(std::memory_order_relaxed);
+    if (dropped != droppedReported) {
+        Serial.printf("[log] %lu records dropped\n", (unsigned long)(dropped - droppedReported));
+        droppedReported = dropped;
+    }
+}
+
+static void logTask(void* param) {
+    for (;;) {
+        drain();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+bool logBegin() {
+    return xTaskCreate(logTask, "log", TASK_STACK_LOG, nullptr,
+                       TASK_PRIORITY_LOG, nullptr) == pdPASS;
+}
+
+uint32_t logDropped() {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+#else
+
+void logPush(uint8_t, const char*, const LogArg*, uint8_t) {}
+bool logBegin() { return true; }
+uint32_t logDropped() { return 0; }
+
+#endif
@@ -15,122 +15,314 @@
 
 #include <Arduino.h>
 #include <Wire.h>
-#include <Adafruit_NeoPixel.h>
-#include <BLEDevice.h>
-#include <BLEServer.h>
-#include <BLEUtils.h>
-#include <BLE2902.h>
-#include <deque>
+#include <NimBLEDevice.h>
+#include <atomic>
 #include "config.h"
+#include "advertising.h"
+#include "blackbox.h"
+#include "ble_link.h"
+#include "calibration.h"
+#include "command.h"
+#include "crash_event.h"
+#include "detection.h"
+#include "helmet_state.h"
+#include "latency_trace.h"
+#include "log.h"
+#include "led_engine.h"
+#include "metrics.h"
+#include "mpu6500.h"
+#include "power.h"
+#include "ride_log.h"
+#include "sampling.h"
+#include "settings.h"
+#include "speed_fusion.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
 
 // ============================================
 // GLOBAL OBJECTS
 // ============================================
 
-Adafruit_NeoPixel leds(NUM_LEDS, PIN_LED, NEO_GRB + NEO_KHZ800);
-
 // BLE objects
-BLEServer* pServer = nullptr;
-BLECharacteristic* pSensorChar = nullptr;
-BLECharacteristic* pCommandChar = nullptr;
-BLECharacteristic* pCrashChar = nullptr;
+NimBLEServer* pServer = nullptr;
+NimBLECharacteristic* pSensorChar = nullptr;
+NimBLECharacteristic* pCommandChar = nullptr;
+NimBLECharacteristic* pCrashChar = nullptr;
+NimBLECharacteristic* pTelemetryChar = nullptr;
+NimBLECharacteristic* pLinkChar = nullptr;
+NimBLECharacteristic* pBlackBoxChar = nullptr;
+NimBLECharacteristic* pTraceChar = nullptr;
+NimBLECharacteristic* pSpeedChar = nullptr;
+NimBLECharacteristic* pRideChar = nullptr;
+NimBLECharacteristic* pHealthChar = nullptr;
 
 // ============================================
 // STATE VARIABLES
 // ============================================
 
-volatile HelmetState currentState = STATE_NORMAL;
-volatile HelmetState previousState = STATE_NORMAL;
+// Helmet state lives in helmet_state.cpp (stateGet / stateDispatch)
+
+// Sensing starts as soon as the IMU answers (BLE comes up in the
+// telemetry task, in either order)
+std::atomic<bool> sensingLive{false};
 
-// Connection state
-bool deviceConnected = false;
-bool oldDeviceConnected = false;
+// Connection state (written by the BLE host task)
+std::atomic<bool> deviceConnected{false};
 
-// Sensor data buffers for moving average
-std::deque<float> gValueBuffer;
+// Filters, fusion and brake / crash decision (detection task only)
+DetectionPipeline detector;
 
-// Timing variables
-unsigned long lastSensorRead = 0;
-unsigned long brakeStartTime = 0;
-unsigned long crashDetectedTime = 0;
+// Timing variables (detection task only; state timeouts use stateEnteredMs())
 unsigned long lastBLEUpdate = 0;
+std::atomic<bool> crashConfirmed{false};
+
+// The crash being alerted (detection task only)
+CrashEvent activeCrash;
+bool crashActive = false;
+uint16_t nextCrashId = 1;
+
+// Task handles
+TaskHandle_t detectionTaskHandle = nullptr;
+TaskHandle_t ledTaskHandle = nullptr;
+TaskHandle_t telemetryTaskHandle = nullptr;
+TaskHandle_t controlTaskHandle = nullptr;
+
+// The telemetry task is created after sensing starts (it sets up BLE)
+void wakeTelemetry() {
+    if (telemetryTaskHandle != nullptr) {
+        xTaskNotifyGive(telemetryTaskHandle);
+    }
+}
+
+// Crash event stages, detection task -> control task (which indicates
+// them and keeps them until confirmed)
+SpscQueue<CrashEvent, CRASH_EVENT_QUEUE_LENGTH> crashEventQueue;
+
+// Set by the BLE host task, taken by the control task
+enum CrashIndicationResult {
+    CRASH_INDICATION_NONE,
+    CRASH_INDICATION_CONFIRMED,
+    CRASH_INDICATION_FAILED
+};
+std::atomic<uint8_t> crashIndicationResult{CRASH_INDICATION_NONE};
+std::atomic<bool> crashSubscribed{false};  // New subscriber: resend at once
 
-// Animation frame counters
-int animationFrame = 0;
-unsigned long lastAnimationUpdate = 0;
+void wakeControl() {
+    if (controlTaskHandle != nullptr) {
+        xTaskNotifyGive(controlTaskHandle);
+    }
+}
+
+void postCrashEvent(const CrashEvent& event) {
+    if (!crashEventQueue.push(event)) {
+        LOG_W("Crash event %u stage %u dropped", event.id, event.stage);
+    }
+    wakeControl();
+}
+
+// Status byte in the advert; there is no battery gauge on this board
+uint8_t advertisedStatus() {
+    HelmetState state = stateGet();
+    return advPackStatus(state, state == STATE_CRASH_ALERT, ADV_BATTERY_UNKNOWN);
+}
 
 // ============================================
 // BLE CALLBACKS
 // ============================================
 
-class ServerCallbacks : public BLEServerCallbacks {
-    void onConnect(BLEServer* pServer) {
+// Outcome of every notification and indication, for the health metrics
+// (the *_DISABLED and NO_CLIENT statuses only mean nobody is listening)
+void countNotifyStatus(NimBLECharacteristicCallbacks::Status s) {
+    switch (s) {
+        case NimBLECharacteristicCallbacks::SUCCESS_NOTIFY:
+        case NimBLECharacteristicCallbacks::SUCCESS_INDICATE:
+            metricsCount(METRIC_NOTIFY_OK);
+            break;
+        case NimBLECharacteristicCallbacks::ERROR_GATT:
+        case NimBLECharacteristicCallbacks::ERROR_INDICATE_TIMEOUT:
+        case NimBLECharacteristicCallbacks::ERROR_INDICATE_FAILURE:
+            metricsCount(METRIC_NOTIFY_FAILED);
+            break;
+        default:
+            break;
+    }
+}
+
+// Base of the notifying characteristics' callbacks
+class CountingCallbacks : public NimBLECharacteristicCallbacks {
+public:
+    void onStatus(NimBLECharacteristic* pCharacteristic, Status s, int code) {
+        countNotifyStatus(s);
+    }
+};
+
+class ServerCallbacks : public NimBLEServerCallbacks {
+    void onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) {
         deviceConnected = true;
-        Serial.println("BLE: Device connected");
+        powerSetConnected(true);
+        linkOnConnect(desc);
+        advOnConnect(desc);
+        LOG_I("BLE: Device connected");
     }
 
-    void onDisconnect(BLEServer* pServer) {
+    void onDisconnect(NimBLEServer* pServer) {
         deviceConnected = false;
-        Serial.println("BLE: Device disconnected");
+        powerSetConnected(false);
+        linkOnDisconnect();
+        advOnDisconnect();
+        // A crash indication in flight will not be confirmed now
+        crashIndicationResult = CRASH_INDICATION_FAILED;
+        wakeControl();
+        wakeTelemetry();  // Advertising restarts from there at once
+        LOG_I("BLE: Device disconnected");
+    }
+
+    void onMTUChange(uint16_t mtu, ble_gap_conn_desc* desc) {
+        LOG_I("BLE: MTU %u", mtu);
     }
 };
 
-class CommandCallbacks : public BLECharacteristicCallbacks {
-    void onWrite(BLECharacteristic* pCharacteristic) {
+// Link characteristic - report negotiated MTU / interval / PHY on read
+class LinkCallbacks : public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic) {
+        uint8_t buffer[LINK_PARAMS_LEN];
+        size_t len = linkPackParams(buffer);
+        pCharacteristic->setValue(buffer, len);
+    }
+};
+
+// Black box download requests, executed by the telemetry task
+struct BlackBoxCommand {
+    uint8_t op;
+    uint32_t id;
+    uint32_t offset;
+};
+
+SpscQueue<BlackBoxCommand, 4> blackboxCommands;
+
+class BlackBoxCallbacks : public CountingCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
         std::string value = pCharacteristic->getValue();
+        if (value.length() == 0) return;
         
-        if (value.length() > 0) {
-            uint8_t command = value[0];
-            Serial.print("BLE Command received: 0x");
-            Serial.println(command, HEX);
-            
-            switch (command) {
-                case CMD_TURN_LEFT_ON:
-                    if (currentState != STATE_CRASH_ALERT) {
-                        previousState = currentState;
-                        currentState = STATE_TURN_LEFT;
-                    }
-                    break;
-                    
-                case CMD_TURN_LEFT_OFF:
-                    if (currentState == STATE_TURN_LEFT) {
-                        currentState = STATE_NORMAL;
-                    }
-                    break;
-                    
-                case CMD_TURN_RIGHT_ON:
-                    if (currentState != STATE_CRASH_ALERT) {
-                        previousState = currentState;
-                        currentState = STATE_TURN_RIGHT;
-                    }
-                    break;
-                    
-                case CMD_TURN_RIGHT_OFF:
-                    if (currentState == STATE_TURN_RIGHT) {
-                        currentState = STATE_NORMAL;
-                    }
-                    break;
-                    
-                case CMD_CRASH_FALSE_ALARM:
-                    if (currentState == STATE_CRASH_ALERT) {
-                        Serial.println("Crash alert cancelled by user");
-                        currentState = STATE_NORMAL;
-                    }
-                    break;
-                    
-                case CMD_PARTY_MODE:
-                    if (currentState != STATE_CRASH_ALERT) {
-                        currentState = STATE_PARTY;
-                    }
-                    break;
-                    
-                case CMD_NORMAL_MODE:
-                    if (currentState != STATE_CRASH_ALERT) {
-                        currentState = STATE_NORMAL;
-                    }
-                    break;
-            }
+        BlackBoxCommand cmd = { (uint8_t)value[0], 0, 0 };
+        if (cmd.op == BLACKBOX_CMD_READ) {
+            if (value.length() < 9) return;
+            memcpy(&cmd.id, &value[1], 4);
+            memcpy(&cmd.offset, &value[5], 4);
+        }
+        blackboxCommands.push(cmd);
+    }
+};
+
+// Ride log download requests, executed by the telemetry task
+struct RideLogCommand {
+    uint8_t op;
+    uint32_t fromSeq;
+    uint16_t offset;
+    uint32_t toSeq;
+};
+
+SpscQueue<RideLogCommand, 4> rideLogCommands;
+
+class RideLogCallbacks : public CountingCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 0) return;
+        
+        RideLogCommand cmd = { (uint8_t)value[0], 0, 0, 0xFFFFFFFFUL };
+        if (cmd.op == RIDELOG_CMD_READ) {
+            if (value.length() < 7) return;
+            memcpy(&cmd.fromSeq, &value[1], 4);
+            memcpy(&cmd.offset, &value[5], 2);
+            if (value.length() >= 11) memcpy(&cmd.toSeq, &value[7], 4);
         }
+        rideLogCommands.push(cmd);
+    }
+};
+
+// Trace characteristic - read latency histograms, write anything to reset
+class TraceCallbacks : public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic) {
+        uint8_t buffer[TRACE_PACKED_LEN];
+        size_t len = tracePack(buffer);
+        pCharacteristic->setValue(buffer, len);
+    }
+    
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        traceReset();
+    }
+};
+
+// Health characteristic - read the metrics, write anything to reset the peaks
+class HealthCallbacks : public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic) {
+        uint8_t buffer[METRICS_PACKED_LEN];
+        size_t len = metricsPack(buffer);
+        pCharacteristic->setValue(buffer, len);
+    }
+    
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        metricsResetPeaks();
+    }
+};
+
+// Speed fixes from the phone, applied by the detection task
+SpscQueue<SpeedFix, 4> speedFixes;
+
+class SpeedCallbacks : public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        SpeedFix fix;
+        if (speedParseFix((const uint8_t*)value.data(), value.length(), fix)) {
+            speedFixes.push(fix);  // Full: the next fix supersedes it anyway
+        }
+    }
+};
+
+// Commands are only parsed here; the control task executes them, so a
+// command never runs in the BLE host task
+SpscQueue<CommandFrame, CMD_QUEUE_LENGTH> commandQueue;
+std::atomic<bool> ackInFlight{false};
+
+class CommandCallbacks : public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        
+        CommandFrame frame;
+        if (!commandParse((const uint8_t*)value.data(), value.length(), frame)) return;
+        LOG_D("BLE Command received: 0x%02X (%u)", frame.commands[0].type, frame.count);
+        
+        // Full: dropped unacked, the app resends after its timeout
+        if (commandQueue.push(frame)) {
+            wakeControl();
+        }
+    }
+    
+    // Ack indication confirmed, timed out or failed - the next may go
+    void onStatus(NimBLECharacteristic* pCharacteristic, Status s, int code) {
+        countNotifyStatus(s);
+        if (s == SUCCESS_NOTIFY) return;
+        ackInFlight = false;
+        wakeControl();
+    }
+};
+
+// Crash characteristic - a (re)subscribing app gets the undelivered
+// events at once; a legacy app subscribed to notifications only gets
+// them as notifications, counted as delivered
+class CrashCallbacks : public NimBLECharacteristicCallbacks {
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, ble_gap_conn_desc* desc, uint16_t subValue) {
+        if (subValue == 0) return;
+        crashSubscribed = true;
+        wakeControl();
+    }
+    
+    void onStatus(NimBLECharacteristic* pCharacteristic, Status s, int code) {
+        countNotifyStatus(s);
+        bool delivered = s == SUCCESS_INDICATE || s == SUCCESS_NOTIFY;
+        crashIndicationResult = delivered ? CRASH_INDICATION_CONFIRMED : CRASH_INDICATION_FAILED;
+        wakeControl();
     }
 };
 
@@ -139,364 +331,876 @@ class CommandCallbacks : public BLECharacteristicCallbacks {
 // ============================================
 
 void setupBLE() {
-    Serial.println("Initializing BLE...");
+    LOG_I("Initializing BLE...");
     
-    BLEDevice::init(BLE_DEVICE_NAME);
+    NimBLEDevice::init(BLE_DEVICE_NAME);
     
     // Create BLE Server
-    pServer = BLEDevice::createServer();
+    pServer = NimBLEDevice::createServer();
     pServer->setCallbacks(new ServerCallbacks());
+    linkBegin(pServer);
     
     // Create BLE Service
-    BLEService* pService = pServer->createService(SERVICE_UUID);
+    NimBLEService* pService = pServer->createService(SERVICE_UUID);
     
     // Sensor characteristic (notify) - sends sensor data to app
+    // (NimBLE adds the 0x2902 descriptor to notify characteristics itself)
     pSensorChar = pService->createCharacteristic(
         SENSOR_CHAR_UUID,
-        BLECharacteristic::PROPERTY_READ |
-        BLECharacteristic::PROPERTY_NOTIFY
+        NIMBLE_PROPERTY::READ |
+        NIMBLE_PROPERTY::NOTIFY
     );
-    pSensorChar->addDescriptor(new BLE2902());
+    pSensorChar->setCallbacks(new CountingCallbacks());
     
-    // Command characteristic (write) - receives commands from app
+    // Command characteristic (write + indicate) - commands from app,
+    // acks of framed commands back
     pCommandChar = pService->createCharacteristic(
         COMMAND_CHAR_UUID,
-        BLECharacteristic::PROPERTY_WRITE
+        NIMBLE_PROPERTY::WRITE |
+        NIMBLE_PROPERTY::WRITE_NR |
+        NIMBLE_PROPERTY::INDICATE
     );
     pCommandChar->setCallbacks(new CommandCallbacks());
     
-    // Crash alert characteristic (notify) - urgent crash notifications
+    // Crash characteristic (read + indicate) - crash events until the
+    // app confirms them (notify kept for the legacy one-byte alert)
     pCrashChar = pService->createCharacteristic(
         CRASH_CHAR_UUID,
-        BLECharacteristic::PROPERTY_READ |
-        BLECharacteristic::PROPERTY_NOTIFY
+        NIMBLE_PROPERTY::READ |
+        NIMBLE_PROPERTY::NOTIFY |
+        NIMBLE_PROPERTY::INDICATE
+    );
+    pCrashChar->setCallbacks(new CrashCallbacks());
+    
+    // Telemetry characteristic (notify) - batched full-rate IMU stream
+    pTelemetryChar = pService->createCharacteristic(
+        TELEMETRY_CHAR_UUID,
+        NIMBLE_PROPERTY::NOTIFY
+    );
+    pTelemetryChar->setCallbacks(new CountingCallbacks());
+    
+    // Link characteristic (read) - negotiated connection parameters
+    pLinkChar = pService->createCharacteristic(
+        LINK_CHAR_UUID,
+        NIMBLE_PROPERTY::READ
+    );
+    pLinkChar->setCallbacks(new LinkCallbacks());
+    
+    // Black box characteristic (write + notify) - bulk download of crash captures
+    pBlackBoxChar = pService->createCharacteristic(
+        BLACKBOX_CHAR_UUID,
+        NIMBLE_PROPERTY::WRITE |
+        NIMBLE_PROPERTY::NOTIFY
+    );
+    pBlackBoxChar->setCallbacks(new BlackBoxCallbacks());
+    
+    // Trace characteristic (read + write) - latency histograms
+    pTraceChar = pService->createCharacteristic(
+        TRACE_CHAR_UUID,
+        NIMBLE_PROPERTY::READ |
+        NIMBLE_PROPERTY::WRITE
+    );
+    pTraceChar->setCallbacks(new TraceCallbacks());
+    
+    // Speed characteristic (write) - speed / course fixes from the phone
+    pSpeedChar = pService->createCharacteristic(
+        SPEED_CHAR_UUID,
+        NIMBLE_PROPERTY::WRITE |
+        NIMBLE_PROPERTY::WRITE_NR
     );
-    pCrashChar->addDescriptor(new BLE2902());
+    pSpeedChar->setCallbacks(new SpeedCallbacks());
+    
+    // Ride log characteristic (write + notify) - bulk download of recorded sessions
+    pRideChar = pService->createCharacteristic(
+        RIDE_CHAR_UUID,
+        NIMBLE_PROPERTY::WRITE |
+        NIMBLE_PROPERTY::NOTIFY
+    );
+    pRideChar->setCallbacks(new RideLogCallbacks());
+    
+    // Health characteristic (read + write) - runtime metrics
+    pHealthChar = pService->createCharacteristic(
+        HEALTH_CHAR_UUID,
+        NIMBLE_PROPERTY::READ |
+        NIMBLE_PROPERTY::WRITE
+    );
+    pHealthChar->setCallbacks(new HealthCallbacks());
     
     // Start the service
     pService->start();
     
-    // Start advertising
-    BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
-    pAdvertising->addServiceUUID(SERVICE_UUID);
-    pAdvertising->setScanResponse(true);
-    pAdvertising->setMinPreferred(0x06);
-    pAdvertising->setMinPreferred(0x12);
-    BLEDevice::startAdvertising();
+    // Bond when the phone asks (Just Works), so it is known after a dropout
+    NimBLEDevice::setSecurityAuth(true, false, true);
+    
+    // Start advertising (fast burst, then backed off by advService)
+    advBegin(pServer, advertisedStatus());
     
-    Serial.println("BLE initialized. Waiting for connections...");
+    LOG_I("BLE initialized. Waiting for connections...");
 }
 
 // ============================================
 // SENSOR FUNCTIONS
 // ============================================
 
-void initSensors() {
-    Serial.println("Initializing MPU6500...");
-    Serial.print("Using I2C pins - SDA: GPIO");
+void initI2C() {
+    Serial.print("I2C pins - SDA: GPIO");
     Serial.print(PIN_SDA);
     Serial.print(", SCL: GPIO");
     Serial.println(PIN_SCL);
     
-    // Initialize I2C exactly like working code
     Wire.begin(PIN_SDA, PIN_SCL);
-    Wire.setClock(400000);  // 400kHz like working code
-    delay(100);
-    
-    // Check if MPU is present
-    Wire.beginTransmission(0x68);
-    byte error = Wire.endTransmission();
+    Wire.setClock(400000);  // 400 kHz fast mode
+}
+
+// Probe and configure the MPU6500; false if it does not answer
+bool initSensors() {
+    if (!mpuProbe()) return false;
     
-    if (error != 0) {
-        Serial.print("MPU6500 NOT FOUND! Error: ");
-        Serial.println(error);
-        Serial.println("Check wiring!");
-        
-        // Flash error pattern on LEDs
-        while (1) {
-            leds.fill(leds.Color(255, 0, 0));
-            leds.show();
-            delay(500);
-            leds.clear();
-            leds.show();
-            delay(500);
-        }
+    // Wake up, ±8g accel (crash detection), ±500°/s gyro
+    mpuConfigure();
+    return true;
+}
+
+// ============================================
+// BLE DATA TRANSMISSION
+// ============================================
+
+// Messages from the detection task to the telemetry task
+enum TelemetryType {
+    TELEMETRY_SENSOR_DATA
+};
+
+struct TelemetryMsg {
+    TelemetryType type;
+    HelmetState state;
+    SensorData data;
+};
+
+SpscQueue<TelemetryMsg, TELEMETRY_QUEUE_LENGTH> telemetryQueue;
+
+// Every raw sample, for the batched stream
+SpscQueue<ImuSample, TELEMETRY_SAMPLE_QUEUE_LENGTH> streamQueue;
+std::atomic<bool> streamSamplesLost{false};
+
+// Telemetry task only
+TelemetryPacker streamPacker;
+
+// Detection task side: never blocks, drops the message if telemetry is behind
+void postTelemetry(TelemetryType type, const SensorData& data) {
+    TelemetryMsg msg = { type, stateGet(), data };
+    if (telemetryQueue.push(msg)) {
+        wakeTelemetry();
     }
+}
+
+// Legacy frame for the current app parser
+void sendSensorData(const TelemetryMsg& msg) {
+    if (!deviceConnected || pSensorChar->getSubscribedCount() == 0) return;
+    
+    // Pack sensor data into bytes
+    // Format: [state(1)][gForce(4)][pitch(4)][roll(4)] = 13 bytes
+    uint8_t buffer[13];
     
-    Serial.println("MPU6500 Found!");
+    buffer[0] = (uint8_t)msg.state;
+    memcpy(&buffer[1], &msg.data.gForce, 4);
+    memcpy(&buffer[5], &msg.data.pitch, 4);
+    memcpy(&buffer[9], &msg.data.roll, 4);
     
-    // Wake up MPU6500 (same as working code)
-    Wire.beginTransmission(0x68);
-    Wire.write(0x6B);  // PWR_MGMT_1
-    Wire.write(0);     // Wake up
-    Wire.endTransmission(true);
+    pSensorChar->setValue(buffer, 13);
+    pSensorChar->notify();
+}
+
+void sendStreamFrame() {
+    size_t len = streamPacker.finish((uint8_t)stateGet());
+    if (len == 0) return;
+    pTelemetryChar->setValue(streamPacker.data(), len);
+    pTelemetryChar->notify();
+}
+
+// Pack queued samples, sending a notification per full frame. A partial
+// frame is held until TELEMETRY_MAX_LATENCY_MS so idle periods do not
+// cost extra radio events.
+void pumpStream() {
+    bool streaming = deviceConnected && pTelemetryChar->getSubscribedCount() > 0;
     
-    delay(100);
+    if (streamSamplesLost.exchange(false)) {
+        streamPacker.markSamplesLost();
+    }
     
-    // Configure for 8G range (for crash detection)
-    // ACCEL_CONFIG register (0x1C), set to Â±8g (bits 4:3 = 10)
-    Wire.beginTransmission(0x68);
-    Wire.write(0x1C);  // ACCEL_CONFIG
-    Wire.write(0x10);  // Â±8g range
-    Wire.endTransmission(true);
+    if (!streaming && !streamPacker.empty()) {
+        streamPacker.discard();
+    }
     
-    // Configure gyro for 500Â°/s range
-    Wire.beginTransmission(0x68);
-    Wire.write(0x1B);  // GYRO_CONFIG  
-    Wire.write(0x08);  // Â±500Â°/s range
-    Wire.endTransmission(true);
+    // Short connection interval only while someone consumes the stream
+    if (deviceConnected) {
+        linkSetProfile(streaming ? LINK_PROFILE_STREAMING : LINK_PROFILE_IDLE);
+    }
+    streamPacker.setMaxPayload(linkGetMtu() - 3);
     
-    Serial.println("MPU6500 initialized successfully!");
-}
-
-// Helper function to read 16-bit register
-int16_t readMPURegister16(byte reg) {
-    Wire.beginTransmission(0x68);
-    Wire.write(reg);
-    Wire.endTransmission(false);
-    Wire.requestFrom(0x68, 2);
+    ImuSample sample;
+    while (streamQueue.pop(sample)) {
+        if (!streaming) continue;  // Drain so stale samples are not sent later
+        
+        if (!streamPacker.append(sample)) {
+            sendStreamFrame();
+            streamPacker.append(sample);
+        }
+        if (streamPacker.full()) {
+            sendStreamFrame();
+        }
+    }
     
-    if (Wire.available() >= 2) {
-        int16_t value = Wire.read() << 8 | Wire.read();
-        return value;
+    if (streaming && !streamPacker.empty() &&
+        micros() - streamPacker.firstTimestampUs() >= TELEMETRY_MAX_LATENCY_MS * 1000UL) {
+        sendStreamFrame();
     }
-    return 0;
 }
 
-// Structure to hold processed sensor data
-struct SensorData {
-    float gForce;       // Current G-force magnitude
-    float avgGForce;    // Averaged G-force
-    float accelX;       // Acceleration X (g)
-    float accelY;       // Acceleration Y (g)
-    float accelZ;       // Acceleration Z (g)
-    float pitch;        // Pitch angle
-    float roll;         // Roll angle
-    bool isBraking;     // Braking detected
-    bool isCrash;       // Crash detected
+// Queue one download chunk straight to the host stack: unlike notify(),
+// this reports when the stack is out of buffers, so the chunk is kept
+// and retried instead of lost
+bool sendChunk(NimBLECharacteristic* characteristic, const uint8_t* data, size_t len) {
+    os_mbuf* om = ble_hs_mbuf_from_flat(data, len);
+    bool sent = om != nullptr &&
+                ble_gattc_notify_custom(linkGetConnHandle(), characteristic->getHandle(), om) == 0;
+    metricsCount(sent ? METRIC_NOTIFY_OK : METRIC_NOTIFY_FAILED);
+    return sent;
+}
+
+// Black box download (telemetry task only)
+struct BlackBoxTransfer {
+    bool active;
+    uint32_t id;
+    uint32_t offset;
 };
 
-SensorData readSensors() {
-    SensorData data = {0};
-    
-    // Read raw accelerometer values
-    int16_t ax = readMPURegister16(0x3B);  // ACCEL_XOUT_H
-    int16_t ay = readMPURegister16(0x3D);  // ACCEL_YOUT_H
-    int16_t az = readMPURegister16(0x3F);  // ACCEL_ZOUT_H
+BlackBoxTransfer blackboxTransfer = { false, 0, 0 };
+
+void notifyBlackBox(const uint8_t* data, size_t len) {
+    pBlackBoxChar->setValue(data, len);
+    pBlackBoxChar->notify();
+}
+
+void sendBlackBoxList() {
+    static BlackBoxHeader headers[BLACKBOX_MAX_SLOTS];
+    uint16_t count = blackboxList(headers, BLACKBOX_MAX_SLOTS);
     
-    // Convert to G (Â±8g range = 4096 LSB/g)
-    data.accelX = ax / 4096.0f;
-    data.accelY = ay / 4096.0f;
-    data.accelZ = az / 4096.0f;
+    // [0x81][count]
+    uint8_t begin[2] = { BLACKBOX_RSP_LIST, (uint8_t)count };
+    notifyBlackBox(begin, sizeof(begin));
     
-    // Calculate resultant G-force (magnitude)
-    data.gForce = sqrt(data.accelX * data.accelX + 
-                       data.accelY * data.accelY + 
-                       data.accelZ * data.accelZ);
+    // Per record: [0x82][id(4)][triggerTimestampUs(4)][length(4)][reason(1)]
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t entry[14];
+        uint32_t length = blackboxRecordLength(headers[i]);
+        entry[0] = BLACKBOX_RSP_ENTRY;
+        memcpy(&entry[1], &headers[i].id, 4);
+        memcpy(&entry[5], &headers[i].triggerTimestampUs, 4);
+        memcpy(&entry[9], &length, 4);
+        entry[13] = headers[i].reason;
+        notifyBlackBox(entry, sizeof(entry));
+    }
+}
+
+// Stream the requested record a few notifications at a time. A chunk the
+// stack could not queue is sent again on the next pump.
+void pumpBlackBox() {
+    BlackBoxCommand cmd;
+    while (blackboxCommands.pop(cmd)) {
+        switch (cmd.op) {
+            case BLACKBOX_CMD_LIST:
+                sendBlackBoxList();
+                break;
+                
+            case BLACKBOX_CMD_READ:
+                blackboxTransfer = { true, cmd.id, cmd.offset };
+                break;
+                
+            case BLACKBOX_CMD_ERASE: {
+                blackboxTransfer.active = false;
+                blackboxEraseAll();
+                uint8_t ack = BLACKBOX_RSP_ERASED;
+                notifyBlackBox(&ack, 1);
+                break;
+            }
+        }
+    }
     
-    // Add to moving average buffer
-    gValueBuffer.push_back(data.gForce);
-    if (gValueBuffer.size() > SENSOR_SAMPLE_SIZE) {
-        gValueBuffer.pop_front();
+    if (!deviceConnected) {
+        blackboxTransfer.active = false;
+        return;
     }
     
-    // Calculate moving average
-    if (gValueBuffer.size() == SENSOR_SAMPLE_SIZE) {
-        float sum = 0;
-        for (float val : gValueBuffer) {
-            sum += val;
+    for (int i = 0; i < BLACKBOX_CHUNKS_PER_PUMP && blackboxTransfer.active; i++) {
+        // [0x83][offset(4)][data...]
+        uint8_t chunk[BLE_PREFERRED_MTU];
+        size_t capacity = linkGetMtu() - 3 - 5;
+        if (capacity > sizeof(chunk) - 5) capacity = sizeof(chunk) - 5;
+        
+        size_t n = blackboxRead(blackboxTransfer.id, blackboxTransfer.offset, &chunk[5], capacity);
+        if (n == 0) {
+            // [0x84][id(4)][length(4)] - length 0 means unknown record
+            BlackBoxHeader header;
+            uint32_t length = 0;
+            if (blackboxRead(blackboxTransfer.id, 0, (uint8_t*)&header, sizeof(header)) == sizeof(header)) {
+                length = blackboxRecordLength(header);
+            }
+            uint8_t done[9];
+            done[0] = BLACKBOX_RSP_DONE;
+            memcpy(&done[1], &blackboxTransfer.id, 4);
+            memcpy(&done[5], &length, 4);
+            notifyBlackBox(done, sizeof(done));
+            blackboxTransfer.active = false;
+            break;
         }
-        data.avgGForce = sum / SENSOR_SAMPLE_SIZE;
-    } else {
-        data.avgGForce = data.gForce;
+        
+        chunk[0] = BLACKBOX_RSP_DATA;
+        memcpy(&chunk[1], &blackboxTransfer.offset, 4);
+        if (!sendChunk(pBlackBoxChar, chunk, n + 5)) break;  // Stack full: same chunk next time
+        blackboxTransfer.offset += n;
     }
+}
+
+// Ride log download (telemetry task only)
+struct RideLogTransfer {
+    bool active;
+    uint32_t seq;      // Block being sent
+    uint16_t offset;   // Next byte of it
+    uint32_t toSeq;    // Last block to send
+};
+
+RideLogTransfer rideTransfer = { false, 0, 0, 0 };
+
+void notifyRideLog(const uint8_t* data, size_t len) {
+    pRideChar->setValue(data, len);
+    pRideChar->notify();
+}
+
+void sendRideLogList() {
+    static RideSession sessions[RIDELOG_MAX_SESSIONS];
+    uint16_t count = rideLogSessions(sessions, RIDELOG_MAX_SESSIONS);
     
-    // Calculate pitch and roll for orientation
-    data.pitch = atan2(data.accelX, sqrt(data.accelY * data.accelY + data.accelZ * data.accelZ)) * 180.0 / PI;
-    data.roll = atan2(data.accelY, sqrt(data.accelX * data.accelX + data.accelZ * data.accelZ)) * 180.0 / PI;
+    // [0x91][count]
+    uint8_t begin[2] = { RIDELOG_RSP_LIST, (uint8_t)count };
+    notifyRideLog(begin, sizeof(begin));
     
-    // Crash detection - sudden high G impact
-    if (data.gForce > CRASH_G_THRESHOLD) {
-        data.isCrash = true;
-        Serial.print("!!! HIGH G DETECTED: ");
-        Serial.println(data.gForce);
+    // Per session: [0x92][sessionId(4)][firstSeq(4)][lastSeq(4)][samples(4)]
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t entry[17];
+        entry[0] = RIDELOG_RSP_ENTRY;
+        memcpy(&entry[1], &sessions[i].sessionId, 4);
+        memcpy(&entry[5], &sessions[i].firstSeq, 4);
+        memcpy(&entry[9], &sessions[i].lastSeq, 4);
+        memcpy(&entry[13], &sessions[i].sampleCount, 4);
+        notifyRideLog(entry, sizeof(entry));
     }
-    
-    // Brake detection - sustained deceleration
-    // Only trigger if we're not in crash state
-    if (!data.isCrash && data.avgGForce > BRAKE_G_THRESHOLD && data.avgGForce < CRASH_G_THRESHOLD) {
-        // Check for forward deceleration (negative X typically)
-        if (data.accelX < -BRAKE_G_THRESHOLD) {
-            data.isBraking = true;
+}
+
+// Move the transfer to the first stored block at or after `seq`;
+// false when there is none up to toSeq
+bool seekRideBlock(uint32_t seq) {
+    uint32_t oldest, newest;
+    if (!rideLogRange(oldest, newest)) return false;
+    if (seq < oldest) seq = oldest;
+    if (seq > newest || seq > rideTransfer.toSeq) return false;
+    rideTransfer.seq = seq;
+    return true;
+}
+
+// [0x94][nextSeq(4)] - where the next sync starts
+void finishRideTransfer(uint32_t nextSeq) {
+    uint8_t done[5];
+    done[0] = RIDELOG_RSP_DONE;
+    memcpy(&done[1], &nextSeq, 4);
+    notifyRideLog(done, sizeof(done));
+    rideTransfer.active = false;
+}
+
+// Stream the requested blocks back to back, as fast as the stack takes
+// them. Nothing is skipped, so the app sees every byte in order; after a
+// reconnect it resumes with a read from the last (seq, offset) it got.
+void pumpRideLog() {
+    RideLogCommand cmd;
+    while (rideLogCommands.pop(cmd)) {
+        switch (cmd.op) {
+            case RIDELOG_CMD_LIST:
+                sendRideLogList();
+                break;
+                
+            case RIDELOG_CMD_READ:
+                rideTransfer = { true, cmd.fromSeq, cmd.offset, cmd.toSeq };
+                if (!seekRideBlock(cmd.fromSeq)) {
+                    finishRideTransfer(cmd.fromSeq);  // Nothing new yet
+                } else if (rideTransfer.seq != cmd.fromSeq) {
+                    rideTransfer.offset = 0;  // Overwritten: resume at the oldest
+                }
+                break;
+                
+            case RIDELOG_CMD_ERASE: {
+                rideTransfer.active = false;
+                rideLogEraseAll();
+                uint8_t ack = RIDELOG_RSP_ERASED;
+                notifyRideLog(&ack, 1);
+                break;
+            }
         }
     }
     
-    return data;
+    if (!deviceConnected) {
+        rideTransfer.active = false;
+        return;
+    }
+    
+    for (int i = 0; i < RIDELOG_CHUNKS_PER_PUMP && rideTransfer.active; i++) {
+        // [0x93][seq(4)][offset(2)][data...]
+        uint8_t chunk[BLE_PREFERRED_MTU];
+        size_t capacity = linkGetMtu() - 3 - 7;
+        if (capacity > sizeof(chunk) - 7) capacity = sizeof(chunk) - 7;
+        
+        size_t n = rideLogRead(rideTransfer.seq, rideTransfer.offset, &chunk[7], capacity);
+        if (n == 0) {
+            // End of this block: on to the next stored one
+            rideTransfer.offset = 0;
+            if (seekRideBlock(rideTransfer.seq + 1)) continue;
+            finishRideTransfer(rideTransfer.seq + 1);
+            break;
+        }
+        
+        chunk[0] = RIDELOG_RSP_DATA;
+        memcpy(&chunk[1], &rideTransfer.seq, 4);
+        memcpy(&chunk[5], &rideTransfer.offset, 2);
+        if (!sendChunk(pRideChar, chunk, n + 7)) break;  // Stack full: same chunk next time
+        rideTransfer.offset += n;
+    }
 }
 
 // ============================================
-// LED ANIMATION FUNCTIONS
+// STATE ACTIONS
 // ============================================
 
-void clearLeds() {
-    leds.clear();
-    leds.show();
+// Every state change is shown at once instead of on the next animation
+// tick: the LED task renders and latches the new state's first frame as
+// soon as the dispatching task yields.
+void onStateEnter(HelmetState from, HelmetState to) {
+    if (ledTaskHandle != nullptr) {
+        xTaskNotifyGive(ledTaskHandle);
+    }
 }
 
-// Normal running light - subtle red glow with breathing effect
-void animateNormal() {
-    static int brightness = 50;
-    static int direction = 1;
-    
-    if (millis() - lastAnimationUpdate > 30) {
-        lastAnimationUpdate = millis();
-        
-        brightness += direction * 2;
-        if (brightness >= 100) direction = -1;
-        if (brightness <= 30) direction = 1;
-        
-        // Soft red glow on center LEDs
-        for (int i = 4; i < 8; i++) {
-            leds.setPixelColor(i, leds.Color(brightness, 0, 0));
-        }
-        leds.show();
+void onCrashAlertEnter(HelmetState from, HelmetState to) {
+    crashConfirmed = false;
+    onStateEnter(from, to);
+}
+
+// Only a false alarm from the app leaves the crash alert
+void onCrashAlertExit(HelmetState from, HelmetState to) {
+    LOG_I("Crash alert cancelled by user");
+}
+
+void setupStateActions() {
+    for (int s = 0; s < HELMET_STATE_COUNT; s++) {
+        stateSetActions((HelmetState)s, onStateEnter, nullptr);
     }
+    stateSetActions(STATE_CRASH_ALERT, onCrashAlertEnter, onCrashAlertExit);
 }
 
-// Brake light - all LEDs bright red, flashing
-void animateBrake() {
-    static bool isOn = true;
+// ============================================
+// POWER MODE ACTIONS
+// ============================================
+
+// The radio and LEDs follow the activity level: slow advertising and a
+// power-save connection while stationary, nothing at all in sleep.
+void onPowerModeChange(PowerMode from, PowerMode to) {
+    linkSetPowerSave(to != POWER_ACTIVE);
     
-    if (millis() - lastAnimationUpdate > 100) {
-        lastAnimationUpdate = millis();
-        isOn = !isOn;
-        
-        if (isOn) {
-            leds.fill(leds.Color(255, 0, 0));
-        } else {
-            leds.fill(leds.Color(100, 0, 0));
-        }
-        leds.show();
+    // Full-rate sampling stops: the ride log session ends with it
+    if (from == POWER_ACTIVE) {
+        rideLogNewSession();
+    }
+    metricsSetSampling(to == POWER_ACTIVE);
+    
+    // New interval (or none in sleep), applied by the telemetry task
+    // well within the power task's settle time before sleeping
+    advSetPowerMode(to);
+    wakeTelemetry();
+    
+    ledEngineSetBlank(to == POWER_SLEEP);
+    if (ledTaskHandle != nullptr) {
+        xTaskNotifyGive(ledTaskHandle);
     }
 }
 
-// Left turn signal - sequential from center to left
-void animateTurnLeft() {
-    if (millis() - lastAnimationUpdate > TURN_SIGNAL_SPEED) {
-        lastAnimationUpdate = millis();
-        
-        leds.clear();
+// ============================================
+// TASKS
+// ============================================
+
+// Sensing/detection - consumes every sample from the sampling task.
+// Second-highest priority: only the FIFO drain can preempt it.
+void detectionTask(void* param) {
+    while (true) {
+        // Woken by the sampling task after each batch
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         
-        // Animate from center (LED 6) to left (LED 0)
-        // LEDs 0-5 are left side, 6-11 are right side (adjust based on your layout)
-        int activeLed = 5 - (animationFrame % 6);
+        unsigned long currentTime = millis();
         
-        // Show trail effect
-        for (int i = 5; i >= activeLed; i--) {
-            int brightness = 255 - ((5 - i) * 40);
-            if (brightness < 50) brightness = 50;
-            leds.setPixelColor(i, leds.Color(255, 165, 0));  // Orange
+        SpeedFix fix;
+        while (speedFixes.pop(fix)) {
+            detector.correctSpeed(fix);
         }
         
-        leds.show();
-        animationFrame++;
+        uint32_t batchStartUs = micros();
+        uint32_t batchSamples = 0;
         
-        if (animationFrame >= 12) {  // Complete cycle then pause
-            animationFrame = 0;
-            delay(200);  // Pause between cycles
+        ImuSample sample;
+        while (samplingRead(sample)) {
+            batchSamples++;
+            uint32_t origin = traceOrigin(sample.timestampUs);
+            traceRecord(TRACE_ACQUIRED, origin);
+            
+            SensorData sensorData = detector.filter(sample);
+            traceRecord(TRACE_FILTERED, origin);
+            powerNoteSample(sensorData.gForce, sensorData.gyroX,
+                            sensorData.gyroY, sensorData.gyroZ);
+            
+            detector.classify(sensorData);
+            traceRecord(TRACE_CLASSIFIED, origin);
+            // The report comes with the sample that decides the crash;
+            // the classifier path decides without one
+            CrashReport impact{};
+            bool impactReported = detector.takeCrashReport(impact);
+            if (impactReported) {
+                LOG_I("Impact %.1fg %.3fgs%s%s%s after %u samples: %s",
+                      impact.peakG, impact.energyGs,
+                      impact.preSignature ? " fall/tumble" : "",
+                      impact.still ? " still" : "",
+                      impact.severe ? " severe" : "",
+                      impact.samples,
+                      impact.crash ? "CRASH" : "rejected");
+            }
+            
+            // Pre/post-event capture and session log (RAM only, each
+            // flushed by its own task)
+            blackboxRecord(sample);
+            rideLogRecord(sample);
+            
+            // Full-rate stream for the batched telemetry frame
+            if (!streamQueue.push(sample)) {
+                streamSamplesLost = true;
+            }
+            uint32_t streamDepth = streamQueue.size();
+            metricsSetLevel(METRIC_STREAM_QUEUE_DEPTH, streamDepth);
+            metricsPeak(METRIC_STREAM_QUEUE_MAX, streamDepth);
+            
+            uint8_t detected = detectionDispatch(sensorData);
+            
+            // Handle crash detection
+            if (detected & DETECTED_CRASH) {
+                traceRecord(TRACE_TRANSITION, origin);
+                traceEventBegin(origin);
+                LOG_W("!!! CRASH DETECTED !!!");
+                if (crashActive) {
+                    // The previous alert was cancelled within this batch
+                    activeCrash.stage = CRASH_STAGE_CANCELLED;
+                    postCrashEvent(activeCrash);
+                }
+                activeCrash = crashEventMake(nextCrashId++, millis(),
+                                             impactReported ? &impact : nullptr,
+                                             detector.pitchDeg(), detector.rollDeg());
+                crashActive = true;
+                postCrashEvent(activeCrash);
+                blackboxTrigger(BLACKBOX_REASON_CRASH);
+                detector.resetAverages();  // Reset averages after crash
+            }
+            
+            // Handle brake detection
+            if (detected & DETECTED_BRAKE) {
+                traceRecord(TRACE_TRANSITION, origin);
+                traceEventBegin(origin);
+                LOG_I("Braking detected!");
+            }
+            
+            // Braking during a turn signal: the brake light is layered
+            // over it for as long as the braking lasts, plus the minimum hold
+            if (detected & DETECTED_TURN_BRAKE) {
+                uint32_t now = millis();
+                if (ledEngineHoldBrake(now, now + BRAKE_HOLD_MIN_MS)) {
+                    LOG_I("Braking detected during turn signal");
+                    xTaskNotifyGive(ledTaskHandle);
+                }
+            }
+            
+            // Send sensor data via BLE (every 100ms)
+            if (currentTime - lastBLEUpdate >= 100) {
+                lastBLEUpdate = currentTime;
+                sensorData.pitch = detector.pitchDeg();
+                sensorData.roll = detector.rollDeg();
+                postTelemetry(TELEMETRY_SENSOR_DATA, sensorData);
+            }
         }
-    }
-}
-
-// Right turn signal - sequential from center to right
-void animateTurnRight() {
-    if (millis() - lastAnimationUpdate > TURN_SIGNAL_SPEED) {
-        lastAnimationUpdate = millis();
+        wakeTelemetry();
         
-        leds.clear();
-        
-        // Animate from center (LED 5) to right (LED 11)
-        int activeLed = 6 + (animationFrame % 6);
-        
-        // Show trail effect
-        for (int i = 6; i <= activeLed; i++) {
-            int brightness = 255 - ((i - 6) * 40);
-            if (brightness < 50) brightness = 50;
-            leds.setPixelColor(i, leds.Color(255, 165, 0));  // Orange
+        // A batch must be processed in less time than its samples span
+        // (20 ms at the watermark), or the queue backs up
+        uint32_t batchUs = micros() - batchStartUs;
+        metricsPeak(METRIC_DETECTION_MAX_US, batchUs);
+        if (batchSamples > 0 && batchUs > batchSamples * (1000000UL / IMU_SAMPLE_RATE_HZ)) {
+            metricsCount(METRIC_DETECTION_OVERRUNS);
         }
         
-        leds.show();
-        animationFrame++;
+        // ----------------------------------------
+        // State timeout handling
+        // ----------------------------------------
+        HelmetState state = stateGet();
         
-        if (animationFrame >= 12) {
-            animationFrame = 0;
-            delay(200);
+        // Crash confirmation timeout, or the app's false alarm (the only
+        // way out of the crash alert)
+        if (crashActive && state != STATE_CRASH_ALERT) {
+            activeCrash.stage = CRASH_STAGE_CANCELLED;
+            postCrashEvent(activeCrash);
+            crashActive = false;
+        } else if (crashActive && !crashConfirmed) {
+            if (millis() - stateEnteredMs() >= settingsGet().crashConfirmationMs) {
+                LOG_W("!!! NO RESPONSE - CONFIRMING CRASH !!!");
+                crashConfirmed = true;
+                // The app raises the emergency on this stage; the LEDs
+                // keep flashing
+                activeCrash.stage = CRASH_STAGE_CONFIRMED;
+                postCrashEvent(activeCrash);
+            }
         }
+        
+        // Brake light timeout
+        detectionCheckTimeouts(millis());
     }
 }
 
-// Crash alert - rapid red/white flash (very visible)
-void animateCrashAlert() {
-    static bool isRed = true;
+// Control - executes app commands queued by the BLE callback, sends
+// their acks and delivers crash events, one indication at a time (the
+// stack takes no second one until the first is confirmed). A crash event
+// goes before any ack.
+struct CommandAck {
+    uint8_t len;
+    uint8_t data[CMD_ACK_MAX];
+};
+
+// Outbox bookkeeping and the next crash indication (control task)
+void serviceCrashEvents(CrashOutbox& outbox, unsigned long& sentMs) {
+    CrashEvent event;
+    while (crashEventQueue.pop(event)) {
+        if (!outbox.post(event)) {
+            LOG_W("Crash outbox full, oldest event dropped");
+        }
+    }
     
-    if (millis() - lastAnimationUpdate > 50) {  // Very fast flash
-        lastAnimationUpdate = millis();
-        isRed = !isRed;
-        
-        if (isRed) {
-            leds.fill(leds.Color(255, 0, 0));
-        } else {
-            leds.fill(leds.Color(255, 255, 255));
+    // Subscribed again (reconnect): whatever was in flight went to the
+    // old link - everything goes again now
+    if (crashSubscribed.exchange(false)) {
+        if (outbox.inFlight()) outbox.failed(millis());
+        outbox.retryNow();
+    }
+    
+    if (outbox.inFlight()) {
+        uint8_t result = crashIndicationResult.exchange(CRASH_INDICATION_NONE);
+        if (result == CRASH_INDICATION_CONFIRMED) {
+            outbox.confirmed();
+        } else if (result == CRASH_INDICATION_FAILED ||
+                   millis() - sentMs >= CRASH_INDICATE_TIMEOUT_MS) {
+            outbox.failed(millis());
         }
-        leds.show();
     }
+    
+    if (ackInFlight || !deviceConnected || pCrashChar->getSubscribedCount() == 0) return;
+    if (!outbox.due(millis(), event)) return;
+    
+    uint8_t payload[CRASH_EVENT_LEN];
+    crashEventEncode(event, millis(), payload);
+    crashIndicationResult = CRASH_INDICATION_NONE;
+    sentMs = millis();
+    pCrashChar->setValue(payload, sizeof(payload));  // Also what a read returns
+    pCrashChar->indicate();
+    LOG_I("Crash event %u stage %u sent (%u pending)", event.id, event.stage, outbox.pending());
 }
 
-// Party mode - rainbow
-void animateParty() {
-    if (millis() - lastAnimationUpdate > 20) {
-        lastAnimationUpdate = millis();
+void controlTask(void* param) {
+    SpscQueue<CommandAck, CMD_QUEUE_LENGTH> pendingAcks;
+    CommandAck ack;             // Being sent, up to ackPos
+    size_t ackPos = 0;
+    bool ackPending = false;
+    CrashOutbox crashOutbox;
+    unsigned long ackSentMs = 0;
+    unsigned long crashSentMs = 0;
+    
+    while (true) {
+        // Sleep until woken, an indication times out or a retry is due
+        // (an ack confirmation or a subscriber wakes it for the rest)
+        TickType_t wait = portMAX_DELAY;
+        if (ackInFlight) {
+            wait = pdMS_TO_TICKS(CMD_ACK_TIMEOUT_MS);
+        } else if (crashOutbox.inFlight()) {
+            wait = pdMS_TO_TICKS(CRASH_INDICATE_TIMEOUT_MS);
+        } else if (deviceConnected && pCrashChar->getSubscribedCount() > 0) {
+            uint32_t dueMs = crashOutbox.msUntilDue(millis());
+            if (dueMs != UINT32_MAX) wait = pdMS_TO_TICKS(dueMs);
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
         
-        for (int i = 0; i < NUM_LEDS; i++) {
-            int hue = (i * 256 / NUM_LEDS + animationFrame) & 255;
-            leds.setPixelColor(i, leds.ColorHSV(hue * 256, 255, 200));
+        CommandFrame frame;
+        while (commandQueue.pop(frame)) {
+            CommandAck executed;
+            executed.len = (uint8_t)commandExecute(frame, executed.data);
+            if (executed.len > 0 && !pendingAcks.push(executed)) {
+                LOG_W("Command ack %u dropped", frame.seq);
+            }
+            // A setting may have changed the brightness or frame time
+            xTaskNotifyGive(ledTaskHandle);
+        }
+        
+        // A confirmation that never comes (link lost) must not block acks
+        if (ackInFlight && millis() - ackSentMs >= CMD_ACK_TIMEOUT_MS) {
+            ackInFlight = false;
         }
-        leds.show();
         
-        animationFrame++;
-        if (animationFrame >= 256) animationFrame = 0;
+        serviceCrashEvents(crashOutbox, crashSentMs);
+        metricsSetLevel(METRIC_CRASH_OUTBOX_PENDING, crashOutbox.pending());
+        
+        // One indication per confirmation; an ack longer than the MTU
+        // goes out in parts
+        while (!ackInFlight && !crashOutbox.inFlight()) {
+            if (!ackPending) {
+                if (!pendingAcks.pop(ack)) break;
+                ackPos = 0;
+                ackPending = true;
+            }
+            if (!deviceConnected || pCommandChar->getSubscribedCount() == 0) {
+                ackPending = false;  // Dropped: the app resends after its timeout
+                continue;
+            }
+            uint8_t part[CMD_ACK_MAX];
+            size_t partLen = commandAckPart(ack.data, ack.len, ackPos, linkGetMtu() - 3, part);
+            ackPending = ackPos < ack.len;
+            ackInFlight = true;
+            ackSentMs = millis();
+            pCommandChar->setValue(part, partLen);
+            pCommandChar->indicate();
+        }
     }
 }
 
-// ============================================
-// BLE DATA TRANSMISSION
-// ============================================
+// LED rendering - frames are computed only when due and sent by the RMT
+// peripheral, so this task never blocks the bus or interrupts. It sleeps
+// until the next frame is due or a state entry action wakes it.
+void ledTask(void* param) {
+    while (true) {
+        uint32_t nextFrameMs = ledEngineUpdate(stateGet(), millis());
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(nextFrameMs));
+    }
+}
 
-void sendSensorData(SensorData& data) {
-    if (!deviceConnected) return;
+// Sampling, then the power manager that parks it. Sensing is live once
+// the first batch reaches the detection task.
+bool startSensing() {
+    if (!samplingBegin(detectionTaskHandle)) {
+        LOG_E("Sampling engine failed to start!");
+        return false;
+    }
+    sensingLive = true;
+    metricsSetSampling(true);
+    LOG_I("Boot: sensing at %u Hz, live after %u ms", (uint32_t)IMU_SAMPLE_RATE_HZ, (uint32_t)millis());
     
-    // Pack sensor data into bytes
-    // Format: [state(1)][gForce(4)][pitch(4)][roll(4)] = 13 bytes
-    uint8_t buffer[13];
+    if (!powerBegin(onPowerModeChange)) {
+        LOG_E("Power manager failed to start!");
+    }
+    return true;
+}
+
+// Telemetry - BLE setup, then notifies and reconnection, lowest priority
+void telemetryTask(void* param) {
+    // The BLE stack comes up here, while sensing and LEDs already run
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    uint32_t heapBeforeBLE = ESP.getFreeHeap();
+#endif
+    setupBLE();
+    LOG_I("Boot: advertising after %u ms", (uint32_t)millis());
     
-    buffer[0] = (uint8_t)currentState;
-    memcpy(&buffer[1], &data.gForce, 4);
-    memcpy(&buffer[5], &data.pitch, 4);
-    memcpy(&buffer[9], &data.roll, 4);
+    // Heap report - tracks what the BLE stack and tasks cost between builds
+    // (only in builds that log it)
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    uint32_t heapAfterBLE = ESP.getFreeHeap();
+    LOG_I("Heap: BLE stack %u bytes, free %u, min free %u, largest block %u",
+          heapBeforeBLE - heapAfterBLE, heapAfterBLE,
+          ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+#endif
     
-    pSensorChar->setValue(buffer, 13);
-    pSensorChar->notify();
+    unsigned long lastTraceReport = millis();
+    unsigned long lastMetricsReport = millis();
+    unsigned long lastImuRetry = millis();
+    
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TELEMETRY_MAX_LATENCY_MS));
+        
+        // No IMU at boot: keep probing instead of hanging
+        if (!sensingLive && millis() - lastImuRetry >= IMU_RETRY_INTERVAL_MS) {
+            lastImuRetry = millis();
+            if (initSensors()) {
+                LOG_I("MPU6500 found on retry");
+                ledEngineSetOverlay(LED_OVERLAY_NONE);
+                startSensing();
+            }
+        }
+        
+        pumpStream();
+        pumpBlackBox();
+        pumpRideLog();
+        calibrationService();
+        settingsService();
+        
+        if (TRACE_REPORT_INTERVAL_MS > 0 && millis() - lastTraceReport >= TRACE_REPORT_INTERVAL_MS) {
+            lastTraceReport = millis();
+            tracePrint();
+        }
+        if (METRICS_REPORT_INTERVAL_MS > 0 && millis() - lastMetricsReport >= METRICS_REPORT_INTERVAL_MS) {
+            lastMetricsReport = millis();
+            metricsPrint();
+        }
+        
+        TelemetryMsg msg;
+        while (telemetryQueue.pop(msg)) {
+            switch (msg.type) {
+                case TELEMETRY_SENSOR_DATA:
+                    sendSensorData(msg);
+                    break;
+            }
+        }
+        
+        // Advertising bursts / back-off and the advertised status
+        advService(millis(), advertisedStatus());
+    }
 }
 
-void sendCrashAlert() {
-    if (!deviceConnected) return;
+// Staged start: LEDs first (startup sweep, fault blink), then sensing,
+// then BLE in the background
+void startTasks(bool imuFound) {
+    xTaskCreate(ledTask, "leds", TASK_STACK_LED, nullptr,
+                TASK_PRIORITY_LED, &ledTaskHandle);
+    xTaskCreate(detectionTask, "detection", TASK_STACK_DETECTION, nullptr,
+                TASK_PRIORITY_DETECTION, &detectionTaskHandle);
+    xTaskCreate(controlTask, "control", TASK_STACK_CONTROL, nullptr,
+                TASK_PRIORITY_CONTROL, &controlTaskHandle);  // Wakes the LED task
+    
+    // The detection task records into both from its first sample
+    blackboxBegin();
+    rideLogBegin();
     
-    // Send crash alert
-    uint8_t alert = 0x01;  // Crash detected
-    pCrashChar->setValue(&alert, 1);
-    pCrashChar->notify();
+    // Sampling starts after the detection task so its first batch has a
+    // consumer; without an IMU the telemetry task keeps retrying
+    if (imuFound) {
+        startSensing();
+    } else {
+        ledEngineSetOverlay(LED_OVERLAY_SENSOR_FAULT);
+    }
     
-    Serial.println("CRASH ALERT sent to app!");
+    xTaskCreate(telemetryTask, "telemetry", TASK_STACK_TELEMETRY, nullptr,
+                TASK_PRIORITY_TELEMETRY, &telemetryTaskHandle);
 }
 
 // ============================================
@@ -505,38 +1209,49 @@ void sendCrashAlert() {
 
 void setup() {
     Serial.begin(115200);
-    delay(1000);
+#ifdef DEBUG
+    while (!Serial && millis() < BOOT_SERIAL_WAIT_MS) {
+        delay(10);
+    }
+#endif
     
     Serial.println("\n========================================");
     Serial.println("   Smart Bike Helmet - Starting Up");
     Serial.println("========================================\n");
     
-    // Initialize LEDs
-    leds.begin();
-    leds.setBrightness(LED_BRIGHTNESS);
-    leds.clear();
-    leds.show();
+    // Everything logged from the tasks goes through the deferred log;
+    // setup prints directly
+    if (!logBegin()) {
+        Serial.println("Log task failed to start!");
+    }
+    
+    // Tunables from NVS before anything reads them (LED brightness)
+    settingsBegin();
     
-    // Startup animation
-    Serial.println("LED startup sequence...");
-    for (int i = 0; i < NUM_LEDS; i++) {
-        leds.setPixelColor(i, leds.Color(0, 255, 0));
-        leds.show();
-        delay(50);
+    // LEDs first; the startup sweep plays from the LED task, so nothing
+    // here waits for it and a brake or crash cuts it short
+    if (!ledEngineBegin()) {
+        Serial.println("LED output (RMT) failed to start!");
     }
-    delay(500);
-    leds.clear();
-    leds.show();
+    ledEngineSetOverlay(LED_OVERLAY_STARTUP);
+    
+    // Entry/exit actions before anything can dispatch events
+    setupStateActions();
     
     // Initialize sensors
-    initSensors();
+    initI2C();
+    bool imuFound = initSensors();
+    Serial.println(imuFound ? "MPU6500 initialized" : "MPU6500 NOT FOUND - check wiring, retrying");
+    calibrationBegin();
     
-    // Initialize BLE
-    setupBLE();
+    // Sensing, LEDs and telemetry run in their own tasks from here on;
+    // BLE is set up by the telemetry task
+    traceBegin();
+    startTasks(imuFound);
     
-    Serial.println("\n========================================");
-    Serial.println("   Initialization Complete!");
-    Serial.println("========================================\n");
+    Serial.print("Setup done after ");
+    Serial.print(millis());
+    Serial.println(" ms");
 }
 
 // ============================================
@@ -544,107 +1259,6 @@ void setup() {
 // ============================================
 
 void loop() {
-    unsigned long currentTime = millis();
-    
-    // ----------------------------------------
-    // Read sensors (every 20ms = 50Hz)
-    // ----------------------------------------
-    if (currentTime - lastSensorRead >= 20) {
-        lastSensorRead = currentTime;
-        
-        SensorData sensorData = readSensors();
-        
-        // Handle crash detection
-        if (sensorData.isCrash && currentState != STATE_CRASH_ALERT) {
-            Serial.println("!!! CRASH DETECTED !!!");
-            currentState = STATE_CRASH_ALERT;
-            crashDetectedTime = currentTime;
-            sendCrashAlert();
-            gValueBuffer.clear();  // Reset buffer after crash
-        }
-        
-        // Handle brake detection (only if not in special state)
-        if (sensorData.isBraking && 
-            currentState != STATE_CRASH_ALERT && 
-            currentState != STATE_TURN_LEFT && 
-            currentState != STATE_TURN_RIGHT) {
-            
-            if (currentState != STATE_BRAKING) {
-                Serial.println("Braking detected!");
-                currentState = STATE_BRAKING;
-                brakeStartTime = currentTime;
-            }
-        }
-        
-        // Send sensor data via BLE (every 100ms)
-        if (currentTime - lastBLEUpdate >= 100) {
-            lastBLEUpdate = currentTime;
-            sendSensorData(sensorData);
-        }
-    }
-    
-    // ----------------------------------------
-    // State timeout handling
-    // ----------------------------------------
-    
-    // Crash confirmation timeout
-    if (currentState == STATE_CRASH_ALERT) {
-        if (currentTime - crashDetectedTime >= CRASH_CONFIRMATION_MS) {
-            Serial.println("!!! NO RESPONSE - CONFIRMING CRASH !!!");
-            // Here you could trigger emergency protocols
-            // For now, we'll keep flashing
-        }
-    }
-    
-    // Brake light timeout
-    if (currentState == STATE_BRAKING) {
-        if (currentTime - brakeStartTime >= BRAKE_FLASH_DURATION) {
-            currentState = STATE_NORMAL;
-        }
-    }
-    
-    // ----------------------------------------
-    // LED Animation based on state
-    // ----------------------------------------
-    leds.clear();
-    
-    switch (currentState) {
-        case STATE_NORMAL:
-            animateNormal();
-            break;
-            
-        case STATE_BRAKING:
-            animateBrake();
-            break;
-            
-        case STATE_TURN_LEFT:
-            animateTurnLeft();
-            break;
-            
-        case STATE_TURN_RIGHT:
-            animateTurnRight();
-            break;
-            
-        case STATE_CRASH_ALERT:
-            animateCrashAlert();
-            break;
-            
-        case STATE_PARTY:
-            animateParty();
-            break;
-    }
-    
-    // ----------------------------------------
-    // Handle BLE reconnection
-    // ----------------------------------------
-    if (!deviceConnected && oldDeviceConnected) {
-        delay(500);
-        pServer->startAdvertising();
-        Serial.println("BLE: Restarting advertising");
-        oldDeviceConnected = deviceConnected;
-    }
-    
-    if (deviceConnected && !oldDeviceConnected) {
-        oldDeviceConnected = deviceConnected;
-    }
+    // All work happens in the tasks started by setup()
+    vTaskDelete(nullptr);
 }
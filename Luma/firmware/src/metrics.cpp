@@ -0,0 +1,145 @@
+/*
+ * Health metrics - counters and peaks from every task, packed for the
+ * health characteristic and the serial report
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "log.h"
+#include "metrics.h"
+#include "sampling.h"
+
+static std::atomic<uint32_t> counters[METRIC_COUNTER_COUNT];
+static std::atomic<uint32_t> peaks[METRIC_PEAK_COUNT];
+static std::atomic<uint32_t> levels[METRIC_LEVEL_COUNT];
+
+// Full-rate sampling time: closed stretches plus the open one
+static std::atomic<bool> sampling{false};
+static std::atomic<uint32_t> samplingSinceMs{0};
+static std::atomic<uint32_t> samplingTotalMs{0};
+
+static const char* const TASK_NAMES[METRICS_TASK_COUNT] = METRICS_TASK_NAMES;
+
+void metricsCount(MetricCounter counter, uint32_t n) {
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void metricsPeak(MetricPeak peak, uint32_t value) {
+    uint32_t current = peaks[peak].load(std::memory_order_relaxed);
+    while (value > current &&
+           !peaks[peak].compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void metricsSetLevel(MetricLevel level, uint32_t value) {
+    levels[level].store(value, std::memory_order_relaxed);
+}
+
+void metricsSetSampling(bool active) {
+    if (sampling.load() == active) return;
+    uint32_t now = millis();
+    if (active) {
+        samplingSinceMs = now;
+    } else {
+        samplingTotalMs += now - samplingSinceMs.load();
+    }
+    sampling = active;
+}
+
+uint32_t metricsGet(MetricCounter counter) {
+    return counters[counter].load(std::memory_order_relaxed);
+}
+
+uint32_t metricsGetPeak(MetricPeak peak) {
+    return peaks[peak].load(std::memory_order_relaxed);
+}
+
+uint32_t metricsGetLevel(MetricLevel level) {
+    return levels[level].load(std::memory_order_relaxed);
+}
+
+void metricsResetPeaks() {
+    for (int i = 0; i < METRIC_PEAK_COUNT; i++) {
+        peaks[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+static uint32_t samplesExpected() {
+    uint32_t ms = samplingTotalMs.load();
+    if (sampling.load()) ms += millis() - samplingSinceMs.load();
+    return (uint32_t)((uint64_t)ms * IMU_SAMPLE_RATE_HZ / 1000);
+}
+
+// Stack bytes the task has never touched, 0xFFFF if it is not running
+static uint16_t stackHeadroom(const char* name) {
+    TaskHandle_t task = xTaskGetHandle(name);
+    if (task == nullptr) return 0xFFFF;
+    UBaseType_t free = uxTaskGetStackHighWaterMark(task);  // Bytes on ESP-IDF
+    return free > 0xFFFE ? 0xFFFE : (uint16_t)free;
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+size_t metricsPack(uint8_t* out) {
+    SamplingStats stats = samplingGetStats();
+
+    out[0] = METRICS_PACKED_VERSION;
+    out[1] = METRICS_TASK_COUNT;
+    uint8_t* p = out + 2;
+    p = putU32(p, millis());
+    p = putU32(p, stats.samples + stats.queueDrops);
+    p = putU32(p, samplesExpected());
+    p = putU32(p, stats.queueDrops);
+    p = putU32(p, stats.fifoOverflows);
+    p = putU32(p, metricsGet(METRIC_I2C_ERRORS));
+    p = putU32(p, metricsGetPeak(METRIC_DETECTION_MAX_US));
+    p = putU32(p, metricsGet(METRIC_DETECTION_OVERRUNS));
+    p = putU32(p, metricsGetPeak(METRIC_LED_FRAME_MAX_US));
+    p = putU32(p, metricsGet(METRIC_NOTIFY_OK));
+    p = putU32(p, metricsGet(METRIC_NOTIFY_FAILED));
+    p = putU32(p, ESP.getFreeHeap());
+    p = putU32(p, ESP.getMinFreeHeap());
+    p = putU32(p, metricsGetLevel(METRIC_STREAM_QUEUE_DEPTH));
+    p = putU32(p, metricsGetPeak(METRIC_STREAM_QUEUE_MAX));
+    p = putU32(p, metricsGetLevel(METRIC_CRASH_OUTBOX_PENDING));
+
+    for (int t = 0; t < METRICS_TASK_COUNT; t++) {
+        uint16_t headroom = stackHeadroom(TASK_NAMES[t]);
+        p[0] = (uint8_t)headroom;
+        p[1] = (uint8_t)(headroom >> 8);
+        p += 2;
+    }
+    return METRICS_PACKED_LEN;
+}
+
+void metricsPrint() {
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    SamplingStats stats = samplingGetStats();
+
+    LOG_I("Health: samples %lu / %lu expected, %lu queue drops, %lu FIFO overflows, %lu I2C errors",
+          stats.samples + stats.queueDrops, samplesExpected(), stats.queueDrops,
+          stats.fifoOverflows, metricsGet(METRIC_I2C_ERRORS));
+    LOG_I("  detection max %lu us, %lu overruns; LED frame max %lu us",
+          metricsGetPeak(METRIC_DETECTION_MAX_US), metricsGet(METRIC_DETECTION_OVERRUNS),
+          metricsGetPeak(METRIC_LED_FRAME_MAX_US));
+    LOG_I("  notify %lu ok / %lu failed; heap free %u, min free %u",
+          metricsGet(METRIC_NOTIFY_OK), metricsGet(METRIC_NOTIFY_FAILED),
+          ESP.getFreeHeap(), ESP.getMinFreeHeap());
+    LOG_I("  stream queue %lu, max %lu of %u; crash outbox %lu pending",
+          metricsGetLevel(METRIC_STREAM_QUEUE_DEPTH), metricsGetPeak(METRIC_STREAM_QUEUE_MAX),
+          TELEMETRY_SAMPLE_QUEUE_LENGTH, metricsGetLevel(METRIC_CRASH_OUTBOX_PENDING));
+    for (int t = 0; t < METRICS_TASK_COUNT; t++) {
+        uint16_t headroom = stackHeadroom(TASK_NAMES[t]);
+        if (headroom != 0xFFFF) {
+            LOG_I("  stack %-9s %u bytes free", TASK_NAMES[t], headroom);
+        }
+    }
+#endif
+}
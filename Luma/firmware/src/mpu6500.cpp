@@ -0,0 +1,190 @@
+/*
+ * MPU6500 driver - direct register access over I2C
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "metrics.h"
+#include "mpu6500.h"
+
+bool mpuProbe() {
+    Wire.beginTransmission(MPU6500_I2C_ADDR);
+    return Wire.endTransmission() == 0;
+}
+
+void mpuWriteRegister(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(MPU6500_I2C_ADDR);
+    Wire.write(reg);
+    Wire.write(value);
+    if (Wire.endTransmission(true) != 0) {
+        metricsCount(METRIC_I2C_ERRORS);
+    }
+}
+
+void mpuConfigure() {
+    // Wake up (clear sleep bit)
+    mpuWriteRegister(MPU6500_REG_PWR_MGMT_1, 0x00);
+
+    // ±8g range (bits 4:3 = 10) for crash detection headroom
+    mpuWriteRegister(MPU6500_REG_ACCEL_CONFIG, 0x10);
+
+    // ±500°/s range (bits 4:3 = 01)
+    mpuWriteRegister(MPU6500_REG_GYRO_CONFIG, 0x08);
+
+    // Ranges apply at once; only the gyro output needs to settle
+    delay(MPU6500_GYRO_STARTUP_MS);
+}
+
+bool mpuReadRegisters(uint8_t reg, uint8_t* buffer, uint8_t len) {
+    Wire.beginTransmission(MPU6500_I2C_ADDR);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) {
+        metricsCount(METRIC_I2C_ERRORS);
+        return false;
+    }
+
+    // A short read leaves the caller's buffer untouched - never zeros
+    if (Wire.requestFrom((uint8_t)MPU6500_I2C_ADDR, len) != len) {
+        metricsCount(METRIC_I2C_ERRORS);
+        return false;
+    }
+
+    for (uint8_t i = 0; i < len; i++) {
+        buffer[i] = Wire.read();
+    }
+    return true;
+}
+
+void mpuDecodeSample(const uint8_t* raw, ImuRawSample& sample) {
+    sample.accelX      = (int16_t)(raw[0] << 8 | raw[1]);
+    sample.accelY      = (int16_t)(raw[2] << 8 | raw[3]);
+    sample.accelZ      = (int16_t)(raw[4] << 8 | raw[5]);
+    sample.temperature = (int16_t)(raw[6] << 8 | raw[7]);
+    sample.gyroX       = (int16_t)(raw[8] << 8 | raw[9]);
+    sample.gyroY       = (int16_t)(raw[10] << 8 | raw[11]);
+    sample.gyroZ       = (int16_t)(raw[12] << 8 | raw[13]);
+}
+
+bool mpuReadSample(ImuRawSample& sample) {
+    uint8_t raw[MPU6500_DATA_BLOCK_LEN];
+
+    if (!mpuReadRegisters(MPU6500_REG_ACCEL_XOUT_H, raw, MPU6500_DATA_BLOCK_LEN)) {
+        return false;
+    }
+
+    mpuDecodeSample(raw, sample);
+    return true;
+}
+
+// ============================================
+// FIFO + DATA-READY INTERRUPT
+// ============================================
+
+// Wire's RX buffer is 128 bytes, so read at most 9 packets per transaction
+#define FIFO_PACKETS_PER_READ (128 / MPU6500_DATA_BLOCK_LEN)
+
+void mpuConfigureFifo(uint16_t rateHz) {
+    // Stop FIFO and interrupts while reconfiguring
+    mpuWriteRegister(MPU6500_REG_INT_ENABLE, 0x00);
+    mpuWriteRegister(MPU6500_REG_FIFO_EN, 0x00);
+    mpuWriteRegister(MPU6500_REG_USER_CTRL, 0x00);
+
+    // DLPF_CFG = 1 (184 Hz gyro bandwidth, 1 kHz internal rate).
+    // FIFO_MODE = 0: oldest data is overwritten on overflow.
+    mpuWriteRegister(MPU6500_REG_CONFIG, 0x01);
+    mpuWriteRegister(MPU6500_REG_ACCEL_CONFIG2, 0x01);  // 184 Hz accel DLPF
+
+    // Sample rate = 1 kHz / (1 + SMPLRT_DIV)
+    uint16_t div = MPU6500_INTERNAL_RATE_HZ / rateHz;
+    if (div < 1) div = 1;
+    if (div > 256) div = 256;
+    mpuWriteRegister(MPU6500_REG_SMPLRT_DIV, (uint8_t)(div - 1));
+
+    // INT pin: active high, push-pull, 50us pulse per sample
+    mpuWriteRegister(MPU6500_REG_INT_PIN_CFG, 0x00);
+
+    // TEMP + GYRO_X/Y/Z + ACCEL into the FIFO
+    mpuWriteRegister(MPU6500_REG_FIFO_EN, 0xF8);
+    mpuResetFifo();
+
+    mpuReadIntStatus();  // Clear stale status
+    mpuWriteRegister(MPU6500_REG_INT_ENABLE, MPU6500_INT_RAW_RDY);
+}
+
+void mpuResetFifo() {
+    mpuWriteRegister(MPU6500_REG_USER_CTRL, 0x04);  // FIFO_RST
+    mpuWriteRegister(MPU6500_REG_USER_CTRL, 0x40);  // FIFO_EN
+}
+
+int mpuReadFifoCount() {
+    uint8_t raw[2];
+    if (!mpuReadRegisters(MPU6500_REG_FIFO_COUNTH, raw, 2)) {
+        return -1;
+    }
+    return ((raw[0] & 0x1F) << 8) | raw[1];
+}
+
+uint8_t mpuReadIntStatus() {
+    uint8_t status = 0;
+    mpuReadRegisters(MPU6500_REG_INT_STATUS, &status, 1);
+    return status;
+}
+
+uint16_t mpuReadFifo(ImuRawSample* samples, uint16_t count) {
+    uint8_t raw[FIFO_PACKETS_PER_READ * MPU6500_DATA_BLOCK_LEN];
+    uint16_t done = 0;
+
+    while (done < count) {
+        uint16_t chunk = count - done;
+        if (chunk > FIFO_PACKETS_PER_READ) chunk = FIFO_PACKETS_PER_READ;
+
+        if (!mpuReadRegisters(MPU6500_REG_FIFO_R_W, raw, chunk * MPU6500_DATA_BLOCK_LEN)) {
+            break;
+        }
+
+        for (uint16_t i = 0; i < chunk; i++) {
+            mpuDecodeSample(&raw[i * MPU6500_DATA_BLOCK_LEN], samples[done + i]);
+        }
+        done += chunk;
+    }
+    return done;
+}
+
+void mpuEnableWakeOnMotion(uint16_t thresholdMg, uint8_t lpOdr) {
+    mpuWriteRegister(MPU6500_REG_INT_ENABLE, 0x00);
+    mpuWriteRegister(MPU6500_REG_FIFO_EN, 0x00);
+    mpuWriteRegister(MPU6500_REG_USER_CTRL, 0x00);
+
+    // Accel running, gyro X/Y/Z in standby
+    mpuWriteRegister(MPU6500_REG_PWR_MGMT_1, 0x00);
+    mpuWriteRegister(MPU6500_REG_PWR_MGMT_2, 0x07);
+
+    // ACCEL_FCHOICE_B = 1, A_DLPF_CFG = 1 as required for the LP cycle
+    mpuWriteRegister(MPU6500_REG_ACCEL_CONFIG2, 0x09);
+
+    // INT pin: active high, latched until INT_STATUS is read
+    mpuWriteRegister(MPU6500_REG_INT_PIN_CFG, 0x30);
+    mpuWriteRegister(MPU6500_REG_INT_ENABLE, MPU6500_INT_WOM);
+
+    // ACCEL_INTEL_EN + compare each sample with the previous one
+    mpuWriteRegister(MPU6500_REG_ACCEL_INTEL_CTRL, 0xC0);
+
+    uint16_t threshold = thresholdMg / MPU6500_WOM_MG_PER_LSB;
+    if (threshold < 1) threshold = 1;
+    if (threshold > 255) threshold = 255;
+    mpuWriteRegister(MPU6500_REG_WOM_THR, (uint8_t)threshold);
+    mpuWriteRegister(MPU6500_REG_LP_ACCEL_ODR, lpOdr);
+
+    mpuReadIntStatus();  // Clear stale status
+
+    // CYCLE: sleep between accel samples
+    mpuWriteRegister(MPU6500_REG_PWR_MGMT_1, 0x20);
+}
+
+void mpuDisableWakeOnMotion() {
+    mpuWriteRegister(MPU6500_REG_INT_ENABLE, 0x00);
+    mpuWriteRegister(MPU6500_REG_PWR_MGMT_1, 0x00);
+    mpuWriteRegister(MPU6500_REG_ACCEL_INTEL_CTRL, 0x00);
+    mpuWriteRegister(MPU6500_REG_PWR_MGMT_2, 0x00);
+    mpuReadIntStatus();
+}
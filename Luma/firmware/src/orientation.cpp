@@ -0,0 +1,159 @@
+/*
+ * Orientation filter - Mahony complementary filter on a quaternion
+ *
+ * Per sample: one cross product for the accel correction, a first-order
+ * quaternion integration step and a rotation of the linear acceleration
+ * into the level frame. Square roots are the only non-arithmetic calls.
+ */
+
+#include <math.h>
+#include "config.h"
+#include "orientation.h"
+
+#define DEG_TO_RAD_F 0.017453293f
+#define RAD_TO_DEG_F 57.29578f
+
+OrientationFilter::OrientationFilter() {
+    reset();
+}
+
+void OrientationFilter::reset() {
+    q0 = 1.0f;
+    q1 = q2 = q3 = 0.0f;
+    ix = iy = iz = 0.0f;
+    vx = vy = 0.0f;
+    vz = 1.0f;
+    headingCos = 1.0f;
+    headingSin = 0.0f;
+    aligned = false;
+    lin = LinearAccel{ 0.0f, 0.0f, 0.0f };
+}
+
+// Rotate the measured gravity direction onto earth Z (zero yaw)
+void OrientationFilter::align(float ax, float ay, float az) {
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+    if (norm <= 0.0f) return;
+    ax /= norm;
+    ay /= norm;
+    az /= norm;
+
+    if (az < -0.9999f) {
+        // Upside down: 180° about X
+        q0 = 0.0f; q1 = 1.0f; q2 = 0.0f; q3 = 0.0f;
+    } else {
+        // Shortest arc from a to Z: (1 + a.z, a x z), normalised
+        float w = 1.0f + az;
+        float recip = 1.0f / sqrtf(w * w + ay * ay + ax * ax);
+        q0 = w * recip;
+        q1 = ay * recip;
+        q2 = -ax * recip;
+        q3 = 0.0f;
+    }
+    aligned = true;
+}
+
+// Third row of the body -> earth rotation = earth Z seen from the body
+void OrientationFilter::updateGravity() {
+    vx = 2.0f * (q1 * q3 - q0 * q2);
+    vy = 2.0f * (q0 * q1 + q2 * q3);
+    vz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+}
+
+void OrientationFilter::update(float ax, float ay, float az,
+                               float gx, float gy, float gz, float dt) {
+    if (dt <= 0.0f || dt > ORIENTATION_MAX_DT_S) {
+        reset();
+    }
+    if (!aligned) {
+        align(ax, ay, az);
+        updateGravity();
+        dt = 0.0f;
+    }
+
+    gx *= DEG_TO_RAD_F;
+    gy *= DEG_TO_RAD_F;
+    gz *= DEG_TO_RAD_F;
+
+    // Accel correction only while the accel is (close to) pure gravity
+    float norm2 = ax * ax + ay * ay + az * az;
+    float lo = 1.0f - ORIENTATION_ACCEL_GATE_G;
+    float hi = 1.0f + ORIENTATION_ACCEL_GATE_G;
+    if (dt > 0.0f && norm2 > lo * lo && norm2 < hi * hi) {
+        float recip = 1.0f / sqrtf(norm2);
+        float nx = ax * recip;
+        float ny = ay * recip;
+        float nz = az * recip;
+
+        // Error = measured x estimated gravity direction
+        float ex = ny * vz - nz * vy;
+        float ey = nz * vx - nx * vz;
+        float ez = nx * vy - ny * vx;
+
+        ix += ORIENTATION_KI * ex * dt;
+        iy += ORIENTATION_KI * ey * dt;
+        iz += ORIENTATION_KI * ez * dt;
+
+        gx += ORIENTATION_KP * ex + ix;
+        gy += ORIENTATION_KP * ey + iy;
+        gz += ORIENTATION_KP * ez + iz;
+    } else {
+        gx += ix;
+        gy += iy;
+        gz += iz;
+    }
+
+    // q += 0.5 * q (x) omega * dt
+    float hx = 0.5f * dt * gx;
+    float hy = 0.5f * dt * gy;
+    float hz = 0.5f * dt * gz;
+    float qa = q0, qb = q1, qc = q2;
+    q0 += -qb * hx - qc * hy - q3 * hz;
+    q1 += qa * hx + qc * hz - q3 * hy;
+    q2 += qa * hy - qb * hz + q3 * hx;
+    q3 += qa * hz + qb * hy - qc * hx;
+
+    float recip = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q0 *= recip;
+    q1 *= recip;
+    q2 *= recip;
+    q3 *= recip;
+
+    updateGravity();
+
+    // Linear acceleration: body frame, then earth frame
+    float lx = ax - vx;
+    float ly = ay - vy;
+    float lz = az - vz;
+
+    float r00 = 1.0f - 2.0f * (q2 * q2 + q3 * q3);
+    float r01 = 2.0f * (q1 * q2 - q0 * q3);
+    float r02 = 2.0f * (q1 * q3 + q0 * q2);
+    float r10 = 2.0f * (q1 * q2 + q0 * q3);
+    float r11 = 1.0f - 2.0f * (q1 * q1 + q3 * q3);
+    float r12 = 2.0f * (q2 * q3 - q0 * q1);
+
+    float earthX = r00 * lx + r01 * ly + r02 * lz;
+    float earthY = r10 * lx + r11 * ly + r12 * lz;
+    float earthZ = vx * lx + vy * ly + vz * lz;
+
+    // Heading = body X projected onto the horizontal (first column of R).
+    // Undefined while looking straight up or down: keep the last one.
+    float heading2 = r00 * r00 + r10 * r10;
+    if (heading2 > 0.01f) {
+        float recipHeading = 1.0f / sqrtf(heading2);
+        headingCos = r00 * recipHeading;
+        headingSin = r10 * recipHeading;
+    }
+
+    lin.forward = headingCos * earthX + headingSin * earthY;
+    lin.lateral = -headingSin * earthX + headingCos * earthY;
+    lin.vertical = earthZ;
+}
+
+float OrientationFilter::pitchDeg() const {
+    return atan2f(vx, sqrtf(vy * vy + vz * vz)) * RAD_TO_DEG_F;
+}
+
+float OrientationFilter::rollDeg() const {
+    return atan2f(vy, sqrtf(vx * vx + vz * vz)) * RAD_TO_DEG_F;
+}
@@ -0,0 +1,141 @@
+/*
+ * Power manager - activity tracking, idle / sleep decisions, light sleep
+ *
+ * The power task only decides; the IMU is reconfigured by the sampling
+ * task (its only I2C user) and LEDs / BLE by the mode hook. In sleep the
+ * chip enters light sleep with the MPU INT pin as the wakeup source: its
+ * wake-on-motion output is latched, so a level wakeup cannot miss it.
+ */
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <math.h>
+#include <atomic>
+#include "config.h"
+#include "helmet_state.h"
+#include "log.h"
+#include "power.h"
+#include "sampling.h"
+
+// Time for the mode hook's effects (blank LED frame) to reach the hardware
+#define POWER_SLEEP_SETTLE_MS 20
+
+static TaskHandle_t powerTaskHandle = nullptr;
+static PowerModeHook modeHook = nullptr;
+static std::atomic<uint8_t> mode{POWER_ACTIVE};
+static std::atomic<uint32_t> lastMotionMs{0};
+static std::atomic<bool> connected{false};
+static std::atomic<bool> motionSeen{false};  // Sampling task resumed full rate
+static uint32_t modeEnteredMs = 0;           // Power task only
+
+static const char* const MODE_NAMES[] = { "active", "idle", "sleep" };
+
+static void setMode(PowerMode to) {
+    PowerMode from = (PowerMode)mode.load();
+    if (from == to) return;
+
+    mode = to;
+    modeEnteredMs = millis();
+    if (modeHook != nullptr) {
+        modeHook(from, to);
+    }
+
+    LOG_I("Power: %s", MODE_NAMES[to]);
+}
+
+// Sampling task, right after full-rate sampling has resumed
+static void onImuMotion() {
+    lastMotionMs = millis();
+    motionSeen = true;
+    xTaskNotifyGive(powerTaskHandle);
+}
+
+// The pin's edge interrupt is masked while asleep and a level wakeup used
+// instead; any edge missed that way is picked up by samplingWake().
+static void lightSleepUntilMotion() {
+    gpio_num_t pin = (gpio_num_t)PIN_MPU_INT;
+
+    Serial.flush();
+    gpio_intr_disable(pin);
+    gpio_wakeup_enable(pin, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+    // Refused (e.g. radio still busy): stay awake, retry next check
+    esp_light_sleep_start();
+
+    gpio_wakeup_disable(pin);
+    gpio_set_intr_type(pin, GPIO_INTR_POSEDGE);
+    gpio_intr_enable(pin);
+
+    samplingWake();
+}
+
+static void powerTask(void* param) {
+    while (true) {
+        if (mode == POWER_SLEEP && !motionSeen) {
+            lightSleepUntilMotion();
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(POWER_CHECK_INTERVAL_MS));
+        uint32_t now = millis();
+
+        if (motionSeen.exchange(false)) {
+            setMode(POWER_ACTIVE);
+            continue;
+        }
+
+        switch (mode.load()) {
+            case POWER_ACTIVE:
+                if (stateGet() == STATE_NORMAL &&
+                    now - lastMotionMs >= POWER_IDLE_AFTER_MS &&
+                    samplingEnterLowPower(onImuMotion)) {
+                    setMode(POWER_IDLE);
+                }
+                break;
+
+            case POWER_IDLE:
+                if (!connected && now - modeEnteredMs >= POWER_SLEEP_AFTER_MS) {
+                    setMode(POWER_SLEEP);
+                    vTaskDelay(pdMS_TO_TICKS(POWER_SLEEP_SETTLE_MS));
+                }
+                break;
+
+            case POWER_SLEEP:
+                break;
+        }
+    }
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+bool powerBegin(PowerModeHook onModeChange) {
+    modeHook = onModeChange;
+    lastMotionMs = millis();
+    modeEnteredMs = millis();
+
+    return xTaskCreate(powerTask, "power", TASK_STACK_POWER, nullptr,
+                       TASK_PRIORITY_POWER, &powerTaskHandle) == pdPASS;
+}
+
+void powerNoteSample(float gForce, float gyroX, float gyroY, float gyroZ) {
+    bool still = fabsf(gForce - 1.0f) < POWER_STILL_G &&
+                 fabsf(gyroX) < POWER_STILL_DPS &&
+                 fabsf(gyroY) < POWER_STILL_DPS &&
+                 fabsf(gyroZ) < POWER_STILL_DPS;
+    if (!still) {
+        lastMotionMs.store(millis(), std::memory_order_relaxed);
+    }
+}
+
+void powerSetConnected(bool isConnected) {
+    connected = isConnected;
+}
+
+PowerMode powerGetMode() {
+    return (PowerMode)mode.load();
+}
@@ -0,0 +1,68 @@
+/*
+ * On-device Random Forest event classifier
+ *
+ * The forest comes from rf_model.h (written by export_classifier.py).
+ * Every tree is walked for exactly RF_MAX_DEPTH steps - leaves loop to
+ * themselves - so a prediction costs RF_NUM_TREES * RF_MAX_DEPTH compares
+ * and a constant amount of time regardless of the input.
+ */
+
+#include "config.h"
+#include "rf_classifier.h"
+
+// Decimate the IMU stream to the rate the model was trained at
+#define RF_DECIMATION (IMU_SAMPLE_RATE_HZ / RF_SAMPLE_RATE_HZ)
+
+static_assert(RF_FEATURE_COUNT == RF_NUM_FEATURES,
+              "rf_model.h was exported for a different feature set");
+static_assert(IMU_SAMPLE_RATE_HZ % RF_SAMPLE_RATE_HZ == 0,
+              "IMU rate must be a multiple of the model rate");
+
+RfResult rfPredict(const float* features, uint32_t* votes) {
+    uint32_t sums[RF_NUM_CLASSES] = {0};
+
+    for (int t = 0; t < RF_NUM_TREES; t++) {
+        uint16_t node = RF_TREE_ROOTS[t];
+        for (int d = 0; d < RF_MAX_DEPTH; d++) {
+            const RfNode& n = RF_NODES[node];
+            node = features[n.feature] <= n.threshold ? n.left : n.right;
+        }
+        const uint8_t* probs = RF_LEAF_PROBS[RF_NODES[node].leaf];
+        for (int c = 0; c < RF_NUM_CLASSES; c++) {
+            sums[c] += probs[c];
+        }
+    }
+
+    RfResult result = { 0, 0 };
+    uint32_t best = 0;
+    for (int c = 0; c < RF_NUM_CLASSES; c++) {
+        if (sums[c] > best) {
+            best = sums[c];
+            result.label = c;
+        }
+        if (votes != nullptr) votes[c] = sums[c];
+    }
+    result.confidence = (uint8_t)(best / RF_NUM_TREES);
+    return result;
+}
+
+void EventClassifier::reset() {
+    extractor.reset();
+    decimation = 0;
+    hop = 0;
+}
+
+bool EventClassifier::update(const ImuVector& sample, RfResult& result) {
+    // Keep every RF_DECIMATION-th sample (the training data was point-sampled)
+    if (++decimation < RF_DECIMATION) return false;
+    decimation = 0;
+
+    extractor.update(sample);
+    if (!extractor.ready() || ++hop < RF_HOP_SAMPLES) return false;
+    hop = 0;
+
+    float features[RF_FEATURE_COUNT];
+    extractor.compute(features);
+    result = rfPredict(features);
+    return true;
+}
@@ -0,0 +1,72 @@
+/*
+ * Window features for the on-device RF classifier, on top of the
+ * sliding-window engine in window_features.h
+ */
+
+#include "rf_features.h"
+
+void RfFeatureExtractor::reset() {
+    window.reset();
+    for (int a = 0; a < 3; a++) medians[a].reset();
+}
+
+void RfFeatureExtractor::update(const ImuVector& s) {
+    float in[3] = { s.ax, s.ay, s.az };
+    for (int a = 0; a < 3; a++) {
+        // Read the leaving sample before the window overwrites it
+        if (window.accel[a].full()) {
+            medians[a].replace(window.accel[a].at(0), in[a]);
+        } else {
+            medians[a].add(in[a]);
+        }
+    }
+    window.update(s);
+}
+
+void RfFeatureExtractor::compute(float* f) const {
+    static const RfFeature accelBase[3] = { FEAT_ACCEL_X_MEAN, FEAT_ACCEL_Y_MEAN, FEAT_ACCEL_Z_MEAN };
+    static const RfFeature gyroBase[3] = { FEAT_GYRO_X_MEAN, FEAT_GYRO_Y_MEAN, FEAT_GYRO_Z_MEAN };
+
+    for (int a = 0; a < 3; a++) {
+        const AxisWindow<N>& w = window.accel[a];
+        int b = accelBase[a];
+        f[b + 0] = w.mean();
+        f[b + 1] = w.stddev();
+        f[b + 2] = w.max();
+        f[b + 3] = w.min();
+        f[b + 4] = w.range();
+        f[b + 5] = medians[a].value();
+        f[b + 6] = w.skewness();
+        f[b + 7] = w.kurtosis();
+    }
+
+    const AxisWindow<N, true>& am = window.accelMag;
+    f[FEAT_ACCEL_MAG_MEAN] = am.mean();
+    f[FEAT_ACCEL_MAG_STD] = am.stddev();
+    f[FEAT_ACCEL_MAG_MAX] = am.max();
+    f[FEAT_ACCEL_MAG_RANGE] = am.range();
+
+    for (int a = 0; a < 3; a++) {
+        const AxisWindow<N>& w = window.gyro[a];
+        int b = gyroBase[a];
+        f[b + 0] = w.mean();
+        f[b + 1] = w.stddev();
+        f[b + 2] = w.max();
+        f[b + 3] = w.range();
+    }
+
+    const AxisWindow<N>& gm = window.gyroMag;
+    f[FEAT_GYRO_MAG_MEAN] = gm.mean();
+    f[FEAT_GYRO_MAG_STD] = gm.stddev();
+    f[FEAT_GYRO_MAG_MAX] = gm.max();
+
+    // jerk is a numpy array in training, so its std is ddof = 0
+    f[FEAT_JERK_MEAN] = am.jerkMean();
+    f[FEAT_JERK_MAX] = am.peakJerk();
+    f[FEAT_JERK_STD] = am.jerkStd();
+
+    f[FEAT_ACCEL_ENERGY] = am.energy();
+    f[FEAT_GYRO_ENERGY] = gm.energy();
+
+    f[FEAT_ACCEL_X_ZCR] = (float)window.accel[0].zeroCrossings() / (float)N;
+}
@@ -0,0 +1,58 @@
+/*
+ * Ride log sample codec - zigzag varint deltas and the block CRC
+ */
+
+#include "ride_codec.h"
+
+static uint8_t* putVarint(uint8_t* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+size_t rideEncodeSample(uint8_t* out, const int16_t values[RIDE_AXES], int16_t previous[RIDE_AXES]) {
+    uint8_t* start = out;
+    for (int i = 0; i < RIDE_AXES; i++) {
+        int32_t delta = (int32_t)values[i] - previous[i];
+        out = putVarint(out, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));  // Zigzag
+        previous[i] = values[i];
+    }
+    return (size_t)(out - start);
+}
+
+size_t rideDecodeSample(const uint8_t* in, size_t len, int16_t previous[RIDE_AXES]) {
+    size_t pos = 0;
+    for (int i = 0; i < RIDE_AXES; i++) {
+        uint32_t zigzag = 0;
+        int shift = 0;
+        while (true) {
+            if (pos == len || shift > 14) return 0;
+            uint8_t byte = in[pos++];
+            zigzag |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) break;
+        }
+        int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        previous[i] = (int16_t)(previous[i] + delta);
+    }
+    return pos;
+}
+
+// Half-byte table: 64 bytes of flash, a block's payload in well under 1 ms
+static const uint32_t CRC_NIBBLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t rideCrc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFFUL;
+}
@@ -0,0 +1,418 @@
+/*
+ * Ride log - full-rate IMU sessions in a flash ring of compressed blocks
+ *
+ * The detection task encodes samples into a ring of RIDELOG_RAM_BLOCKS
+ * RAM blocks and hands a full one to the writer task by setting
+ * blockFull; it then fills the next. Blocks are sealed and written in
+ * ring order, so flash order is seal order. Ending a session from another task
+ * takes recorderBusy, which the detection task only ever try-locks: at
+ * worst it drops one sample (seen as a gap) instead of waiting.
+ */
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <string.h>
+#include "config.h"
+#include "helmet_state.h"
+#include "latency_trace.h"
+#include "log.h"
+#include "ride_codec.h"
+#include "ride_log.h"
+
+#define FLASH_WRITE_CHUNK  256   // One flash page per write call
+
+#define SLOT_EMPTY 0xFFFFFFFFUL
+
+static const esp_partition_t* partition = nullptr;
+static TaskHandle_t writerTaskHandle = nullptr;
+static std::atomic<bool> eraseRequested{false};
+static std::atomic<bool> sessionEndRequested{false};
+static std::atomic<uint32_t> droppedSamples{0};
+
+// ---- RAM blocks (see ownership note above) ----
+alignas(4) static uint8_t blocks[RIDELOG_RAM_BLOCKS][RIDE_BLOCK_SIZE];
+static std::atomic<bool> blockFull[RIDELOG_RAM_BLOCKS];
+
+// ---- Recorder (detection task, or whoever holds recorderBusy) ----
+static std::atomic<bool> recorderBusy{false};
+static int8_t activeBlock = -1;      // Block being filled, -1 none
+static uint8_t nextBlock = 0;        // Block to fill after the active one
+static bool sessionOpen = false;
+static bool afterGap = false;
+static uint32_t sessionId = 0;       // Current (or last) session
+static uint32_t sessionBaseSeq = 0;  // ImuSample::sequence of sample_index 0
+static uint32_t expectedSeq = 0;
+static int16_t previous[RIDE_AXES];
+
+// ---- Slot index (writer task updates, readers scan) ----
+static uint32_t slotSeqs[RIDELOG_MAX_SLOTS];
+static uint16_t slotCount = 0;
+static uint16_t nextSlot = 0;
+static uint32_t nextSeq = 0;
+
+static RideBlockHeader& headerOf(uint8_t block) {
+    return *(RideBlockHeader*)blocks[block];
+}
+
+// ============================================
+// ENCODING
+// ============================================
+
+// Seal the active block and hand it to the writer task
+static void sealActive() {
+    if (activeBlock < 0) return;
+    uint8_t block = (uint8_t)activeBlock;
+    activeBlock = -1;
+
+    if (headerOf(block).sampleCount == 0) {
+        nextBlock = block;  // Nothing in it: fill it again
+        return;
+    }
+    blockFull[block].store(true, std::memory_order_release);
+    if (writerTaskHandle != nullptr) xTaskNotifyGive(writerTaskHandle);
+}
+
+// Start a block with `sample` as its first sample; false if the writer
+// still owns the block that is due
+static bool openBlock(const ImuSample& sample) {
+    if (blockFull[nextBlock].load(std::memory_order_acquire)) return false;
+
+    activeBlock = (int8_t)nextBlock;
+    nextBlock = (nextBlock + 1) % RIDELOG_RAM_BLOCKS;
+
+    RideBlockHeader& h = headerOf((uint8_t)activeBlock);
+    memset(&h, 0, sizeof(h));
+    h.sessionId = sessionId;
+    h.firstSampleIndex = sample.sequence - sessionBaseSeq;
+    h.firstTimestampUs = sample.timestampUs;
+    h.sampleRateHz = IMU_SAMPLE_RATE_HZ;
+    if (h.firstSampleIndex == 0) h.flags |= RIDE_BLOCK_SESSION_START;
+    if (afterGap) h.flags |= RIDE_BLOCK_AFTER_GAP;
+    afterGap = false;
+
+    // Deltas start from 0, so every block decodes on its own
+    memset(previous, 0, sizeof(previous));
+    return true;
+}
+
+static void record(const ImuSample& sample) {
+    if (!sessionOpen) {
+        sessionOpen = true;
+        sessionId++;
+        sessionBaseSeq = sample.sequence;
+        expectedSeq = sample.sequence;
+        afterGap = false;
+    }
+
+    // Timestamps are implied by the rate, so a lost sample ends the block
+    if (sample.sequence != expectedSeq) {
+        sealActive();
+        afterGap = true;
+    }
+    expectedSeq = sample.sequence + 1;
+
+    if (activeBlock >= 0 && (size_t)headerOf((uint8_t)activeBlock).payloadLength + RIDE_SAMPLE_MAX_BYTES > RIDE_PAYLOAD_MAX) {
+        sealActive();
+    }
+    if (activeBlock < 0 && !openBlock(sample)) {
+        droppedSamples.fetch_add(1, std::memory_order_relaxed);
+        afterGap = true;
+        return;
+    }
+
+    const int16_t values[RIDE_AXES] = {
+        sample.raw.accelX, sample.raw.accelY, sample.raw.accelZ,
+        sample.raw.gyroX, sample.raw.gyroY, sample.raw.gyroZ
+    };
+    RideBlockHeader& h = headerOf((uint8_t)activeBlock);
+    uint8_t* out = blocks[activeBlock] + sizeof(RideBlockHeader) + h.payloadLength;
+    h.payloadLength += (uint16_t)rideEncodeSample(out, values, previous);
+    h.sampleCount++;
+}
+
+// ============================================
+// FLASH LAYOUT
+// ============================================
+
+static uint32_t slotOffset(uint16_t slot) {
+    return (uint32_t)slot * RIDE_BLOCK_SIZE;
+}
+
+static bool readHeader(uint16_t slot, RideBlockHeader& header) {
+    if (esp_partition_read(partition, slotOffset(slot), &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    return header.magic == RIDE_LOG_MAGIC &&
+           header.version == RIDE_LOG_VERSION &&
+           header.payloadLength <= RIDE_PAYLOAD_MAX;
+}
+
+// Build the index and continue after the newest block
+static void scanSlots() {
+    uint32_t newestSeq = 0;
+    uint32_t newestSession = 0;
+    bool any = false;
+    nextSlot = 0;
+
+    for (uint16_t slot = 0; slot < slotCount; slot++) {
+        RideBlockHeader header;
+        if (!readHeader(slot, header)) {
+            slotSeqs[slot] = SLOT_EMPTY;
+            continue;
+        }
+        slotSeqs[slot] = header.seq;
+        if (!any || header.seq > newestSeq) {
+            newestSeq = header.seq;
+            newestSession = header.sessionId;
+            nextSlot = (slot + 1) % slotCount;
+            any = true;
+        }
+    }
+    nextSeq = any ? newestSeq + 1 : 1;
+    sessionId = newestSession;  // The first session of this boot is the next id
+}
+
+static bool eraseSlot(uint16_t slot) {
+    slotSeqs[slot] = SLOT_EMPTY;
+    uint32_t start = traceNow();
+    bool ok = esp_partition_erase_range(partition, slotOffset(slot), RIDE_BLOCK_SIZE) == ESP_OK;
+    traceRecord(TRACE_RIDE_ERASE, start);
+    return ok;
+}
+
+static bool writeChunked(uint32_t offset, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t n = len < FLASH_WRITE_CHUNK ? len : FLASH_WRITE_CHUNK;
+        uint32_t start = traceNow();
+        esp_err_t err = esp_partition_write(partition, offset, data, n);
+        traceRecord(TRACE_RIDE_WRITE, start);
+        if (err != ESP_OK) {
+            return false;
+        }
+        offset += n;
+        data += n;
+        len -= n;
+        taskYIELD();
+    }
+    return true;
+}
+
+// ============================================
+// WRITER TASK
+// ============================================
+
+// Write a sealed block into nextSlot (already erased)
+static bool writeBlock(uint8_t block) {
+    RideBlockHeader& h = headerOf(block);
+    const uint8_t* payload = blocks[block] + sizeof(RideBlockHeader);
+    uint32_t base = slotOffset(nextSlot);
+
+    if (!writeChunked(base + sizeof(RideBlockHeader), payload, h.payloadLength)) return false;
+
+    h.magic = RIDE_LOG_MAGIC;
+    h.seq = nextSeq;
+    h.dataCrc = rideCrc32(payload, h.payloadLength);
+    h.version = RIDE_LOG_VERSION;
+
+    // Header last: it is what marks the block as complete
+    if (!writeChunked(base, (const uint8_t*)&h, sizeof(h))) {
+        return false;
+    }
+    slotSeqs[nextSlot] = nextSeq;
+    nextSeq++;
+    nextSlot = (nextSlot + 1) % slotCount;
+    return true;
+}
+
+// Seal the partial block of the session being ended, so it reaches flash
+static void endSession() {
+    while (recorderBusy.exchange(true, std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    sealActive();
+    sessionOpen = false;
+    recorderBusy.store(false, std::memory_order_release);
+}
+
+// Flash work stalls every task running from flash, sensing included, so
+// it waits out a brake light or crash alert - unless the RAM ring is
+// down to its last free block, when waiting would mean dropping samples
+static bool deferFlash() {
+    HelmetState state = stateGet();
+    if (state != STATE_BRAKING && state != STATE_CRASH_ALERT) return false;
+
+    uint8_t full = 0;
+    for (uint8_t i = 0; i < RIDELOG_RAM_BLOCKS; i++) {
+        if (blockFull[i].load(std::memory_order_acquire)) full++;
+    }
+    return full < RIDELOG_RAM_BLOCKS - 1;
+}
+
+static void writerTask(void* param) {
+    // Keep the next slot erased so a block only has to program pages
+    // (this erases the oldest block one block ahead of overwriting it)
+    bool nextErased = eraseSlot(nextSlot);
+    uint8_t writeNext = 0;
+
+    while (true) {
+        // Poll while deferred, so the backlog goes out once the state ends
+        bool backlog = blockFull[writeNext].load(std::memory_order_acquire) || !nextErased ||
+                       eraseRequested.load();
+        ulTaskNotifyTake(pdTRUE, backlog ? pdMS_TO_TICKS(RIDELOG_DEFER_POLL_MS) : portMAX_DELAY);
+
+        if (sessionEndRequested.exchange(false)) {
+            endSession();
+        }
+        if (deferFlash()) continue;
+
+        // Everything sealed meanwhile goes out in one batch
+        while (blockFull[writeNext].load(std::memory_order_acquire)) {
+            if (!nextErased || !writeBlock(writeNext)) {
+                LOG_E("Ride log: flash write failed");
+            }
+            blockFull[writeNext].store(false, std::memory_order_release);
+            writeNext = (writeNext + 1) % RIDELOG_RAM_BLOCKS;
+            nextErased = false;
+            if (deferFlash()) break;
+            nextErased = eraseSlot(nextSlot);
+        }
+
+        if (!nextErased && !deferFlash()) {
+            nextErased = eraseSlot(nextSlot);
+        }
+
+        if (eraseRequested.exchange(false)) {
+            for (uint16_t slot = 0; slot < slotCount; slot++) {
+                eraseSlot(slot);
+                taskYIELD();
+            }
+            nextSlot = 0;
+            nextErased = true;
+            LOG_I("Ride log: erased");
+        }
+    }
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+bool rideLogBegin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         ESP_PARTITION_SUBTYPE_ANY,
+                                         RIDELOG_PARTITION_LABEL);
+    if (partition == nullptr) {
+        Serial.println("Ride log: no partition, recording disabled");
+        return false;
+    }
+
+    slotCount = partition->size / RIDE_BLOCK_SIZE;
+    if (slotCount > RIDELOG_MAX_SLOTS) slotCount = RIDELOG_MAX_SLOTS;
+    if (slotCount < 2) {
+        Serial.println("Ride log: partition too small");
+        partition = nullptr;
+        return false;
+    }
+    scanSlots();
+
+    if (xTaskCreate(writerTask, "ridelog", TASK_STACK_RIDELOG, nullptr,
+                    TASK_PRIORITY_RIDELOG, &writerTaskHandle) != pdPASS) {
+        partition = nullptr;
+        return false;
+    }
+
+    Serial.print("Ride log: ");
+    Serial.print(slotCount);
+    Serial.print(" blocks, next session ");
+    Serial.println(sessionId + 1);
+    return true;
+}
+
+void rideLogRecord(const ImuSample& sample) {
+    if (writerTaskHandle == nullptr) return;
+
+    if (recorderBusy.exchange(true, std::memory_order_acquire)) {
+        droppedSamples.fetch_add(1, std::memory_order_relaxed);
+        return;  // A session is being ended; the gap shows in the indices
+    }
+    record(sample);
+    recorderBusy.store(false, std::memory_order_release);
+}
+
+void rideLogNewSession() {
+    if (writerTaskHandle == nullptr) return;
+    sessionEndRequested = true;
+    xTaskNotifyGive(writerTaskHandle);
+}
+
+uint16_t rideLogSessions(RideSession* sessions, uint16_t maxSessions) {
+    if (partition == nullptr) return 0;
+
+    // Oldest first = walk the circle from the write position; blocks of
+    // one session are contiguous
+    uint16_t found = 0;
+    for (uint16_t i = 0; i < slotCount; i++) {
+        uint16_t slot = (nextSlot + i) % slotCount;
+        if (slotSeqs[slot] == SLOT_EMPTY) continue;
+
+        RideBlockHeader header;
+        if (!readHeader(slot, header)) continue;
+
+        if (found > 0 && sessions[found - 1].sessionId == header.sessionId) {
+            sessions[found - 1].lastSeq = header.seq;
+            sessions[found - 1].sampleCount += header.sampleCount;
+            continue;
+        }
+        if (found == maxSessions) break;
+        sessions[found++] = { header.sessionId, header.seq, header.seq, header.sampleCount };
+    }
+    return found;
+}
+
+bool rideLogRange(uint32_t& oldestSeq, uint32_t& newestSeq) {
+    if (partition == nullptr) return false;
+
+    bool any = false;
+    for (uint16_t slot = 0; slot < slotCount; slot++) {
+        uint32_t seq = slotSeqs[slot];
+        if (seq == SLOT_EMPTY) continue;
+        if (!any || seq < oldestSeq) oldestSeq = seq;
+        if (!any || seq > newestSeq) newestSeq = seq;
+        any = true;
+    }
+    return any;
+}
+
+size_t rideLogRead(uint32_t seq, uint32_t offset, uint8_t* out, size_t len) {
+    if (partition == nullptr || seq == SLOT_EMPTY) return 0;
+
+    for (uint16_t slot = 0; slot < slotCount; slot++) {
+        if (slotSeqs[slot] != seq) continue;
+
+        RideBlockHeader header;
+        if (!readHeader(slot, header) || header.seq != seq) return 0;
+
+        uint32_t length = rideBlockLength(header);
+        if (offset >= length) return 0;
+        if (len > length - offset) len = length - offset;
+
+        if (esp_partition_read(partition, slotOffset(slot) + offset, out, len) != ESP_OK) {
+            return 0;
+        }
+        return len;
+    }
+    return 0;
+}
+
+void rideLogEraseAll() {
+    if (writerTaskHandle == nullptr) return;
+    eraseRequested = true;
+    xTaskNotifyGive(writerTaskHandle);
+}
+
+uint32_t rideLogDropped() {
+    return droppedSamples.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,272 @@
+/*
+ * IMU sampling engine
+ *
+ * FIFO mode: the MPU6500 paces itself via its sample-rate divider and
+ * pushes every sample into its on-chip FIFO. The INT pin pulses once per
+ * sample; the ISR counts pulses and wakes the sampling task every
+ * IMU_FIFO_WATERMARK samples, which then drains the FIFO in one batch.
+ * LED updates, BLE work or delays in loop() can no longer cost samples -
+ * the FIFO absorbs up to 36 samples of latency.
+ *
+ * Timestamps come from the ISR: each data-ready edge is counted, and the
+ * i-th sample in the FIFO belongs to the i-th edge. Samples are stamped
+ * relative to the most recent edge, so batching adds no timing error.
+ *
+ * Low-power mode swaps the FIFO for the MPU's wake-on-motion interrupt on
+ * the same pin. Only this task talks to the IMU, so entering and leaving
+ * it is done here: motion restores the FIFO without a round trip through
+ * another task.
+ */
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "config.h"
+#include "sampling.h"
+#include "spsc_queue.h"
+
+// Largest whole number of packets the FIFO can hold
+#define FIFO_MAX_PACKETS (MPU6500_FIFO_SIZE / MPU6500_DATA_BLOCK_LEN)
+
+static SpscQueue<ImuSample, IMU_QUEUE_LENGTH> sampleQueue;
+static TaskHandle_t samplingTaskHandle = nullptr;
+static TaskHandle_t consumerTaskHandle = nullptr;
+static SamplingStats stats = {0};
+
+static std::atomic<bool> lowPowerRequested{false};
+static std::atomic<bool> lowPower{false};
+static SamplingWakeFn wakeCallback = nullptr;
+
+// Actual rate after divider rounding
+static uint32_t samplePeriodUs = 1000000UL / IMU_SAMPLE_RATE_HZ;
+
+#if IMU_USE_FIFO
+
+// ============================================
+// DATA-READY INTERRUPT
+// ============================================
+
+static portMUX_TYPE drdyMux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t drdyCount = 0;    // Data-ready edges seen
+static volatile uint32_t lastDrdyUs = 0;   // Time of the latest edge
+static volatile uint8_t pendingSamples = 0;
+static volatile bool wakeOnMotion = false;  // INT is the motion interrupt
+
+static void IRAM_ATTR onDataReady() {
+    uint32_t now = micros();
+
+    portENTER_CRITICAL_ISR(&drdyMux);
+    lastDrdyUs = now;
+    drdyCount++;
+    portEXIT_CRITICAL_ISR(&drdyMux);
+
+    if (wakeOnMotion || ++pendingSamples >= IMU_FIFO_WATERMARK) {
+        pendingSamples = 0;
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(samplingTaskHandle, &woken);
+        if (woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+static void snapshotDataReady(uint32_t& edge, uint32_t& edgeUs) {
+    portENTER_CRITICAL(&drdyMux);
+    edge = drdyCount;
+    edgeUs = lastDrdyUs;
+    portEXIT_CRITICAL(&drdyMux);
+}
+
+#endif // IMU_USE_FIFO
+
+// ============================================
+// SAMPLING TASK
+// ============================================
+
+static void publish(const ImuSample& sample) {
+    if (sampleQueue.push(sample)) {
+        stats.samples++;
+    } else {
+        stats.queueDrops++;
+    }
+}
+
+static void notifyConsumer() {
+    if (consumerTaskHandle != nullptr) {
+        xTaskNotifyGive(consumerTaskHandle);
+    }
+}
+
+#if IMU_USE_FIFO
+
+// Reset the FIFO and return the sequence number of the next sample it will hold
+static uint32_t restartFifo() {
+    uint32_t edge, edgeUs;
+    mpuResetFifo();
+    snapshotDataReady(edge, edgeUs);
+    return edge + 1;
+}
+
+// Park the IMU until it reports motion, then return to FIFO sampling
+static void waitForMotion() {
+    // A missed edge (or a masked pin in light sleep) is caught by polling
+    const TickType_t poll = pdMS_TO_TICKS(1000);
+
+    mpuEnableWakeOnMotion(POWER_WAKE_THRESHOLD_MG, POWER_WAKE_ODR);
+    wakeOnMotion = true;
+    lowPower = true;
+
+    do {
+        ulTaskNotifyTake(pdTRUE, poll);
+    } while (!(mpuReadIntStatus() & MPU6500_INT_WOM));
+
+    mpuDisableWakeOnMotion();
+    wakeOnMotion = false;
+    pendingSamples = 0;
+    mpuConfigureFifo(IMU_SAMPLE_RATE_HZ);
+    lowPower = false;
+
+    if (wakeCallback != nullptr) {
+        wakeCallback();
+    }
+}
+
+static void fifoSamplingTask(void* param) {
+    static ImuRawSample batch[FIFO_MAX_PACKETS];
+    const TickType_t timeout = pdMS_TO_TICKS(2 * IMU_FIFO_WATERMARK * 1000 / IMU_SAMPLE_RATE_HZ + 1);
+
+    uint32_t nextSequence = restartFifo();
+
+    while (true) {
+        // Woken at the watermark; the timeout covers a missed edge
+        ulTaskNotifyTake(pdTRUE, timeout);
+
+        if (lowPowerRequested.exchange(false)) {
+            waitForMotion();
+            nextSequence = restartFifo();
+            continue;
+        }
+
+        uint32_t edge, edgeUs;
+        snapshotDataReady(edge, edgeUs);
+
+        int bytes = mpuReadFifoCount();
+        if (bytes < 0) {
+            stats.readErrors++;
+            continue;
+        }
+
+        // Overwritten or misaligned FIFO: drop it and resync
+        if (bytes > FIFO_MAX_PACKETS * MPU6500_DATA_BLOCK_LEN ||
+            bytes % MPU6500_DATA_BLOCK_LEN != 0) {
+            stats.fifoOverflows++;
+            nextSequence = restartFifo();
+            continue;
+        }
+
+        uint16_t count = bytes / MPU6500_DATA_BLOCK_LEN;
+        if (count == 0) continue;
+
+        uint16_t read = mpuReadFifo(batch, count);
+        if (read < count) {
+            // Partial burst leaves the FIFO misaligned
+            stats.readErrors++;
+            nextSequence = restartFifo();
+            continue;
+        }
+
+        for (uint16_t i = 0; i < count; i++) {
+            ImuSample sample;
+            sample.sequence = nextSequence++;
+            sample.timestampUs = edgeUs + (int32_t)(sample.sequence - edge) * (int32_t)samplePeriodUs;
+            sample.raw = batch[i];
+            publish(sample);
+        }
+        notifyConsumer();
+    }
+}
+
+#else
+
+static void pollingSamplingTask(void* param) {
+    TickType_t lastWake = xTaskGetTickCount();
+    const TickType_t period = pdMS_TO_TICKS(1000 / IMU_SAMPLE_RATE_HZ);
+    uint32_t sequence = 0;
+
+    while (true) {
+        vTaskDelayUntil(&lastWake, period > 0 ? period : 1);
+
+        ImuSample sample;
+        sample.timestampUs = micros();
+        sample.sequence = ++sequence;
+        if (!mpuReadSample(sample.raw)) {
+            stats.readErrors++;
+            continue;
+        }
+        publish(sample);
+        notifyConsumer();
+    }
+}
+
+#endif // IMU_USE_FIFO
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+bool samplingBegin(TaskHandle_t consumer) {
+    consumerTaskHandle = consumer;
+
+    uint16_t div = MPU6500_INTERNAL_RATE_HZ / IMU_SAMPLE_RATE_HZ;
+    samplePeriodUs = 1000UL * (div > 0 ? div : 1);
+
+#if IMU_USE_FIFO
+    mpuConfigureFifo(IMU_SAMPLE_RATE_HZ);
+
+    if (xTaskCreate(fifoSamplingTask, "sampling", TASK_STACK_SAMPLING, nullptr,
+                    TASK_PRIORITY_SAMPLING, &samplingTaskHandle) != pdPASS) {
+        return false;
+    }
+
+    pinMode(PIN_MPU_INT, INPUT);
+    attachInterrupt(digitalPinToInterrupt(PIN_MPU_INT), onDataReady, RISING);
+#else
+    if (xTaskCreate(pollingSamplingTask, "sampling", TASK_STACK_SAMPLING, nullptr,
+                    TASK_PRIORITY_SAMPLING, &samplingTaskHandle) != pdPASS) {
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+bool samplingRead(ImuSample& sample) {
+    return sampleQueue.pop(sample);
+}
+
+SamplingStats samplingGetStats() {
+    return stats;
+}
+
+bool samplingEnterLowPower(SamplingWakeFn onMotion) {
+#if IMU_USE_FIFO
+    if (samplingTaskHandle == nullptr) return false;
+    wakeCallback = onMotion;
+    lowPowerRequested = true;
+    xTaskNotifyGive(samplingTaskHandle);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool samplingIsLowPower() {
+    return lowPower;
+}
+
+void samplingWake() {
+    if (lowPower && samplingTaskHandle != nullptr) {
+        xTaskNotifyGive(samplingTaskHandle);
+    }
+}
@@ -0,0 +1,159 @@
+/*
+ * Runtime settings - one table describes every setting's id, type,
+ * place in Settings and valid range, so set / read / encode need no
+ * per-setting code
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include "config.h"
+#include "settings.h"
+
+enum SettingType : uint8_t {
+    TYPE_U8,
+    TYPE_U16,
+    TYPE_U32,
+    TYPE_F32
+};
+
+struct SettingInfo {
+    uint8_t id;
+    SettingType type;
+    uint8_t offset;   // offsetof(Settings, field)
+    float min;
+    float max;
+};
+
+static const SettingInfo SETTINGS[] = {
+    { SETTING_BRAKE_G,            TYPE_F32, offsetof(Settings, brakeG),              0.1f,    2.0f },
+    { SETTING_CRASH_G,            TYPE_F32, offsetof(Settings, crashG),              2.0f,    CRASH_SEVERE_G },
+    { SETTING_CRASH_CONFIRMATION, TYPE_U32, offsetof(Settings, crashConfirmationMs), 5000,    300000 },
+    { SETTING_BRAKE_FLASH,        TYPE_U16, offsetof(Settings, brakeFlashMs),        200,     10000 },
+    { SETTING_ANIMATION_SPEED,    TYPE_U16, offsetof(Settings, animationSpeedMs),    5,       1000 },
+    { SETTING_TURN_SIGNAL_SPEED,  TYPE_U16, offsetof(Settings, turnSignalSpeedMs),   20,      1000 },
+    { SETTING_LED_BRIGHTNESS,     TYPE_U8,  offsetof(Settings, ledBrightness),       LED_BRIGHTNESS_MIN, 255 },
+    { SETTING_AVERAGE_SAMPLES,    TYPE_U8,  offsetof(Settings, averageSamples),      4,       SENSOR_SAMPLE_SIZE },
+};
+
+#define SETTING_COUNT (sizeof(SETTINGS) / sizeof(SETTINGS[0]))
+
+static_assert(1 + SETTING_COUNT * (2 + SETTING_MAX_LEN) <= SETTINGS_ENCODED_MAX,
+              "SETTINGS_ENCODED_MAX too small");
+static_assert(SENSOR_SAMPLE_SIZE <= 255, "averageSamples is a u8");
+
+static const size_t TYPE_SIZES[] = { 1, 2, 4, 4 };
+
+static const Settings DEFAULTS = {
+    BRAKE_G_THRESHOLD,
+    CRASH_G_THRESHOLD,
+    CRASH_CONFIRMATION_MS,
+    BRAKE_FLASH_DURATION,
+    DEFAULT_ANIMATION_SPEED,
+    TURN_SIGNAL_SPEED,
+    LED_BRIGHTNESS,
+    SENSOR_SAMPLE_SIZE
+};
+
+// The published snapshot and the one the next publish writes
+static Settings slots[2] = { DEFAULTS, DEFAULTS };
+static std::atomic<uint8_t> activeSlot{0};
+static std::atomic<uint32_t> generation{0};
+
+static const SettingInfo* find(uint8_t id) {
+    for (size_t i = 0; i < SETTING_COUNT; i++) {
+        if (SETTINGS[i].id == id) return &SETTINGS[i];
+    }
+    return nullptr;
+}
+
+const Settings& settingsGet() {
+    return slots[activeSlot.load(std::memory_order_acquire)];
+}
+
+const Settings& settingsDefaults() {
+    return DEFAULTS;
+}
+
+SettingStatus settingsSet(Settings& draft, uint8_t id, const uint8_t* value, size_t len) {
+    const SettingInfo* info = find(id);
+    if (info == nullptr) return SETTING_UNKNOWN;
+    if (len != TYPE_SIZES[info->type]) return SETTING_BAD_LENGTH;
+
+    uint32_t raw = 0;
+    for (size_t i = 0; i < len; i++) {
+        raw |= (uint32_t)value[i] << (8 * i);
+    }
+
+    float asFloat;
+    if (info->type == TYPE_F32) {
+        memcpy(&asFloat, &raw, 4);
+        // NaN fails both comparisons, so test for being inside the range
+        if (!(asFloat >= info->min && asFloat <= info->max)) return SETTING_OUT_OF_RANGE;
+    } else {
+        asFloat = (float)raw;
+        if (asFloat < info->min || asFloat > info->max) return SETTING_OUT_OF_RANGE;
+    }
+
+    uint8_t* field = (uint8_t*)&draft + info->offset;
+    switch (info->type) {
+        case TYPE_U8:  *(uint8_t*)field = (uint8_t)raw; break;
+        case TYPE_U16: *(uint16_t*)field = (uint16_t)raw; break;
+        case TYPE_U32: *(uint32_t*)field = raw; break;
+        case TYPE_F32: *(float*)field = asFloat; break;
+    }
+    return SETTING_OK;
+}
+
+size_t settingsRead(const Settings& from, uint8_t id, uint8_t* out) {
+    const SettingInfo* info = find(id);
+    if (info == nullptr) return 0;
+
+    size_t len = TYPE_SIZES[info->type];
+    uint32_t raw = 0;
+    memcpy(&raw, (const uint8_t*)&from + info->offset, len);
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (uint8_t)(raw >> (8 * i));
+    }
+    return len;
+}
+
+void settingsPublish(const Settings& draft) {
+    uint8_t next = activeSlot.load(std::memory_order_relaxed) ^ 1;
+    slots[next] = draft;
+    activeSlot.store(next, std::memory_order_release);
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t settingsGeneration() {
+    return generation.load(std::memory_order_acquire);
+}
+
+size_t settingsEncode(const Settings& from, uint8_t* out) {
+    size_t len = 0;
+    out[len++] = SETTINGS_SCHEMA_VERSION;
+    for (size_t i = 0; i < SETTING_COUNT; i++) {
+        out[len] = SETTINGS[i].id;
+        out[len + 1] = (uint8_t)settingsRead(from, SETTINGS[i].id, &out[len + 2]);
+        len += 2 + out[len + 1];
+    }
+    return len;
+}
+
+bool settingsDecode(const uint8_t* data, size_t len, Settings& out) {
+    out = DEFAULTS;
+    if (len < 1 || data[0] != SETTINGS_SCHEMA_VERSION) return false;
+
+    size_t pos = 1;
+    while (pos + 2 <= len) {
+        uint8_t id = data[pos];
+        size_t size = data[pos + 1];
+        pos += 2;
+        if (pos + size > len) break;
+
+        // Unknown id, wrong size or out of range: the default stays
+        settingsSet(out, id, &data[pos], size);
+        pos += size;
+    }
+    return true;
+}
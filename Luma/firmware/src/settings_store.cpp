@@ -0,0 +1,61 @@
+/*
+ * Runtime settings - NVS load / save (firmware only)
+ *
+ * All settings are one blob under one key, so boot costs a single NVS
+ * read however many settings there are.
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "log.h"
+#include "settings.h"
+
+// Telemetry task only
+static uint32_t savedGeneration = 0;
+static uint32_t seenGeneration = 0;
+static uint32_t changedMs = 0;
+
+void settingsBegin() {
+    uint8_t stored[SETTINGS_ENCODED_MAX];
+    size_t len = 0;
+
+    Preferences prefs;
+    if (prefs.begin(SETTINGS_NVS_NAMESPACE, true)) {
+        len = prefs.getBytes("v", stored, sizeof(stored));
+        prefs.end();
+    }
+
+    Settings settings;
+    bool found = len > 0 && settingsDecode(stored, len, settings);
+    if (!found) settings = settingsDefaults();
+    settingsPublish(settings);
+    savedGeneration = seenGeneration = settingsGeneration();
+
+    Serial.println(found ? "Settings: stored" :
+                   len > 0 ? "Settings: other schema version, defaults" : "Settings: defaults");
+}
+
+void settingsService() {
+    uint32_t generation = settingsGeneration();
+    if (generation != seenGeneration) {
+        seenGeneration = generation;
+        changedMs = millis();
+        return;
+    }
+    if (generation == savedGeneration || millis() - changedMs < SETTINGS_SAVE_DELAY_MS) return;
+
+    uint8_t encoded[SETTINGS_ENCODED_MAX];
+    size_t len = settingsEncode(settingsGet(), encoded);
+
+    Preferences prefs;
+    if (!prefs.begin(SETTINGS_NVS_NAMESPACE, false)) {
+        LOG_E("Settings: NVS unavailable, not saved");
+        savedGeneration = generation;  // Retried on the next change
+        return;
+    }
+    prefs.putBytes("v", encoded, len);
+    prefs.end();
+    savedGeneration = generation;
+    LOG_I("Settings: saved");
+}
@@ -0,0 +1,85 @@
+/*
+ * Speed fusion - Kalman filter on speed and forward accel bias
+ *
+ * State x = [v, b], input u = forward accel (m/s²):
+ *   v' = v + (u - b) dt,  b' = b
+ * measured z = v (the phone's speed). With a scalar measurement the
+ * update needs no matrix inverse, so the whole filter is written out.
+ */
+
+#include "config.h"
+#include "speed_fusion.h"
+
+#define STANDARD_GRAVITY 9.80665f
+
+bool speedParseFix(const uint8_t* data, size_t len, SpeedFix& fix) {
+    if (len < SPEED_FIX_LEN) return false;
+
+    uint16_t speed = data[0] | (data[1] << 8);
+    uint16_t course = data[2] | (data[3] << 8);
+    fix.speedMps = speed * 0.01f;
+    fix.courseDeg = course == 0xFFFF ? -1.0f : course * 0.01f;
+    fix.accuracyMps = data[4] * 0.1f;
+    return true;
+}
+
+SpeedFilter::SpeedFilter() {
+    reset();
+}
+
+void SpeedFilter::reset() {
+    v = 0.0f;
+    b = 0.0f;
+    p00 = p01 = p11 = 0.0f;
+    sinceFixS = 0.0f;
+    hasFix = false;
+}
+
+void SpeedFilter::predict(float forwardG, float dt) {
+    if (!hasFix) return;
+    sinceFixS += dt;
+
+    v += (forwardG * STANDARD_GRAVITY - b) * dt;
+    if (v < 0.0f) v = 0.0f;
+
+    // P = F P F' + Q, F = [1 -dt; 0 1]
+    p00 += dt * (dt * p11 - 2.0f * p01) + SPEED_ACCEL_NOISE * dt;
+    p01 -= dt * p11;
+    p11 += SPEED_BIAS_NOISE * dt;
+}
+
+void SpeedFilter::correct(const SpeedFix& fix) {
+    float sigma = fix.accuracyMps > 0.0f ? fix.accuracyMps : SPEED_DEFAULT_ACCURACY;
+    if (sigma < SPEED_MIN_ACCURACY) sigma = SPEED_MIN_ACCURACY;
+    float r = sigma * sigma;
+
+    // First fix, or the last one is too old to build on: start from it
+    if (!valid()) {
+        v = fix.speedMps;
+        b = 0.0f;
+        p00 = r;
+        p01 = 0.0f;
+        p11 = SPEED_ACCEL_NOISE;
+        sinceFixS = 0.0f;
+        hasFix = true;
+        return;
+    }
+
+    float s = p00 + r;
+    float k0 = p00 / s;
+    float k1 = p01 / s;
+    float innovation = fix.speedMps - v;
+
+    v += k0 * innovation;
+    b += k1 * innovation;
+    if (v < 0.0f) v = 0.0f;
+
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+    sinceFixS = 0.0f;
+}
+
+float SpeedFilter::biasG() const {
+    return valid() ? b / STANDARD_GRAVITY : 0.0f;
+}
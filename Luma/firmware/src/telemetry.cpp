@@ -0,0 +1,90 @@
+/*
+ * Batched telemetry frame packing (see telemetry.h for the wire format)
+ */
+
+#include <string.h>
+#include "telemetry.h"
+
+static void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+TelemetryPacker::TelemetryPacker()
+    : payloadLimit(20),  // Default ATT MTU (23) - 3
+      sampleCount(0),
+      flags(0),
+      frameSequence(0),
+      firstTimestamp(0),
+      lastTimestamp(0),
+      finished(false) {
+    startFrame();
+}
+
+void TelemetryPacker::setMaxPayload(size_t bytes) {
+    if (bytes > TELEMETRY_MAX_PAYLOAD) bytes = TELEMETRY_MAX_PAYLOAD;
+    if (bytes < TELEMETRY_HEADER_LEN + TELEMETRY_SAMPLE_LEN) {
+        bytes = TELEMETRY_HEADER_LEN + TELEMETRY_SAMPLE_LEN;
+    }
+    payloadLimit = bytes;
+}
+
+void TelemetryPacker::startFrame() {
+    length = TELEMETRY_HEADER_LEN;
+    sampleCount = 0;
+    finished = false;
+}
+
+bool TelemetryPacker::append(const ImuSample& sample) {
+    if (finished) {
+        startFrame();
+    }
+
+    uint32_t dt = 0;
+    if (sampleCount > 0) {
+        dt = sample.timestampUs - lastTimestamp;
+        if (dt > 0xFFFF || full() || sampleCount == 0xFF) {
+            return false;
+        }
+    } else {
+        firstTimestamp = sample.timestampUs;
+    }
+
+    uint8_t* p = &buffer[length];
+    putU16(p, (uint16_t)dt);
+    putU16(p + 2, (uint16_t)sample.raw.accelX);
+    putU16(p + 4, (uint16_t)sample.raw.accelY);
+    putU16(p + 6, (uint16_t)sample.raw.accelZ);
+    putU16(p + 8, (uint16_t)sample.raw.gyroX);
+    putU16(p + 10, (uint16_t)sample.raw.gyroY);
+    putU16(p + 12, (uint16_t)sample.raw.gyroZ);
+
+    length += TELEMETRY_SAMPLE_LEN;
+    sampleCount++;
+    lastTimestamp = sample.timestampUs;
+    return true;
+}
+
+size_t TelemetryPacker::finish(uint8_t state) {
+    if (empty()) {
+        return 0;
+    }
+
+    buffer[0] = TELEMETRY_PROTOCOL_VERSION;
+    buffer[1] = flags;
+    putU16(&buffer[2], frameSequence++);
+    putU32(&buffer[4], firstTimestamp);
+    buffer[8] = state;
+    buffer[9] = sampleCount;
+
+    flags = 0;
+    finished = true;
+    return length;
+}
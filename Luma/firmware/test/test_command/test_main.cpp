@@ -0,0 +1,167 @@
+/*
+ * Command protocol: TLV parsing, execution and the ack split into
+ * MTU-sized indications
+ *
+ *   pio test -e native -f test_command
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "command.h"
+#include "helmet_state.h"
+#include "settings.h"
+
+void setUp() {
+    settingsPublish(settingsDefaults());
+    stateDispatch(EVENT_NORMAL_MODE);
+}
+
+void tearDown() {}
+
+static void test_legacy_byte() {
+    const uint8_t write[] = { CMD_PARTY_MODE };
+    CommandFrame frame;
+    TEST_ASSERT_TRUE(commandParse(write, sizeof(write), frame));
+    TEST_ASSERT_FALSE(frame.framed);
+    TEST_ASSERT_EQUAL_UINT8(1, frame.count);
+    TEST_ASSERT_EQUAL_UINT8(CMD_PARTY_MODE, frame.commands[0].type);
+
+    uint8_t ack[CMD_ACK_MAX];
+    TEST_ASSERT_EQUAL_UINT32(0, commandExecute(frame, ack));
+    TEST_ASSERT_EQUAL_INT(STATE_PARTY, stateGet());
+}
+
+static void test_framed_commands_in_order() {
+    const uint8_t write[] = { CMD_FRAME_MAGIC, 9,
+                              CMD_TURN_LEFT_ON, 0,
+                              CMD_GET_SETTING, 1, SETTING_LED_BRIGHTNESS };
+    CommandFrame frame;
+    TEST_ASSERT_TRUE(commandParse(write, sizeof(write), frame));
+    TEST_ASSERT_TRUE(frame.framed);
+    TEST_ASSERT_EQUAL_UINT8(9, frame.seq);
+    TEST_ASSERT_EQUAL_UINT8(2, frame.count);
+
+    uint8_t ack[CMD_ACK_MAX];
+    size_t len = commandExecute(frame, ack);
+    const uint8_t expected[] = { CMD_FRAME_MAGIC, 9,
+                                 CMD_TURN_LEFT_ON, CMD_STATUS_OK, 0,
+                                 CMD_GET_SETTING, CMD_STATUS_OK, 2, SETTING_LED_BRIGHTNESS, LED_BRIGHTNESS };
+    TEST_ASSERT_EQUAL_UINT32(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, ack, sizeof(expected));
+    TEST_ASSERT_EQUAL_INT(STATE_TURN_LEFT, stateGet());
+}
+
+static void test_malformed_tlvs() {
+    // A value longer than any command, then one running past the write
+    const uint8_t write[] = { CMD_FRAME_MAGIC, 1,
+                              CMD_SET_SETTING, CMD_MAX_VALUE + 1, 0, 0, 0, 0, 0, 0,
+                              CMD_SET_SETTING, 4, SETTING_BRAKE_G };
+    CommandFrame frame;
+    TEST_ASSERT_TRUE(commandParse(write, sizeof(write), frame));
+    TEST_ASSERT_EQUAL_UINT8(2, frame.count);
+    TEST_ASSERT_EQUAL_UINT8(CMD_LEN_MALFORMED, frame.commands[0].len);
+    TEST_ASSERT_EQUAL_UINT8(CMD_LEN_MALFORMED, frame.commands[1].len);
+
+    uint8_t ack[CMD_ACK_MAX];
+    commandExecute(frame, ack);
+    TEST_ASSERT_EQUAL_UINT8(CMD_STATUS_BAD_LENGTH, ack[3]);
+    TEST_ASSERT_EQUAL_UINT8(CMD_STATUS_BAD_LENGTH, ack[6]);
+}
+
+static void test_not_a_frame() {
+    const uint8_t write[] = { 0x42, 0x00, 0x01 };
+    CommandFrame frame;
+    TEST_ASSERT_FALSE(commandParse(write, sizeof(write), frame));
+}
+
+static void test_frame_changes_settings_together() {
+    uint8_t write[2 + 2 * 7];
+    size_t len = 0;
+    write[len++] = CMD_FRAME_MAGIC;
+    write[len++] = 2;
+    const float brakeG = 0.8f;
+    write[len++] = CMD_SET_SETTING;
+    write[len++] = 5;
+    write[len++] = SETTING_BRAKE_G;
+    memcpy(&write[len], &brakeG, 4);
+    len += 4;
+    write[len++] = CMD_SET_SETTING;
+    write[len++] = 2;
+    write[len++] = SETTING_AVERAGE_SAMPLES;
+    write[len++] = 0xFF;  // Out of range: rejected, the rest still applies
+
+    CommandFrame frame;
+    commandParse(write, len, frame);
+    uint32_t generation = settingsGeneration();
+    uint8_t ack[CMD_ACK_MAX];
+    commandExecute(frame, ack);
+
+    TEST_ASSERT_EQUAL_UINT8(CMD_STATUS_OK, ack[3]);
+    TEST_ASSERT_EQUAL_UINT8(CMD_STATUS_OUT_OF_RANGE, ack[6]);
+    TEST_ASSERT_EQUAL_UINT32(generation + 1, settingsGeneration());
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, brakeG, settingsGet().brakeG);
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_SAMPLE_SIZE, settingsGet().averageSamples);
+}
+
+// Eight gets: the largest ack, split for the default MTU
+static void test_ack_split_into_indications() {
+    uint8_t write[2 + CMD_MAX_PER_FRAME * 3];
+    size_t len = 0;
+    write[len++] = CMD_FRAME_MAGIC;
+    write[len++] = 5;
+    for (int i = 0; i < CMD_MAX_PER_FRAME; i++) {
+        write[len++] = CMD_GET_SETTING;
+        write[len++] = 1;
+        write[len++] = SETTING_CRASH_CONFIRMATION;  // u32: 8-byte entries
+    }
+    CommandFrame frame;
+    commandParse(write, len, frame);
+    uint8_t ack[CMD_ACK_MAX];
+    size_t ackLen = commandExecute(frame, ack);
+    TEST_ASSERT_EQUAL_UINT32(CMD_ACK_MAX, ackLen);
+
+    // Reassemble what the app receives
+    uint8_t joined[CMD_ACK_MAX];
+    size_t joinedLen = 2;
+    size_t pos = 0;
+    int parts = 0;
+    while (pos < ackLen) {
+        uint8_t part[CMD_ACK_MAX];
+        size_t partLen = commandAckPart(ack, ackLen, pos, 20, part);
+        parts++;
+        TEST_ASSERT_LESS_OR_EQUAL(20, partLen);
+        TEST_ASSERT_EQUAL_UINT8(pos < ackLen ? CMD_ACK_CONTINUED : CMD_FRAME_MAGIC, part[0]);
+        TEST_ASSERT_EQUAL_UINT8(5, part[1]);
+        memcpy(&joined[joinedLen], &part[2], partLen - 2);
+        joinedLen += partLen - 2;
+    }
+    TEST_ASSERT_EQUAL_INT(4, parts);  // Two 8-byte entries per 20-byte part
+    TEST_ASSERT_EQUAL_UINT32(ackLen, joinedLen);
+    TEST_ASSERT_EQUAL_MEMORY(&ack[2], &joined[2], ackLen - 2);
+}
+
+static void test_short_ack_is_one_part() {
+    const uint8_t write[] = { CMD_FRAME_MAGIC, 3 };  // A ping
+    CommandFrame frame;
+    commandParse(write, sizeof(write), frame);
+    uint8_t ack[CMD_ACK_MAX];
+    size_t ackLen = commandExecute(frame, ack);
+
+    uint8_t part[CMD_ACK_MAX];
+    size_t pos = 0;
+    TEST_ASSERT_EQUAL_UINT32(2, commandAckPart(ack, ackLen, pos, 244, part));
+    TEST_ASSERT_EQUAL_UINT32(ackLen, pos);
+    TEST_ASSERT_EQUAL_UINT8(CMD_FRAME_MAGIC, part[0]);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_legacy_byte);
+    RUN_TEST(test_framed_commands_in_order);
+    RUN_TEST(test_malformed_tlvs);
+    RUN_TEST(test_not_a_frame);
+    RUN_TEST(test_frame_changes_settings_together);
+    RUN_TEST(test_ack_split_into_indications);
+    RUN_TEST(test_short_ack_is_one_part);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+/*
+ * Crash detector on synthetic 200 Hz streams, both numeric backends
+ *
+ *   pio test -e native -f test_crash_detector
+ */
+
+#include <unity.h>
+#include "config.h"
+#include "crash_detector.h"
+
+void setUp() {}
+void tearDown() {}
+
+#define MS_TO_SAMPLES(ms) ((ms) * IMU_SAMPLE_RATE_HZ / 1000)
+
+template <typename Math>
+struct Stream {
+    CrashDetector<Math> detector;
+    CrashReport report;
+    int decisions = 0;
+    int samples = 0;
+
+    // `count` samples of |a| = g and |gyro| = dps; true once decided
+    bool feed(float g, float dps, int count) {
+        for (int i = 0; i < count; i++) {
+            samples++;
+            if (detector.update(Math::fromFloat(g), dps * dps, report)) {
+                decisions++;
+            }
+        }
+        return decisions > 0;
+    }
+
+    // Ride along: |a| wobbling by 0.5 g and the head turning
+    bool ride(int count) {
+        for (int i = 0; i < count; i++) {
+            feed(i % 2 ? 1.5f : 0.6f, 100.0f, 1);
+        }
+        return decisions > 0;
+    }
+};
+
+template <typename Math>
+static void pothole_spike_is_rejected() {
+    // Still before and after, so only the energy floor can reject it
+    Stream<Math> s;
+    s.feed(1.0f, 0.0f, MS_TO_SAMPLES(1000));
+    s.feed(5.5f, 0.0f, 2);  // 10 ms at 5.5 g: below the energy floor
+    s.feed(1.0f, 0.0f, MS_TO_SAMPLES(CRASH_IMPACT_MS + CRASH_SETTLE_MS) + 10);
+
+    TEST_ASSERT_EQUAL_INT(1, s.decisions);
+    TEST_ASSERT_FALSE(s.report.crash);
+    TEST_ASSERT_TRUE(s.report.peakG > 5.0f);
+    TEST_ASSERT_TRUE(s.report.energyGs < CRASH_ENERGY_GS);
+    TEST_ASSERT_LESS_OR_EQUAL(MS_TO_SAMPLES(CRASH_IMPACT_MS), s.report.samples);
+}
+
+template <typename Math>
+static void hit_after_free_fall_is_immediate_crash() {
+    Stream<Math> s;
+    s.feed(1.0f, 0.0f, MS_TO_SAMPLES(500));
+    s.feed(0.1f, 0.0f, MS_TO_SAMPLES(CRASH_FREEFALL_MS) + 4);
+    s.feed(5.0f, 0.0f, 3);  // 15 ms at 5 g
+    int peakAt = s.samples;
+    s.ride(MS_TO_SAMPLES(CRASH_IMPACT_MS) + 10);
+
+    TEST_ASSERT_EQUAL_INT(1, s.decisions);
+    TEST_ASSERT_TRUE(s.report.crash);
+    TEST_ASSERT_TRUE(s.report.preSignature);
+    TEST_ASSERT_FALSE(s.report.still);
+    TEST_ASSERT_LESS_OR_EQUAL(MS_TO_SAMPLES(CRASH_IMPACT_MS), s.report.samples);
+    TEST_ASSERT_TRUE(s.samples - peakAt <= MS_TO_SAMPLES(CRASH_IMPACT_MS) + 10);
+}
+
+template <typename Math>
+static void hit_then_still_is_crash() {
+    Stream<Math> s;
+    s.ride(MS_TO_SAMPLES(1000));
+    s.feed(5.0f, 100.0f, 3);
+    s.feed(1.0f, 0.0f, MS_TO_SAMPLES(CRASH_IMPACT_MS + CRASH_SETTLE_MS) + 10);
+
+    TEST_ASSERT_EQUAL_INT(1, s.decisions);
+    TEST_ASSERT_TRUE(s.report.crash);
+    TEST_ASSERT_TRUE(s.report.still);
+    TEST_ASSERT_FALSE(s.report.preSignature);
+}
+
+template <typename Math>
+static void hit_while_riding_on_is_rejected() {
+    Stream<Math> s;
+    s.ride(MS_TO_SAMPLES(1000));
+    s.feed(5.0f, 100.0f, 3);
+    s.ride(MS_TO_SAMPLES(CRASH_IMPACT_MS + CRASH_SETTLE_MS) + 10);
+
+    TEST_ASSERT_EQUAL_INT(1, s.decisions);
+    TEST_ASSERT_FALSE(s.report.crash);
+    TEST_ASSERT_FALSE(s.report.still);
+}
+
+template <typename Math>
+static void severe_peak_is_crash_on_energy_alone() {
+    Stream<Math> s;
+    s.ride(MS_TO_SAMPLES(1000));
+    s.feed(CRASH_SEVERE_G + 0.3f, 100.0f, 3);
+    s.ride(MS_TO_SAMPLES(CRASH_IMPACT_MS) + 10);
+
+    TEST_ASSERT_EQUAL_INT(1, s.decisions);
+    TEST_ASSERT_TRUE(s.report.crash);
+    TEST_ASSERT_TRUE(s.report.severe);
+}
+
+static void test_pothole_float() { pothole_spike_is_rejected<FloatMath>(); }
+static void test_pothole_fixed() { pothole_spike_is_rejected<FixedMath>(); }
+static void test_free_fall_float() { hit_after_free_fall_is_immediate_crash<FloatMath>(); }
+static void test_free_fall_fixed() { hit_after_free_fall_is_immediate_crash<FixedMath>(); }
+static void test_still_float() { hit_then_still_is_crash<FloatMath>(); }
+static void test_still_fixed() { hit_then_still_is_crash<FixedMath>(); }
+static void test_riding_float() { hit_while_riding_on_is_rejected<FloatMath>(); }
+static void test_riding_fixed() { hit_while_riding_on_is_rejected<FixedMath>(); }
+static void test_severe_float() { severe_peak_is_crash_on_energy_alone<FloatMath>(); }
+static void test_severe_fixed() { severe_peak_is_crash_on_energy_alone<FixedMath>(); }
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pothole_float);
+    RUN_TEST(test_pothole_fixed);
+    RUN_TEST(test_free_fall_float);
+    RUN_TEST(test_free_fall_fixed);
+    RUN_TEST(test_still_float);
+    RUN_TEST(test_still_fixed);
+    RUN_TEST(test_riding_float);
+    RUN_TEST(test_riding_fixed);
+    RUN_TEST(test_severe_float);
+    RUN_TEST(test_severe_fixed);
+    return UNITY_END();
+}
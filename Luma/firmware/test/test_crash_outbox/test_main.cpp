@@ -0,0 +1,150 @@
+/*
+ * Crash events: payload encoding and the outbox retry/backoff
+ *
+ *   pio test -e native -f test_crash_outbox
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "config.h"
+#include "crash_event.h"
+
+void setUp() {}
+void tearDown() {}
+
+static CrashEvent eventWithId(uint16_t id, uint8_t stage = CRASH_STAGE_DETECTED) {
+    CrashEvent event = crashEventMake(id, 1000, nullptr, 0.0f, 0.0f);
+    event.stage = stage;
+    return event;
+}
+
+static void test_event_from_report() {
+    CrashReport impact{};
+    impact.peakG = 6.25f;
+    impact.energyGs = 0.125f;
+    impact.still = true;
+    impact.severe = true;
+
+    CrashEvent event = crashEventMake(7, 1000, &impact, 12.5f, -3.0f);
+    uint8_t out[CRASH_EVENT_LEN];
+    TEST_ASSERT_EQUAL_UINT32(CRASH_EVENT_LEN, crashEventEncode(event, 1250, out));
+
+    const uint8_t expected[CRASH_EVENT_LEN] = {
+        CRASH_STAGE_DETECTED, CRASH_FLAG_STILL | CRASH_FLAG_SEVERE,
+        7, 0,                   // id
+        250, 0, 0, 0,           // ageMs
+        0x71, 0x02,             // 625 x 0.01 g
+        125, 0,                 // 125 x 0.001 g·s
+        0xE2, 0x04,             // 1250 x 0.01°
+        0xD4, 0xFE              // -300 x 0.01°
+    };
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, CRASH_EVENT_LEN);
+}
+
+static void test_event_without_report() {
+    CrashEvent event = crashEventMake(1, 1000, nullptr, 0.0f, 0.0f);
+    TEST_ASSERT_EQUAL_UINT8(CRASH_FLAG_NO_REPORT, event.flags);
+    TEST_ASSERT_EQUAL_INT(0, (int)event.peakG);
+    TEST_ASSERT_EQUAL_INT(0, (int)event.energyGs);
+}
+
+static void test_confirmed_event_leaves_outbox() {
+    CrashOutbox outbox;
+    CrashEvent sent;
+    outbox.post(eventWithId(1));
+
+    TEST_ASSERT_EQUAL_UINT32(0, outbox.msUntilDue(0));
+    TEST_ASSERT_TRUE(outbox.due(0, sent));
+    TEST_ASSERT_EQUAL_UINT16(1, sent.id);
+    TEST_ASSERT_TRUE(outbox.inFlight());
+    TEST_ASSERT_FALSE(outbox.due(0, sent));  // One at a time
+
+    outbox.confirmed();
+    TEST_ASSERT_EQUAL_UINT8(0, outbox.pending());
+    TEST_ASSERT_FALSE(outbox.due(0, sent));
+}
+
+static void test_failed_indication_backs_off() {
+    CrashOutbox outbox;
+    CrashEvent sent;
+    outbox.post(eventWithId(1));
+
+    uint32_t now = 0;
+    uint32_t expected = CRASH_RETRY_BASE_MS;
+    for (int attempt = 0; attempt < 8; attempt++) {
+        TEST_ASSERT_TRUE(outbox.due(now, sent));
+        outbox.failed(now);
+        TEST_ASSERT_EQUAL_UINT32(expected, outbox.msUntilDue(now));
+        TEST_ASSERT_FALSE(outbox.due(now + expected - 1, sent));
+        now += expected;
+        expected = expected * 2 > CRASH_RETRY_MAX_MS ? CRASH_RETRY_MAX_MS : expected * 2;
+    }
+    TEST_ASSERT_TRUE(outbox.due(now, sent));
+}
+
+static void test_retry_now_skips_backoff() {
+    CrashOutbox outbox;
+    CrashEvent sent;
+    outbox.post(eventWithId(1));
+    outbox.due(0, sent);
+    outbox.failed(0);
+    TEST_ASSERT_FALSE(outbox.due(10, sent));
+
+    outbox.retryNow();
+    TEST_ASSERT_EQUAL_UINT32(0, outbox.msUntilDue(10));
+    TEST_ASSERT_TRUE(outbox.due(10, sent));
+}
+
+static void test_later_stage_replaces_queued_one() {
+    CrashOutbox outbox;
+    CrashEvent sent;
+    outbox.post(eventWithId(1));
+    outbox.post(eventWithId(1, CRASH_STAGE_CONFIRMED));
+    TEST_ASSERT_EQUAL_UINT8(1, outbox.pending());
+
+    TEST_ASSERT_TRUE(outbox.due(0, sent));
+    TEST_ASSERT_EQUAL_UINT8(CRASH_STAGE_CONFIRMED, sent.stage);
+}
+
+static void test_stage_posted_in_flight_is_sent_next() {
+    CrashOutbox outbox;
+    CrashEvent sent;
+    outbox.post(eventWithId(1));
+    outbox.due(0, sent);
+    outbox.post(eventWithId(1, CRASH_STAGE_CANCELLED));
+    outbox.confirmed();
+
+    TEST_ASSERT_EQUAL_UINT8(1, outbox.pending());
+    TEST_ASSERT_TRUE(outbox.due(0, sent));
+    TEST_ASSERT_EQUAL_UINT8(CRASH_STAGE_CANCELLED, sent.stage);
+    outbox.confirmed();
+    TEST_ASSERT_EQUAL_UINT8(0, outbox.pending());
+}
+
+static void test_full_outbox_drops_oldest_not_in_flight() {
+    CrashOutbox outbox;
+    CrashEvent sent;
+    for (uint16_t id = 1; id <= CRASH_OUTBOX_SIZE; id++) {
+        TEST_ASSERT_TRUE(outbox.post(eventWithId(id)));
+    }
+    outbox.due(0, sent);  // id 1 in flight
+    TEST_ASSERT_FALSE(outbox.post(eventWithId(CRASH_OUTBOX_SIZE + 1)));
+    TEST_ASSERT_EQUAL_UINT8(CRASH_OUTBOX_SIZE, outbox.pending());
+
+    outbox.confirmed();
+    TEST_ASSERT_TRUE(outbox.due(0, sent));
+    TEST_ASSERT_EQUAL_UINT16(3, sent.id);  // id 2 was dropped
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_event_from_report);
+    RUN_TEST(test_event_without_report);
+    RUN_TEST(test_confirmed_event_leaves_outbox);
+    RUN_TEST(test_failed_indication_backs_off);
+    RUN_TEST(test_retry_now_skips_backoff);
+    RUN_TEST(test_later_stage_replaces_queued_one);
+    RUN_TEST(test_stage_posted_in_flight_is_sent_next);
+    RUN_TEST(test_full_outbox_drops_oldest_not_in_flight);
+    return UNITY_END();
+}
@@ -0,0 +1,71 @@
+/*
+ * Helmet state machine: transitions and the entry time published with
+ * the state
+ *
+ *   pio test -e native -f test_helmet_state
+ */
+
+#include <unity.h>
+#include "helmet_state.h"
+#include "host_clock.h"
+
+void setUp() {
+    hostClockSet(0);
+    stateDispatch(EVENT_CRASH_FALSE_ALARM);  // Leaves a crash alert
+    stateDispatch(EVENT_NORMAL_MODE);
+}
+
+void tearDown() {}
+
+static void test_change_records_entry_time() {
+    hostClockSet(1000);
+    TEST_ASSERT_TRUE(stateDispatch(EVENT_BRAKE_DETECTED));
+    TEST_ASSERT_EQUAL_INT(STATE_BRAKING, stateGet());
+
+    hostClockSet(4000);
+    TEST_ASSERT_EQUAL_UINT32(1000, stateEnteredMs());
+}
+
+static void test_ignored_event_keeps_entry_time() {
+    hostClockSet(1000);
+    stateDispatch(EVENT_CRASH_DETECTED);
+    hostClockSet(2000);
+    TEST_ASSERT_FALSE(stateDispatch(EVENT_BRAKE_DETECTED));  // Only a cancel leaves it
+    TEST_ASSERT_EQUAL_INT(STATE_CRASH_ALERT, stateGet());
+    TEST_ASSERT_EQUAL_UINT32(1000, stateEnteredMs());
+}
+
+static void test_entry_time_survives_clock_wraps() {
+    // Across the packed 29-bit field and across the 32-bit millis() wrap
+    const uint32_t starts[] = { (1u << 29) - 500, 0xFFFFFFFFu - 500 };
+    for (uint32_t start : starts) {
+        hostClockSet(start);
+        stateDispatch(EVENT_TURN_LEFT_ON);
+        hostClockSet(start + 1000);
+        TEST_ASSERT_EQUAL_UINT32(start, stateEnteredMs());
+        stateDispatch(EVENT_TURN_LEFT_OFF);
+    }
+}
+
+static void test_every_state_round_trips() {
+    const HelmetEvent events[] = { EVENT_TURN_LEFT_ON, EVENT_TURN_RIGHT_ON, EVENT_PARTY_MODE,
+                                   EVENT_BRAKE_DETECTED, EVENT_CRASH_DETECTED };
+    const HelmetState states[] = { STATE_TURN_LEFT, STATE_TURN_RIGHT, STATE_PARTY,
+                                   STATE_BRAKING, STATE_CRASH_ALERT };
+    for (int i = 0; i < 5; i++) {
+        HelmetState entered;
+        stateDispatch(EVENT_NORMAL_MODE);
+        TEST_ASSERT_TRUE(stateDispatch(events[i], &entered));
+        TEST_ASSERT_EQUAL_INT(states[i], entered);
+        TEST_ASSERT_EQUAL_INT(states[i], stateGet());
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_change_records_entry_time);
+    RUN_TEST(test_ignored_event_keeps_entry_time);
+    RUN_TEST(test_entry_time_survives_clock_wraps);
+    RUN_TEST(test_every_state_round_trips);
+    return UNITY_END();
+}
@@ -0,0 +1,83 @@
+/*
+ * Ride log codec: zigzag varint deltas and the block CRC
+ *
+ *   pio test -e native -f test_ride_codec
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "ride_codec.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_small_deltas_take_one_byte_each() {
+    int16_t previous[RIDE_AXES] = {};
+    const int16_t values[RIDE_AXES] = { 0, 1, -1, 63, -64, 2 };
+    uint8_t out[RIDE_SAMPLE_MAX_BYTES];
+
+    TEST_ASSERT_EQUAL_UINT32(6, rideEncodeSample(out, values, previous));
+    const uint8_t expected[6] = { 0, 2, 1, 126, 127, 4 };
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, 6);
+    TEST_ASSERT_EQUAL_MEMORY(values, previous, sizeof(previous));
+}
+
+static void test_full_swing_fits_max_bytes() {
+    int16_t previous[RIDE_AXES] = { -32768, 32767, -32768, 32767, -32768, 32767 };
+    const int16_t values[RIDE_AXES] = { 32767, -32768, 32767, -32768, 32767, -32768 };
+    uint8_t out[RIDE_SAMPLE_MAX_BYTES];
+
+    TEST_ASSERT_EQUAL_UINT32(RIDE_SAMPLE_MAX_BYTES, rideEncodeSample(out, values, previous));
+}
+
+static void test_round_trip() {
+    int16_t encodePrev[RIDE_AXES] = {};
+    int16_t decodePrev[RIDE_AXES] = {};
+    uint8_t buffer[64 * RIDE_SAMPLE_MAX_BYTES];
+    int16_t samples[64][RIDE_AXES];
+    size_t length = 0;
+
+    uint32_t seed = 12345;
+    for (int n = 0; n < 64; n++) {
+        for (int i = 0; i < RIDE_AXES; i++) {
+            seed = seed * 1103515245UL + 12345UL;
+            samples[n][i] = (int16_t)(seed >> 16);
+        }
+        length += rideEncodeSample(buffer + length, samples[n], encodePrev);
+    }
+
+    size_t pos = 0;
+    for (int n = 0; n < 64; n++) {
+        size_t used = rideDecodeSample(buffer + pos, length - pos, decodePrev);
+        TEST_ASSERT_TRUE(used > 0);
+        TEST_ASSERT_EQUAL_MEMORY(samples[n], decodePrev, sizeof(decodePrev));
+        pos += used;
+    }
+    TEST_ASSERT_EQUAL_UINT32(length, pos);
+}
+
+static void test_truncated_sample_is_rejected() {
+    int16_t previous[RIDE_AXES] = {};
+    const int16_t values[RIDE_AXES] = { 1000, -1000, 1000, -1000, 1000, -1000 };
+    uint8_t out[RIDE_SAMPLE_MAX_BYTES];
+    size_t length = rideEncodeSample(out, values, previous);
+
+    int16_t decoded[RIDE_AXES] = {};
+    TEST_ASSERT_EQUAL_UINT32(0, rideDecodeSample(out, length - 1, decoded));
+}
+
+static void test_crc_matches_zlib() {
+    const uint8_t check[] = "123456789";
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926UL, rideCrc32(check, 9));
+    TEST_ASSERT_EQUAL_UINT32(0, rideCrc32(check, 0));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_small_deltas_take_one_byte_each);
+    RUN_TEST(test_full_swing_fits_max_bytes);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_truncated_sample_is_rejected);
+    RUN_TEST(test_crc_matches_zlib);
+    return UNITY_END();
+}
@@ -0,0 +1,125 @@
+/*
+ * Settings: validation, the published snapshot and the stored form
+ *
+ *   pio test -e native -f test_settings
+ */
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+#include "config.h"
+#include "settings.h"
+
+void setUp() {
+    settingsPublish(settingsDefaults());
+}
+
+void tearDown() {}
+
+static SettingStatus setU8(Settings& draft, uint8_t id, uint8_t value) {
+    return settingsSet(draft, id, &value, 1);
+}
+
+static SettingStatus setF32(Settings& draft, uint8_t id, float value) {
+    uint8_t bytes[4];
+    memcpy(bytes, &value, 4);
+    return settingsSet(draft, id, bytes, 4);
+}
+
+static void test_ranges() {
+    Settings draft = settingsDefaults();
+    TEST_ASSERT_EQUAL_INT(SETTING_OK, setF32(draft, SETTING_BRAKE_G, 2.0f));
+    TEST_ASSERT_EQUAL_INT(SETTING_OUT_OF_RANGE, setF32(draft, SETTING_BRAKE_G, 2.01f));
+    TEST_ASSERT_EQUAL_INT(SETTING_OUT_OF_RANGE, setF32(draft, SETTING_CRASH_G, NAN));
+    TEST_ASSERT_EQUAL_INT(SETTING_OUT_OF_RANGE, setU8(draft, SETTING_AVERAGE_SAMPLES, 3));
+    TEST_ASSERT_EQUAL_INT(SETTING_OK, setU8(draft, SETTING_AVERAGE_SAMPLES, 4));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 2.0f, draft.brakeG);
+    TEST_ASSERT_EQUAL_UINT8(4, draft.averageSamples);
+}
+
+static void test_brightness_cannot_turn_the_light_off() {
+    Settings draft = settingsDefaults();
+    TEST_ASSERT_EQUAL_INT(SETTING_OUT_OF_RANGE, setU8(draft, SETTING_LED_BRIGHTNESS, 0));
+    TEST_ASSERT_EQUAL_INT(SETTING_OUT_OF_RANGE, setU8(draft, SETTING_LED_BRIGHTNESS, LED_BRIGHTNESS_MIN - 1));
+    TEST_ASSERT_EQUAL_UINT8(LED_BRIGHTNESS, draft.ledBrightness);
+    TEST_ASSERT_EQUAL_INT(SETTING_OK, setU8(draft, SETTING_LED_BRIGHTNESS, LED_BRIGHTNESS_MIN));
+    TEST_ASSERT_EQUAL_UINT8(LED_BRIGHTNESS_MIN, draft.ledBrightness);
+}
+
+static void test_bad_length_and_unknown_id() {
+    Settings draft = settingsDefaults();
+    const uint8_t value[2] = { 100, 0 };
+    TEST_ASSERT_EQUAL_INT(SETTING_BAD_LENGTH, settingsSet(draft, SETTING_LED_BRIGHTNESS, value, 2));
+    TEST_ASSERT_EQUAL_INT(SETTING_UNKNOWN, settingsSet(draft, 0x7F, value, 1));
+    TEST_ASSERT_EQUAL_MEMORY(&settingsDefaults(), &draft, sizeof(draft));
+}
+
+static void test_publish_swaps_snapshot() {
+    Settings draft = settingsGet();
+    setU8(draft, SETTING_LED_BRIGHTNESS, 200);
+    TEST_ASSERT_EQUAL_UINT8(LED_BRIGHTNESS, settingsGet().ledBrightness);  // Only the draft so far
+
+    uint32_t generation = settingsGeneration();
+    settingsPublish(draft);
+    TEST_ASSERT_EQUAL_UINT32(generation + 1, settingsGeneration());
+    TEST_ASSERT_EQUAL_UINT8(200, settingsGet().ledBrightness);
+
+    Settings next = settingsGet();
+    setU8(next, SETTING_LED_BRIGHTNESS, 100);
+    settingsPublish(next);
+    TEST_ASSERT_EQUAL_UINT8(100, settingsGet().ledBrightness);
+    TEST_ASSERT_EQUAL_UINT8(LED_BRIGHTNESS, settingsDefaults().ledBrightness);
+}
+
+static void test_read_back() {
+    uint8_t out[SETTING_MAX_LEN];
+    TEST_ASSERT_EQUAL_UINT32(4, settingsRead(settingsDefaults(), SETTING_CRASH_CONFIRMATION, out));
+    uint32_t ms;
+    memcpy(&ms, out, 4);
+    TEST_ASSERT_EQUAL_UINT32(CRASH_CONFIRMATION_MS, ms);
+    TEST_ASSERT_EQUAL_UINT32(0, settingsRead(settingsDefaults(), 0x7F, out));
+}
+
+static void test_stored_form_round_trip() {
+    Settings draft = settingsDefaults();
+    setF32(draft, SETTING_BRAKE_G, 0.7f);
+    setU8(draft, SETTING_LED_BRIGHTNESS, 90);
+
+    uint8_t stored[SETTINGS_ENCODED_MAX];
+    size_t len = settingsEncode(draft, stored);
+    TEST_ASSERT_LESS_OR_EQUAL(SETTINGS_ENCODED_MAX, len);
+
+    Settings loaded;
+    TEST_ASSERT_TRUE(settingsDecode(stored, len, loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&draft, &loaded, sizeof(draft));
+}
+
+static void test_stored_form_keeps_defaults_for_bad_entries() {
+    // Unknown id, a brightness of 0 stored by older firmware, a truncated entry
+    const uint8_t stored[] = { SETTINGS_SCHEMA_VERSION,
+                               0x7F, 1, 0x55,
+                               SETTING_LED_BRIGHTNESS, 1, 0,
+                               SETTING_AVERAGE_SAMPLES, 1, 10,
+                               SETTING_BRAKE_FLASH, 2, 0x10 };
+    Settings loaded;
+    TEST_ASSERT_TRUE(settingsDecode(stored, sizeof(stored), loaded));
+    TEST_ASSERT_EQUAL_UINT8(LED_BRIGHTNESS, loaded.ledBrightness);
+    TEST_ASSERT_EQUAL_UINT8(10, loaded.averageSamples);
+    TEST_ASSERT_EQUAL_UINT16(BRAKE_FLASH_DURATION, loaded.brakeFlashMs);
+
+    const uint8_t otherSchema[] = { SETTINGS_SCHEMA_VERSION + 1, SETTING_AVERAGE_SAMPLES, 1, 10 };
+    TEST_ASSERT_FALSE(settingsDecode(otherSchema, sizeof(otherSchema), loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&settingsDefaults(), &loaded, sizeof(loaded));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ranges);
+    RUN_TEST(test_brightness_cannot_turn_the_light_off);
+    RUN_TEST(test_bad_length_and_unknown_id);
+    RUN_TEST(test_publish_swaps_snapshot);
+    RUN_TEST(test_read_back);
+    RUN_TEST(test_stored_form_round_trip);
+    RUN_TEST(test_stored_form_keeps_defaults_for_bad_entries);
+    return UNITY_END();
+}
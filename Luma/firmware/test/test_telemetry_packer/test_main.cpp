@@ -0,0 +1,113 @@
+/*
+ * Telemetry frame packing: header, sample deltas, frame limits
+ *
+ *   pio test -e native -f test_telemetry_packer
+ */
+
+#include <unity.h>
+#include "telemetry.h"
+
+void setUp() {}
+void tearDown() {}
+
+static ImuSample sampleAt(uint32_t timestampUs, int16_t accelX = 0) {
+    ImuSample sample = {};
+    sample.timestampUs = timestampUs;
+    sample.raw.accelX = accelX;
+    return sample;
+}
+
+static uint16_t getU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void test_frame_layout() {
+    TelemetryPacker packer;
+    packer.setMaxPayload(244);
+    TEST_ASSERT_TRUE(packer.append(sampleAt(1000, 100)));
+    TEST_ASSERT_TRUE(packer.append(sampleAt(6000, -100)));
+
+    size_t len = packer.finish(3);
+    const uint8_t* frame = packer.data();
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_HEADER_LEN + 2 * TELEMETRY_SAMPLE_LEN, len);
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_PROTOCOL_VERSION, frame[0]);
+    TEST_ASSERT_EQUAL_UINT16(0, getU16(&frame[2]));
+    TEST_ASSERT_EQUAL_UINT32(1000, getU32(&frame[4]));
+    TEST_ASSERT_EQUAL_UINT8(3, frame[8]);
+    TEST_ASSERT_EQUAL_UINT8(2, frame[9]);
+
+    const uint8_t* second = frame + TELEMETRY_HEADER_LEN + TELEMETRY_SAMPLE_LEN;
+    TEST_ASSERT_EQUAL_UINT16(0, getU16(frame + TELEMETRY_HEADER_LEN));
+    TEST_ASSERT_EQUAL_UINT16(5000, getU16(second));
+    TEST_ASSERT_EQUAL_INT16(-100, (int16_t)getU16(second + 2));
+}
+
+static void test_finish_twice_sends_nothing() {
+    TelemetryPacker packer;
+    packer.append(sampleAt(1000));
+
+    TEST_ASSERT_TRUE(packer.finish(0) > 0);
+    TEST_ASSERT_TRUE(packer.empty());
+    TEST_ASSERT_EQUAL_UINT8(0, packer.count());
+    TEST_ASSERT_EQUAL_UINT32(0, packer.finish(0));
+
+    // The next frame carries the next sequence number, not one skipped
+    packer.append(sampleAt(2000));
+    packer.finish(0);
+    TEST_ASSERT_EQUAL_UINT16(1, getU16(&packer.data()[2]));
+}
+
+static void test_empty_frame_is_not_sent() {
+    TelemetryPacker packer;
+    TEST_ASSERT_TRUE(packer.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, packer.finish(0));
+
+    packer.append(sampleAt(1000));
+    packer.discard();
+    TEST_ASSERT_EQUAL_UINT32(0, packer.finish(0));
+}
+
+static void test_frame_fills_payload() {
+    TelemetryPacker packer;  // Default MTU: header + one sample
+    TEST_ASSERT_TRUE(packer.append(sampleAt(1000)));
+    TEST_ASSERT_TRUE(packer.full());
+    TEST_ASSERT_FALSE(packer.append(sampleAt(6000)));
+
+    packer.setMaxPayload(TELEMETRY_HEADER_LEN + 3 * TELEMETRY_SAMPLE_LEN);
+    TEST_ASSERT_TRUE(packer.append(sampleAt(6000)));
+    TEST_ASSERT_TRUE(packer.append(sampleAt(11000)));
+    TEST_ASSERT_TRUE(packer.full());
+}
+
+static void test_long_gap_starts_new_frame() {
+    TelemetryPacker packer;
+    packer.setMaxPayload(244);
+    packer.append(sampleAt(1000));
+    TEST_ASSERT_FALSE(packer.append(sampleAt(1000 + 0x10000)));
+    TEST_ASSERT_EQUAL_UINT8(1, packer.count());
+}
+
+static void test_samples_lost_flag_clears_after_frame() {
+    TelemetryPacker packer;
+    packer.markSamplesLost();
+    packer.append(sampleAt(1000));
+    packer.finish(0);
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_FLAG_SAMPLES_LOST, packer.data()[1]);
+
+    packer.append(sampleAt(2000));
+    packer.finish(0);
+    TEST_ASSERT_EQUAL_UINT8(0, packer.data()[1]);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_layout);
+    RUN_TEST(test_finish_twice_sends_nothing);
+    RUN_TEST(test_empty_frame_is_not_sent);
+    RUN_TEST(test_frame_fills_payload);
+    RUN_TEST(test_long_gap_starts_new_frame);
+    RUN_TEST(test_samples_lost_flag_clears_after_frame);
+    return UNITY_END();
+}